@@ -1,10 +1,13 @@
 #include "stdafx.h"
 #include "Tile.h"
+#include "Viewshed.h"
 
 int _tmain(int argc, _TCHAR* argv[])
 {
   Tile t(8, 1.0f, 3);
   t.SaveImages(L"Terrain.png");
+//  Viewshed v(t, 3, 1024, 1024, 512, 0.02f, 0.0f);
+//  t.SaveImages(L"Viewshed.png", &v);
 //  t.TriangulateZOrder();
 //  t.SaveObjs(L"Terrain.obj");
 
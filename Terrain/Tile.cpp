@@ -5,22 +5,24 @@
 #include <limits>
 #include <sstream>
 #include <string>
+#include <vector>
 #include "IOTools.h"
 #include "Tile.h"
+#include "Viewshed.h"
 
 // Die Makros min und max aus windef.h vertragen sich nicht mit std::min,
 // std::max, std::numeric_limits<*>::min, std::numeric_limits<*>::max.
 #undef min
 #undef max
 
-// Makro, um die Indexberechnungen fr das "flachgeklopfte" 2D-Array von
+// Makro, um die Indexberechnungen für das "flachgeklopfte" 2D-Array von
 // Vertices zu vereinfachen
 #define I(x,y) ((y)*size_+(x))
 
 namespace {
 
 /**
- * Generiert zufllige Fliekommazahl zwischen -1 und 1
+ * Generiert zufällige Fließkommazahl zwischen -1 und 1
  */
 inline float randf() {
   return rand() / (RAND_MAX * 0.5f) - 1.0f;
@@ -79,14 +81,14 @@ void Tile::Init(float roughness) {
     }
   }
 
-  // Ecken mit Zufallshhenwerten initialisieren
+  // Ecken mit Zufallshöhenwerten initialisieren
   int block_size = size_ - 1;
   vertices_[I(0, 0)].y = randf();
   vertices_[I(0, block_size)].y = randf();
   vertices_[I(block_size, 0)].y = randf();
   vertices_[I(block_size, block_size)].y = randf();
 
-  // Verfeinerungsschritte durchfhren bis smtliche Werte berechnet sind
+  // Verfeinerungsschritte durchführen bis sämtliche Werte berechnet sind
   while (block_size > 1) {
     Refine(block_size, roughness);
     block_size = block_size / 2;
@@ -102,7 +104,7 @@ void Tile::InitFromParent(void) {
     case SE: x1 = size_ / 2; y1 = size_ / 2; break;
   }
 
-  // y-Werte aus dem entsprechenden Quadranten des Eltern-Tiles bernehmen
+  // y-Werte aus dem entsprechenden Quadranten des Eltern-Tiles übernehmen
   for (int y = 0; y < size_; y += 2) {
     for (int x = 0; x < size_; x += 2) {
       vertices_[I(x,y)].y = parent_->vertices_[I(x/2+x1,y/2+y1)].y;
@@ -127,7 +129,7 @@ void Tile::Refine(int block_size, float roughness) {
 
   for (int y = block_size_h; y < size_; y += block_size) {
     for (int x = block_size_h; x < size_; x += block_size) {
-      // Lookup der umliegenden Hhenwerte (-); o ist Position (x, y)
+      // Lookup der umliegenden Höhenwerte (-); o ist Position (x, y)
       // -   -
       //   o
       // -   -
@@ -136,7 +138,7 @@ void Tile::Refine(int block_size, float roughness) {
       float sw = vertices_[I(x - block_size_h, y + block_size_h)].y;
       float se = vertices_[I(x + block_size_h, y + block_size_h)].y;
       
-      // Berechnung der neuen Hhenwerte (+)
+      // Berechnung der neuen Höhenwerte (+)
       // - + -
       // + +
       // -   -
@@ -161,7 +163,7 @@ void Tile::Refine(int block_size, float roughness) {
       }
       vertices_[I(x - block_size_h, y)].y = w + offset_factor * randf();
 
-      // Edge cases: Berechnung neuer Hhenwerte am rechten bzw. unteren Rand
+      // Edge cases: Berechnung neuer Höhenwerte am rechten bzw. unteren Rand
       // -   -
       //     +
       // - + - 
@@ -202,9 +204,9 @@ void Tile::InitChildren(float roughness, Tile *north, Tile *west) {
     child_NWW = child_SWW = NULL;
   }
 
-  // Erzeugen der Kind-Tiles mit bergabe der Nachbarschaftsinformationen
-  roughness /= 2; // Halbiere Rauheits-Faktor, um die genderten
-                  // Grenverhltnisse zu transportieren
+  // Erzeugen der Kind-Tiles mit Übergabe der Nachbarschaftsinformationen
+  roughness /= 2; // Halbiere Rauheits-Faktor, um die geänderten
+                  // Größenverhältnisse zu transportieren
   children_[NW] = new Tile(this, NW, roughness, child_NNW, child_NWW);
   children_[NE] = new Tile(this, NE, roughness, child_NNE, children_[NW]);
   children_[SW] = new Tile(this, SW, roughness, children_[NW], child_SWW);
@@ -256,46 +258,17 @@ float Tile::GetMaxHeight() const {
   return max;
 }
 
-void Tile::SaveImages(const std::wstring &filename) const {
-  std::wstring basename(filename);
-  basename.erase(basename.rfind('.'), basename.size());
-  std::wstring extension(filename, filename.rfind('.'));
-  int image_size = size_;
-  for (int lod = 0; lod <= num_lod_; ++lod) {
-    unsigned char *image_data = new unsigned char[3 * image_size * image_size];
-    SaveImageTilesForLOD(image_data, image_size, 0, 0, lod);
-    std::wstringstream ss;
-    ss << basename << lod << extension;
-    IOTools::SaveImage(ss.str().c_str(), image_size, image_size, image_data, true);
-    image_size = 2 * image_size - 1;
-    delete[] image_data;
- }
+void Tile::GetHeights(int lod, float *heights) const {
+  GetHeightsForLOD(heights, GetSizeForLOD(lod), 0, 0, lod);
 }
 
-void Tile::SaveImageTilesForLOD(unsigned char *image_data, int image_size,
-                                int x_off, int y_off, int lod) const {
-  if (lod > 0) {
-    // Noch nicht tief genug abgestiegen, Tile mit hherem LOD gesucht
-    children_[NW]->SaveImageTilesForLOD(image_data, image_size,
-                                        x_off, y_off, lod - 1);
-    children_[NE]->SaveImageTilesForLOD(image_data, image_size,
-                                        x_off + (size_ - 1) * (1 << (lod - 1)),
-                                        y_off, lod - 1);
-    children_[SW]->SaveImageTilesForLOD(image_data, image_size,
-                                        x_off,
-                                        y_off + (size_ - 1) * (1 << (lod - 1)), lod - 1);
-    children_[SE]->SaveImageTilesForLOD(image_data, image_size,
-                                        x_off + (size_ - 1) * (1 << (lod - 1)),
-                                        y_off + (size_ - 1) * (1 << (lod - 1)), lod - 1);
-    // Hier gibt es sonst nichts zu tun...
-    return;
-  }
-
+void Tile::SaveImages(const std::wstring &filename,
+                      const Viewshed *viewshed) const {
   static const int num_spots = 8;
   static const float spots[num_spots] = {
     -1.0f,      // Tiefes Wasser
     -0.25f,     // Seichtes Wasser
-     0.0f,      // Kste
+     0.0f,      // Küste
      0.0625f,   // Strand
      0.125f,    // Gras
      0.375f,    // Wald
@@ -305,33 +278,39 @@ void Tile::SaveImageTilesForLOD(unsigned char *image_data, int image_size,
   static const unsigned char colors[num_spots][3] = {
     { 160, 0, 0 },      // Tiefes Wasser
     { 255, 64, 0 },     // Seichtes Wasser
-    { 255, 128, 0 },    // Kste
+    { 255, 128, 0 },    // Küste
     { 64, 240, 240 },   // Strand
     { 0, 160, 32 },     // Gras
     { 0, 96, 0 },       // Wald
     { 128, 128, 128 },  // Gestein
     { 255, 255, 255 }   // Schnee
   };
-  int i = 0;
-  int image_index = 3 * (y_off * image_size + x_off);
-  for (int y = 0; y < size_; ++y, image_index += 3 * (image_size - size_)) {
-    for (int x = 0; x < size_; ++x, ++i, image_index += 3) {
-      float height = vertices_[i].y;      
+  std::wstring basename(filename);
+  basename.erase(basename.rfind('.'), basename.size());
+  std::wstring extension(filename, filename.rfind('.'));
+  for (int lod = 0; lod <= num_lod_; ++lod) {
+    const int image_size = GetSizeForLOD(lod);
+    std::vector<float> heights(image_size * image_size);
+    GetHeights(lod, &heights[0]);
+    unsigned char *image_data = new unsigned char[3 * image_size * image_size];
+    int image_index = 0;
+    for (size_t i = 0; i < heights.size(); ++i, image_index += 3) {
+      float height = heights[i];
       if (height < spots[0]) {
-        // Hhe liegt unterhalb der Bereiche
+        // Höhe liegt unterhalb der Bereiche
         image_data[image_index]   = colors[0][0];
         image_data[image_index+1] = colors[0][1];
         image_data[image_index+2] = colors[0][2];
       } else if (height > spots[num_spots - 1]) {
-        // Hhe liegt oberhalb der Bereiche
+        // Höhe liegt oberhalb der Bereiche
         image_data[image_index]   = colors[num_spots - 1][0];
         image_data[image_index+1] = colors[num_spots - 1][1];
         image_data[image_index+2] = colors[num_spots - 1][2];
       } else {
-        // Hhe liegt innerhalb eines Bereichs
+        // Höhe liegt innerhalb eines Bereichs
         for (int j = 0; j < num_spots - 1; ++j) {
           if (spots[j] <= height && height <= spots[j+1]) {
-            // Bereich gefunden, in der die Hhe liegt
+            // Bereich gefunden, in der die Höhe liegt
             // Interpolation der beiden angrenzenden Farben des Bereichs
             float interpolated_value = (height - spots[j]) /
                                        (spots[j+1] - spots[j]);
@@ -345,13 +324,66 @@ void Tile::SaveImageTilesForLOD(unsigned char *image_data, int image_size,
           } // if
         } // for
       } // else
-    } // for (int x = 0; ...
-  } // for (int y = 0; ...
+    } // for (size_t i = 0; ...
+
+    if (viewshed != NULL && viewshed->GetLOD() == lod) {
+      // Sichtbarkeit einzeichnen: Sichtbares bleibt unverändert
+      image_index = 0;
+      for (int y = 0; y < image_size; ++y) {
+        for (int x = 0; x < image_size; ++x, image_index += 3) {
+          int factor;
+          switch (viewshed->Get(x, y)) {
+            case Viewshed::VISIBLE: factor = 4; break;
+            case Viewshed::HIDDEN:  factor = 1; break;
+            default:                factor = 2; break;
+          }
+          for (int c = 0; c < 3; ++c) {
+            image_data[image_index+c] =
+                static_cast<unsigned char>(image_data[image_index+c] *
+                                           factor / 4);
+          }
+        }
+      }
+    }
+
+    std::wstringstream ss;
+    ss << basename << lod << extension;
+    IOTools::SaveImage(ss.str().c_str(), image_size, image_size, image_data, true);
+    delete[] image_data;
+ }
+}
+
+void Tile::GetHeightsForLOD(float *heights, int heights_size, int x_off,
+                            int y_off, int lod) const {
+  if (lod > 0) {
+    // Noch nicht tief genug abgestiegen, Tile mit höherem LOD gesucht
+    children_[NW]->GetHeightsForLOD(heights, heights_size,
+                                    x_off, y_off, lod - 1);
+    children_[NE]->GetHeightsForLOD(heights, heights_size,
+                                    x_off + (size_ - 1) * (1 << (lod - 1)),
+                                    y_off, lod - 1);
+    children_[SW]->GetHeightsForLOD(heights, heights_size,
+                                    x_off,
+                                    y_off + (size_ - 1) * (1 << (lod - 1)), lod - 1);
+    children_[SE]->GetHeightsForLOD(heights, heights_size,
+                                    x_off + (size_ - 1) * (1 << (lod - 1)),
+                                    y_off + (size_ - 1) * (1 << (lod - 1)), lod - 1);
+    // Hier gibt es sonst nichts zu tun...
+    return;
+  }
+
+  int i = 0;
+  int heights_index = y_off * heights_size + x_off;
+  for (int y = 0; y < size_; ++y, heights_index += heights_size - size_) {
+    for (int x = 0; x < size_; ++x, ++i, ++heights_index) {
+      heights[heights_index] = vertices_[i].y;
+    }
+  }
 }
 
 void Tile::InitIndexBuffer(void) {
   if (index_buffer_ == NULL) {
-    // (size_-1)^2 Blcke, pro Block 2 Dreiecke, pro Dreieck 3 Indizes
+    // (size_-1)^2 Blöcke, pro Block 2 Dreiecke, pro Dreieck 3 Indizes
     index_buffer_ = new unsigned int[(size_-1)*(size_-1)*2*3];
   }    
 }
@@ -428,8 +460,8 @@ void Tile::SaveObjs0(const std::wstring &basename,
       Vector &v = vertices_[I(x,y)];
       ofs << "v ";
       ofs << v.x << " ";
-      // Alle Hhenwerte < 0 sind Wasser, das Terrain darunter ist fr die
-      // gewnschte Darstellung uninteressant
+      // Alle Höhenwerte < 0 sind Wasser, das Terrain darunter ist für die
+      // gewünschte Darstellung uninteressant
       ofs << std::max(0.0f, v.y) << " ";
       ofs << v.z << std::endl;
     }
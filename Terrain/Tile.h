@@ -2,47 +2,66 @@
 #include "stdafx.h"
 #include <string>
 
+class Viewshed;
+
 /**
- * Hhenfeld-Tile
+ * Höhenfeld-Tile
  */
 class Tile {
  public:
   /**
    * Konstruktor.
-   * @param n Detaillevel, legt die Gre des Tiles (2^n - 1) fest
-   * @param roughness Rauheits-Faktor (je hher desto grer die
-   *                  Hhenunterschiede)
-   * @param num_lod Anzahl zustzlicher LOD-Ebenen
+   * @param n Detaillevel, legt die Größe des Tiles (2^n - 1) fest
+   * @param roughness Rauheits-Faktor (je höher desto größer die
+   *                  Höhenunterschiede)
+   * @param num_lod Anzahl zusätzlicher LOD-Ebenen
    */
   Tile(int n, float roughness, int num_lod);
   ~Tile(void);
 
   /** 
-   * Gibt die Auflsung des Tiles zurck.
+   * Gibt die Auflösung des Tiles zurück.
    */
   int GetResolution() const { return size_ * size_; }
 
   /**
-   * Gibt die Detailstufe (LOD) des Tiles zurck.
+   * Gibt die Detailstufe (LOD) des Tiles zurück.
    */
   int GetLOD() const { return lod_; }
 
   /**
-   * Ermittelt die minimale Hhe im Tile und gibt sie zurck.
+   * Ermittelt die minimale Höhe im Tile und gibt sie zurück.
    */
   float GetMinHeight() const;
 
   /**
-   * Ermittelt die maximale Hhe im Tile und gibt sie zurck.
+   * Ermittelt die maximale Höhe im Tile und gibt sie zurück.
    */
   float GetMaxHeight() const;
 
   /**
-   * Speichert die Hhendaten als Bilder. Pro LOD-Ebene wird ein Bild erzeugt.
-   * @param filename Basisdateiname fr die Bilder. Die Dateiendung bestimmt
+   * Gibt die Seitenlänge des aus allen Tiles der LOD-Ebene lod
+   * zusammengesetzten Höhenfelds zurück.
+   */
+  int GetSizeForLOD(int lod) const { return (size_ - 1) * (1 << lod) + 1; }
+
+  /**
+   * Schreibt die Höhenwerte aller Tiles der LOD-Ebene lod als ein
+   * zusammenhängendes Höhenfeld (zeilenweise) in heights.
+   * @param heights Feld für GetSizeForLOD(lod) x GetSizeForLOD(lod) Werte
+   */
+  void GetHeights(int lod, float *heights) const;
+
+  /**
+   * Speichert die Höhendaten als Bilder. Pro LOD-Ebene wird ein Bild erzeugt.
+   * @param filename Basisdateiname für die Bilder. Die Dateiendung bestimmt
    *                 das Dateiformat des Bildes.
+   * @param viewshed Sichtbarkeitsanalyse (oder NULL), die in das Bild ihrer
+   *                 LOD-Ebene eingezeichnet wird: verdeckte Bereiche dunkel,
+   *                 Bereiche außerhalb der Sichtweite abgeschwächt
    */
-  void SaveImages(const std::wstring &filename) const;
+  void SaveImages(const std::wstring &filename,
+                  const Viewshed *viewshed = NULL) const;
   
   /**
    * Trianguliert streifenweise.
@@ -55,7 +74,7 @@ class Tile {
   void TriangulateZOrder(void);
 
   /**
-   * Speichert Terrain-Mesh fr jedes Tile im OBJ-Dateiformat.
+   * Speichert Terrain-Mesh für jedes Tile im OBJ-Dateiformat.
    */
   void SaveObjs(const std::wstring &filename) const;
 
@@ -65,7 +84,7 @@ class Tile {
    */
   enum Direction { NW = 0, NE, SW, SE };
   /**
-   * 3-dimensionaler Vektor, wird fr Vertices verwendet.
+   * 3-dimensionaler Vektor, wird für Vertices verwendet.
    * @see Tile::vertices_
    */
   struct Vector { float x, y, z; };
@@ -75,27 +94,27 @@ class Tile {
   void operator=(const Tile &t);
 
   /**
-   * Konstruktor fr Kind-Tiles.
+   * Konstruktor für Kind-Tiles.
    * @param parent Eltern-Tile
    * @param direction Quadrant des Eltern-Tiles, in dem dieses Tile liegt
-   * @param roughness Rauheits-Faktor fr die weitere Verfeinerung
-   * @param north Zeiger auf nrdlichen Nachbarn (oder NULL)
+   * @param roughness Rauheits-Faktor für die weitere Verfeinerung
+   * @param north Zeiger auf nördlichen Nachbarn (oder NULL)
    * @param west Zeiger auf westlichen Nachbarn (oder NULL)
    */
   Tile(Tile *parent, Direction direction, float roughness, Tile *north,
        Tile *west);
 
   /**
-   * Schreibt die Hhenfelder aller Tiles einer bestimmten LOD-Stufe in ein
-   * Bild.
-   * @param image_data Zeiger auf den Speicherbereich des Bildes
-   * @param image_size Seitenlnge des Bildes
-   * @param x_off x-Offset fr die Speicherung des Tiles
-   * @param y_off y-Offset fr die Speicherung des Tiles
+   * Schreibt die Höhenfelder aller Tiles einer bestimmten LOD-Stufe in ein
+   * gemeinsames Höhenfeld (Implementierung von GetHeights).
+   * @param heights Zeiger auf das Höhenfeld
+   * @param heights_size Seitenlänge des Höhenfelds
+   * @param x_off x-Offset für die Speicherung des Tiles
+   * @param y_off y-Offset für die Speicherung des Tiles
    * @param lod Anzahl noch abzusteigender LOD-Stufen
    */
-  void SaveImageTilesForLOD(unsigned char *image_data, int image_size,
-                            int x_off, int y_off, int lod) const;
+  void GetHeightsForLOD(float *heights, int heights_size, int x_off,
+                        int y_off, int lod) const;
 
   /**
    * Rekursive Implementierung von SaveObjs
@@ -104,37 +123,37 @@ class Tile {
                  const std::wstring &extension) const;
 
   /**
-   * Initialisierungsfunktion fr das Wurzel-Tile. Setzt die anfnglichen
+   * Initialisierungsfunktion für das Wurzel-Tile. Setzt die anfänglichen
    * Zufallswerte und berechnet x- und z-Koordinaten aller Vertices vor.
    */
   void Init(float roughness);
   /**
-   * Initialisierungsfunktion fr ein Kind-Tile. bernimmt die Werte aus dem
+   * Initialisierungsfunktion für ein Kind-Tile. Übernimmt die Werte aus dem
    * entsprechenden Quadranten des Eltern-Tiles und berechnet x- und z-
    * Koordinaten aller Vertices vor.
    */
   void InitFromParent(void);
   /**
-   * Fhrt die Verfeinerung der Hheninformationen nach dem
-   * Diamond-Square-Algorithmus zur Blockgre block_size durch.
+   * Führt die Verfeinerung der Höheninformationen nach dem
+   * Diamond-Square-Algorithmus zur Blockgröße block_size durch.
    */
   void Refine(int block_size, float roughness);
   /**
-   * Initialisiert die Kind-Tiles, falls ntig.
-   * @param roughness Rauheits-Faktor fr die Verfeinerung der Kind-Tiles
-   * @param north Nrdlicher Nachbar dieses Tiles
+   * Initialisiert die Kind-Tiles, falls nötig.
+   * @param roughness Rauheits-Faktor für die Verfeinerung der Kind-Tiles
+   * @param north Nördlicher Nachbar dieses Tiles
    * @param west Westlicher Nachbar dieses Tiles
    */
   void InitChildren(float roughness, Tile *north, Tile *west);
 
   /**
-   * "Repariert" die bergnge des Tiles. bernimmt die sdlichste Zeile des
-   * nrdlichen Nachbarn und stlichste Spalte des westlichen Nachbarn.
+   * "Repariert" die Übergänge des Tiles. Übernimmt die südlichste Zeile des
+   * nördlichen Nachbarn und östlichste Spalte des westlichen Nachbarn.
    */
   void FixEdges(Tile *north, Tile *west);
 
   /**
-   * Reserviert Speicher fr den Index Buffer.
+   * Reserviert Speicher für den Index Buffer.
    */
   void InitIndexBuffer(void);
 
@@ -148,11 +167,11 @@ class Tile {
    */
   const int lod_;
   /**
-   * Gre des Tiles (Seitenlnge)
+   * Größe des Tiles (Seitenlänge)
    */
   const int size_;
   /**
-   * Anzahl zustzlicher LOD-Ebenen unter diesem Tile
+   * Anzahl zusätzlicher LOD-Ebenen unter diesem Tile
    */
   const int num_lod_;
 
@@ -161,13 +180,13 @@ class Tile {
    */
   Vector *vertices_;
   /**
-   * Indizes fr die Triangulierung des Hhenfeldes
+   * Indizes für die Triangulierung des Höhenfeldes
    * @see Tile::TriangulateLines
    * @see Tile::TriangulateZOrder
    */
   unsigned int *index_buffer_;
   /**
-   * bergeordnetes Eltern-Tile
+   * Übergeordnetes Eltern-Tile
    */
   Tile *parent_;
   /**
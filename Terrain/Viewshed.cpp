@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "Viewshed.h"
+#include "Tile.h"
+
+// Makros min und max aus windef.h (siehe Tile.cpp)
+#undef min
+#undef max
+
+namespace {
+
+/**
+ * Anzahl der Winkelsektoren, in die die Strahlen zur parallelen Verarbeitung
+ * aufgeteilt werden
+ */
+const int NUM_SECTORS = 256;
+
+/**
+ * Zustand eines Strahls in Viewshed::SweepSector. Auf den vier Seiten des
+ * Quadrats liegen je 2 * radius Randzellen; entlang der Hauptachse (major)
+ * geht ein Strahl je Schritt eine Zelle weiter, entlang der Nebenachse
+ * (minor) bis end_minor nach radius Schritten.
+ */
+struct Ray {
+  int major_x, major_y, minor_x, minor_y;
+  int end_minor;
+  /**
+   * Nebenkoordinate im Schritt k, round(k * end_minor / radius), exakt und
+   * ohne Division mitgeführt (wie bei Bresenham):
+   * 2 * radius * minor + rest = 2 * k * end_minor + radius
+   */
+  int minor, rest;
+  /**
+   * Größte Steigung bisher
+   */
+  float horizon;
+  bool active;
+};
+
+}
+
+Viewshed::Viewshed(const Tile &tile, int lod, int x, int y, int radius,
+                   float observer_height, float target_height)
+    : lod_(lod),
+      size_(tile.GetSizeForLOD(lod)),
+      x_(x),
+      y_(y),
+      radius_(radius),
+      target_height_(target_height),
+      visibility_(size_ * size_, OUT_OF_RANGE) {
+  std::vector<float> heights(size_ * size_);
+  tile.GetHeights(lod, &heights[0]);
+  // Höhenwerte < 0 sind Wasser, sichtbar ist die Wasseroberfläche
+  for (size_t i = 0; i < heights.size(); ++i) {
+    heights[i] = std::max(0.0f, heights[i]);
+  }
+  eye_height_ = heights[y_ * size_ + x_] + observer_height;
+  visibility_[y_ * size_ + x_] = VISIBLE;
+  if (radius_ <= 0) return;
+
+  const int num_rays = 8 * radius_;
+#pragma omp parallel for schedule(dynamic)
+  for (int sector = 0; sector < NUM_SECTORS; ++sector) {
+    SweepSector(&heights[0], sector * num_rays / NUM_SECTORS,
+                (sector + 1) * num_rays / NUM_SECTORS);
+  }
+}
+
+int Viewshed::GetNumVisible() const {
+  return static_cast<int>(std::count(visibility_.begin(), visibility_.end(),
+                                     static_cast<unsigned char>(VISIBLE)));
+}
+
+void Viewshed::SweepSector(const float *heights, int first_ray, int end_ray) {
+  std::vector<Ray> rays(end_ray - first_ray);
+  for (int i = 0; i < end_ray - first_ray; ++i) {
+    Ray &ray = rays[i];
+    const int side = (first_ray + i) / (2 * radius_);
+    const int s = (first_ray + i) % (2 * radius_);
+    switch (side) {
+      case 0:   // Osten, von Nord nach Süd
+        ray.major_x = 1;  ray.major_y = 0;  ray.minor_x = 0; ray.minor_y = 1;
+        ray.end_minor = s - radius_;
+        break;
+      case 1:   // Süden, von Ost nach West
+        ray.major_x = 0;  ray.major_y = 1;  ray.minor_x = 1; ray.minor_y = 0;
+        ray.end_minor = radius_ - s;
+        break;
+      case 2:   // Westen, von Süd nach Nord
+        ray.major_x = -1; ray.major_y = 0;  ray.minor_x = 0; ray.minor_y = 1;
+        ray.end_minor = radius_ - s;
+        break;
+      default:  // Norden, von West nach Ost
+        ray.major_x = 0;  ray.major_y = -1; ray.minor_x = 1; ray.minor_y = 0;
+        ray.end_minor = s - radius_;
+        break;
+    }
+    ray.minor = 0;
+    ray.rest = radius_;
+    ray.horizon = -std::numeric_limits<float>::max();
+    ray.active = true;
+  }
+
+  // Alle Strahlen des Sektors gemeinsam Schritt für Schritt verfolgen. Sie
+  // liegen dann in jedem Schritt auf einem kurzen Bogen, die gelesenen und
+  // geschriebenen Zellen also nahe beieinander (ein Strahl allein springt
+  // bei steilen Winkeln in jedem Schritt in eine neue Zeile).
+  const int two_radius = 2 * radius_;
+  unsigned char *visibility = &visibility_[0];
+  unsigned char not_owned;
+  int num_active = end_ray - first_ray;
+  for (int k = 1; k <= radius_ && num_active > 0; ++k) {
+    for (size_t i = 0; i < rays.size(); ++i) {
+      Ray &ray = rays[i];
+      if (!ray.active) continue;
+      ray.rest += 2 * ray.end_minor;
+      // Der Schritt entlang der Nebenachse wechselt unvorhersagbar, daher
+      // verzweigungsfrei
+      const int carry = (ray.rest >= two_radius) - (ray.rest < 0);
+      ray.rest -= carry * two_radius;
+      ray.minor += carry;
+      // Entfernung und Position wachsen entlang des Strahls monoton
+      const int distance_squared = k * k + ray.minor * ray.minor;
+      const int x = x_ + ray.major_x * k + ray.minor_x * ray.minor;
+      const int y = y_ + ray.major_y * k + ray.minor_y * ray.minor;
+      if (distance_squared > radius_ * radius_ ||
+          x < 0 || x >= size_ || y < 0 || y >= size_) {
+        ray.active = false;
+        --num_active;
+        continue;
+      }
+
+      const float height = heights[y * size_ + x];
+      const float inv_distance = 1.0f / sqrtf(static_cast<float>(
+          distance_squared));
+      const float slope = (height + target_height_ - eye_height_) *
+                          inv_distance;
+      // Die Zelle gehört dem Strahl, dessen Randzelle ihr am nächsten liegt:
+      // round(minor * radius_ / k) == end_minor. Sonst wird ins Leere
+      // geschrieben (ebenfalls verzweigungsfrei).
+      const int scaled_minor = ray.minor * two_radius;
+      const bool owned = (2 * ray.end_minor - 1) * k <= scaled_minor &&
+                         scaled_minor < (2 * ray.end_minor + 1) * k;
+      unsigned char *out = owned ? &visibility[y * size_ + x] : &not_owned;
+      *out = static_cast<unsigned char>(slope >= ray.horizon ? VISIBLE :
+                                                                HIDDEN);
+      ray.horizon = std::max(ray.horizon,
+                             (height - eye_height_) * inv_distance);
+    }
+  }
+}
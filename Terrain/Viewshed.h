@@ -0,0 +1,98 @@
+#pragma once
+#include "stdafx.h"
+#include <vector>
+
+class Tile;
+
+/**
+ * Sichtbarkeitsanalyse (Viewshed): welche Punkte des Höhenfelds einer
+ * LOD-Ebene sind von einem Beobachter aus innerhalb einer Sichtweite zu
+ * sehen.
+ *
+ * Berechnet wird nach dem R2-Verfahren: vom Beobachter aus wird zu jeder
+ * Zelle auf dem Rand des Quadrats mit Halbseite radius ein Strahl durch das
+ * Raster gelegt, der entlang des Wegs die größte Steigung (den Horizont)
+ * mitführt. Eine Zelle ist sichtbar, wenn ihre Steigung nicht unter dem
+ * Horizont davor liegt. Jeder Strahl schreibt nur die Zellen, deren
+ * nächstgelegener Strahl er ist, so dass jede Zelle genau einmal
+ * geschrieben wird. Die Strahlen werden dadurch ohne Synchronisation
+ * parallel (nach Winkelsektoren) verarbeitet, und das Ergebnis hängt nicht
+ * von der Anzahl der Threads ab. Der Aufwand ist O(radius^2).
+ */
+class Viewshed {
+ public:
+  /**
+   * Ergebnis je Zelle
+   */
+  enum Visibility { HIDDEN = 0, VISIBLE, OUT_OF_RANGE };
+
+  /**
+   * Konstruktor. Führt die Analyse durch.
+   * @param tile Wurzel-Tile
+   * @param lod LOD-Ebene, auf deren Höhenfeld gerechnet wird (siehe
+   *            Tile::GetHeights)
+   * @param x Position des Beobachters im Höhenfeld (Spalte)
+   * @param y Position des Beobachters im Höhenfeld (Zeile)
+   * @param radius Sichtweite in Zellen
+   * @param observer_height Augenhöhe des Beobachters über dem Boden
+   * @param target_height Höhe der gesuchten Ziele über dem Boden
+   */
+  Viewshed(const Tile &tile, int lod, int x, int y, int radius,
+           float observer_height, float target_height);
+
+  /**
+   * Gibt die LOD-Ebene zurück, auf der gerechnet wurde.
+   */
+  int GetLOD() const { return lod_; }
+
+  /**
+   * Gibt die Seitenlänge des Rasters zurück.
+   */
+  int GetSize() const { return size_; }
+
+  /**
+   * Gibt die Sichtbarkeit der Zelle (x, y) zurück.
+   */
+  Visibility Get(int x, int y) const {
+    return static_cast<Visibility>(visibility_[y * size_ + x]);
+  }
+
+  /**
+   * Gibt die Anzahl der sichtbaren Zellen zurück.
+   */
+  int GetNumVisible() const;
+
+ private:
+  /**
+   * Verfolgt die Strahlen vom Beobachter zu den Randzellen first_ray bis
+   * end_ray - 1 (nummeriert von 0 bis 8 * radius_ - 1, im Uhrzeigersinn ab
+   * der nordöstlichen Ecke).
+   */
+  void SweepSector(const float *heights, int first_ray, int end_ray);
+
+  /**
+   * LOD-Ebene und Seitenlänge des Rasters
+   */
+  const int lod_;
+  const int size_;
+  /**
+   * Position des Beobachters
+   */
+  const int x_, y_;
+  /**
+   * Sichtweite in Zellen
+   */
+  const int radius_;
+  /**
+   * Augenhöhe des Beobachters (absolut)
+   */
+  float eye_height_;
+  /**
+   * Höhe der Ziele über dem Boden
+   */
+  const float target_height_;
+  /**
+   * Sichtbarkeit je Zelle (Visibility), zeilenweise
+   */
+  std::vector<unsigned char> visibility_;
+};
@@ -1,8 +1,8 @@
 // stdafx.cpp : Quelldatei, die nur die Standard-Includes einbindet.
 // Terrain.pch ist der vorkompilierte Header.
-// stdafx.obj enthlt die vorkompilierten Typinformationen.
+// stdafx.obj enthält die vorkompilierten Typinformationen.
 
 #include "stdafx.h"
 
-// TODO: Auf zustzliche Header verweisen, die in STDAFX.H
+// TODO: Auf zusätzliche Header verweisen, die in STDAFX.H
 // und nicht in dieser Datei erforderlich sind.
@@ -1,6 +1,6 @@
-// stdafx.h : Includedatei fr Standardsystem-Includedateien
-// oder hufig verwendete projektspezifische Includedateien,
-// die nur in unregelmigen Abstnden gendert werden.
+// stdafx.h : Includedatei für Standardsystem-Includedateien
+// oder häufig verwendete projektspezifische Includedateien,
+// die nur in unregelmäßigen Abständen geändert werden.
 //
 
 #pragma once
@@ -12,4 +12,4 @@
 
 
 
-// TODO: Hier auf zustzliche Header, die das Programm erfordert, verweisen.
+// TODO: Hier auf zusätzliche Header, die das Programm erfordert, verweisen.
@@ -1,13 +1,13 @@
 #pragma once
 
 // Die folgenden Makros definieren die mindestens erforderliche Plattform. Die mindestens erforderliche Plattform
-// ist die frheste Windows-, Internet Explorer-Version usw., die ber die erforderlichen Features zur Ausfhrung 
-// Ihrer Anwendung verfgt. Die Makros aktivieren alle Funktionen, die auf den Plattformversionen bis 
-// einschlielich der angegebenen Version verfgbar sind.
+// ist die früheste Windows-, Internet Explorer-Version usw., die über die erforderlichen Features zur Ausführung 
+// Ihrer Anwendung verfügt. Die Makros aktivieren alle Funktionen, die auf den Plattformversionen bis 
+// einschließlich der angegebenen Version verfügbar sind.
 
-// ndern Sie folgende Definitionen fr Plattformen, die lter als die unten angegebenen sind.
-// Unter MSDN finden Sie die neuesten Informationen ber die entsprechenden Werte fr die unterschiedlichen Plattformen.
+// Ändern Sie folgende Definitionen für Plattformen, die älter als die unten angegebenen sind.
+// Unter MSDN finden Sie die neuesten Informationen über die entsprechenden Werte für die unterschiedlichen Plattformen.
 #ifndef _WIN32_WINNT            // Gibt an, dass Windows Vista die mindestens erforderliche Plattform ist.
-#define _WIN32_WINNT 0x0600     // ndern Sie den entsprechenden Wert, um auf andere Versionen von Windows abzuzielen.
+#define _WIN32_WINNT 0x0600     // Ändern Sie den entsprechenden Wert, um auf andere Versionen von Windows abzuzielen.
 #endif
 
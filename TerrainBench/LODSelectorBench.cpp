@@ -0,0 +1,73 @@
+#include "stdafx.h"
+#include <vector>
+#include <omp.h>
+#include "TerrainBench.h"
+#include "DynamicLODSelector.h"
+#include "FixedLODSelector.h"
+#include "Terrain.h"
+#include "Tile.h"
+
+namespace {
+
+/**
+ * Anzahl der Tile-Auswertungen je Messung (mindestens)
+ */
+const int SELECT_EVALUATIONS = 1 << 24;
+
+/**
+ * Misst selector.SelectLODs für batch, einmal mit der Standard-
+ * Implementierung (IsLODSufficient je Tile) und einmal mit der eigenen,
+ * und gibt die Dauer je Tile aus.
+ */
+void BenchSelector(const LODSelector &selector, const LODBatch &batch,
+                   const CBaseCamera *camera, const char *name) {
+  std::vector<unsigned int> masks[2];
+  double ns[2];
+  const int repetitions = SELECT_EVALUATIONS / batch.GetSize() + 1;
+  for (int sse = 0; sse <= 1; ++sse) {
+    masks[sse].resize(batch.GetMaskSize());
+    const double start = omp_get_wtime();
+    for (int r = 0; r < repetitions; ++r) {
+      if (sse) {
+        selector.SelectLODs(batch, camera, &masks[sse][0]);
+      } else {
+        selector.LODSelector::SelectLODs(batch, camera, &masks[sse][0]);
+      }
+    }
+    ns[sse] = (omp_get_wtime() - start) * 1e9 / repetitions / batch.GetSize();
+  }
+  printf("%-16s  %8.2f  %8.2f", name, ns[0], ns[1]);
+  if (masks[0] != masks[1]) printf("  results differ!");
+  printf("\n");
+}
+
+}
+
+void TerrainBench::BenchSelectLODs(void) {
+  const float scale = 50.0f;
+  const Terrain terrain(4, 1.0f, 7, scale, true, 3, 0, false, false);
+  // Alle Knoten des Baums in einem Batch
+  LODBatch batch;
+  for (int lod = 0; lod <= terrain.resident_lod_; ++lod) {
+    const std::vector<Tile *> &tiles = terrain.lod_tiles_[lod];
+    for (size_t t = 0; t < tiles.size(); ++t) {
+      D3DXVECTOR3 box_min, box_max;
+      tiles[t]->GetBounds(&box_min, &box_max);
+      batch.Add(tiles[t], box_min, box_max);
+    }
+  }
+  CFirstPersonCamera camera;
+  camera.SetProjParams(D3DX_PI / 4, 4.0f / 3.0f, 0.01f, 2.0f * scale);
+  D3DXVECTOR3 eye(3.0f, 20.0f, 7.0f), at(20.0f, 0.0f, 20.0f);
+  camera.SetViewParams(&eye, &at);
+
+  printf("%d tiles\n", batch.GetSize());
+  printf("selector          per tile    SSE  (ns)\n");
+  const DynamicLODSelector grid_spacing(D3DX_PI / 4, 600, 2.0f);
+  BenchSelector(grid_spacing, batch, &camera, "grid spacing");
+  const DynamicLODSelector geometric(D3DX_PI / 4, 600, 2.0f,
+                                     DynamicLODSelector::GEOMETRIC_ERROR);
+  BenchSelector(geometric, batch, &camera, "geometric error");
+  const FixedLODSelector fixed(4);
+  BenchSelector(fixed, batch, &camera, "fixed");
+}
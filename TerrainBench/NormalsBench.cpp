@@ -0,0 +1,57 @@
+#include "stdafx.h"
+#include <vector>
+#include <omp.h>
+#include "TerrainBench.h"
+#include "IndexedNormals.h"
+#include "Terrain.h"
+#include "Tile.h"
+
+namespace {
+
+/**
+ * Wiederholungen je Messung, gewertet wird die schnellste
+ */
+const int NORMALS_REPETITIONS = 5;
+
+}
+
+void TerrainBench::BenchNormals(void) {
+  // Ein einzelnes Tile mit 1025 x 1025 Vertices, Dreiecke wie früher aus
+  // dem Index Buffer von TriangulateLines
+  Terrain terrain(10, 1.0f, 1, 100.0f, false, 7, 0, false, false);
+  terrain.TriangulateLines();
+  Tile *tile = terrain.tile_;
+  const int size = tile->size_;
+  std::vector<float> heights(size * size);
+  for (int i = 0; i < size * size; ++i) heights[i] = tile->GetHeight(i);
+  std::vector<D3DXVECTOR3> normals(size * size);
+  const float d = tile->scale_ / (size - 1);
+
+  double indexed = 0.0;
+  for (int r = 0; r < NORMALS_REPETITIONS; ++r) {
+    const double start = omp_get_wtime();
+    CalculateIndexedNormals(&heights[0], size, size, d, terrain.indices_,
+                            terrain.num_indices_ / 3, &normals[0]);
+    const double seconds = omp_get_wtime() - start;
+    if (r == 0 || seconds < indexed) indexed = seconds;
+  }
+  printf("%d x %d tile, indexed: %.1f ms\n", size, size, indexed * 1e3);
+
+  printf("threads  grid (ms)  speedup\n");
+  const int max_threads = omp_get_max_threads();
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    omp_set_num_threads(threads);
+    double grid = 0.0;
+    for (int r = 0; r < NORMALS_REPETITIONS; ++r) {
+      const double start = omp_get_wtime();
+      tile->CalculateNormals();
+      const double seconds = omp_get_wtime() - start;
+      if (r == 0 || seconds < grid) grid = seconds;
+    }
+    printf("%7d  %9.1f  %6.1fx\n", threads, grid * 1e3, indexed / grid);
+    if (threads < max_threads && 2 * threads > max_threads) {
+      threads = max_threads / 2;
+    }
+  }
+  omp_set_num_threads(max_threads);
+}
@@ -0,0 +1,55 @@
+#include "stdafx.h"
+#include <cstring>
+#include <vector>
+#include <omp.h>
+#include "TerrainBench.h"
+#include "TileGenerator.h"
+
+namespace {
+
+/**
+ * Anzahl der Samples, die je Messung mindestens verfeinert werden
+ */
+const double REFINE_SAMPLES = 1 << 25;
+
+}
+
+void TerrainBench::BenchRefine(void) {
+  const bool has_sse = TileGenerator::use_sse_;
+  if (!has_sse) {
+    printf("SSE4.1 not available, measuring the scalar path only\n");
+  }
+  printf("   n    scalar    SSE4.1  (Msamples/s)\n");
+  for (int n = 6; n <= 11; ++n) {
+    const TileGenerator generator(7, n, 1.0f, 50.0f);
+    const int size = generator.GetSize();
+    std::vector<float> tile(size * size);
+    generator.Generate(1, 0, 0, &tile[0]);
+    // Jeder Aufruf berechnet die ungeraden Samples aus den geraden neu, das
+    // Ergebnis ist also bei jeder Wiederholung dasselbe
+    const double new_samples = 0.75 * size * size;
+    const int repetitions = static_cast<int>(REFINE_SAMPLES / new_samples) + 1;
+
+    double rates[2] = { 0, 0 };
+    std::vector<float> results[2];
+    for (int sse = 0; sse <= (has_sse ? 1 : 0); ++sse) {
+      TileGenerator::use_sse_ = sse != 0;
+      std::vector<float> heights(tile);
+      const double start = omp_get_wtime();
+      for (int i = 0; i < repetitions; ++i) {
+        generator.Refine(&heights[0], 1, 0, 0, 2);
+      }
+      const double seconds = omp_get_wtime() - start;
+      rates[sse] = new_samples * repetitions / seconds / 1e6;
+      results[sse].swap(heights);
+    }
+    TileGenerator::use_sse_ = has_sse;
+
+    printf("%4d  %8.1f  %8.1f", n, rates[0], rates[1]);
+    if (has_sse && memcmp(&results[0][0], &results[1][0],
+                          results[0].size() * sizeof(float)) != 0) {
+      printf("  results differ!");
+    }
+    printf("\n");
+  }
+}
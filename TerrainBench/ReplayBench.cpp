@@ -0,0 +1,76 @@
+#include "stdafx.h"
+#include <cmath>
+#include <omp.h>
+#include "TerrainBench.h"
+#include "DynamicLODSelector.h"
+#include "Terrain.h"
+
+namespace {
+
+/**
+ * Bilder des Kamerapfads
+ */
+const int REPLAY_FRAMES = 600;
+/**
+ * Öffnungswinkel und Bildhöhe wie in TerrainRenderer
+ */
+const float REPLAY_FOV = D3DX_PI / 4;
+const int REPLAY_SCREEN_HEIGHT = 600;
+
+/**
+ * Setzt die Kamera auf Bild frame des Pfads: eine Runde über das Terrain
+ * (Seitenlänge scale) auf einem Kreis um die Mitte, knapp über dem Boden,
+ * mit Blick in Flugrichtung und leicht nach unten.
+ */
+void SetReplayCamera(const Terrain &terrain, float scale, int frame,
+                     CFirstPersonCamera *camera) {
+  const float angle = 2.0f * D3DX_PI * frame / REPLAY_FRAMES;
+  const float radius = 0.3f * scale;
+  D3DXVECTOR3 eye(radius * cosf(angle), 0.0f, radius * sinf(angle));
+  eye.y = terrain.GetHeightAt(eye) + 0.02f * scale;
+  D3DXVECTOR3 at = eye + D3DXVECTOR3(-sinf(angle), -0.2f, cosf(angle));
+  camera->SetViewParams(&eye, &at);
+}
+
+}
+
+void TerrainBench::BenchReplay(void) {
+  const float scale = 50.0f;
+  CFirstPersonCamera camera;
+  camera.SetProjParams(REPLAY_FOV, 4.0f / 3.0f, 0.01f, 2.0f * scale);
+  DynamicLODSelector selector(REPLAY_FOV, REPLAY_SCREEN_HEIGHT, 2.0f);
+
+  printf("mode   ms/frame   max  visited  culled   drawn  tests  split  "
+         "merged  balanced\n");
+  for (int lazy = 0; lazy <= 1; ++lazy) {
+    // Ohne D3D10-Device; BuildRenderList braucht keine Buffer
+    Terrain terrain(5, 1.0f, 6, scale, true, 42, lazy ? 512 : 0, false,
+                    false);
+    Terrain::RenderList list;
+    Terrain::CullingStats sum = Terrain::CullingStats();
+    double total = 0.0, max = 0.0;
+    for (int frame = 0; frame < REPLAY_FRAMES; ++frame) {
+      SetReplayCamera(terrain, scale, frame, &camera);
+      const double start = omp_get_wtime();
+      terrain.BuildRenderList(&selector, &camera, true, &list);
+      const double seconds = omp_get_wtime() - start;
+      total += seconds;
+      if (seconds > max) max = seconds;
+      const Terrain::CullingStats &stats = terrain.GetCullingStats();
+      sum.tiles_visited += stats.tiles_visited;
+      sum.tiles_culled += stats.tiles_culled;
+      sum.tiles_drawn += stats.tiles_drawn;
+      sum.lod_tests += stats.lod_tests;
+      sum.tiles_split += stats.tiles_split;
+      sum.tiles_merged += stats.tiles_merged;
+      sum.tiles_balanced += stats.tiles_balanced;
+    }
+    // Statistik je Bild gemittelt
+    const float n = static_cast<float>(REPLAY_FRAMES);
+    printf("%-5s  %8.3f  %5.2f  %7.1f  %6.1f  %6.1f  %5.1f  %5.2f  %6.2f  "
+           "%8.2f\n", lazy ? "lazy" : "eager", total * 1e3 / REPLAY_FRAMES,
+           max * 1e3, sum.tiles_visited / n, sum.tiles_culled / n,
+           sum.tiles_drawn / n, sum.lod_tests / n, sum.tiles_split / n,
+           sum.tiles_merged / n, sum.tiles_balanced / n);
+  }
+}
@@ -0,0 +1,82 @@
+#include "stdafx.h"
+#include <vector>
+#include <omp.h>
+#include "TerrainBench.h"
+#include "Random.h"
+#include "Terrain.h"
+#include "Tile.h"
+
+namespace {
+
+/**
+ * Anzahl der Abfragepunkte je Messung
+ */
+const int RESIDENT_QUERIES = 1 << 20;
+
+}
+
+const Tile *TerrainBench::FindResidentTile(const Tile *tile, float x,
+                                           float z) {
+  if (tile->lod_ == tile->terrain_->resident_lod_) return tile;
+  // Wie Tile::GetHeightAt nach Quadranten absteigen
+  const float mid_x = 0.5f * tile->scale_ + tile->translation_.x;
+  const float mid_z = 0.5f * tile->scale_ + tile->translation_.y;
+  const int dir = (x < mid_x ? 0 : 1) | (z < mid_z ? 0 : 2);
+  return FindResidentTile(tile->children_[dir], x, z);
+}
+
+void TerrainBench::BenchResidentTile(void) {
+  printf("levels  index (ns)  descent (ns)  GetHeightAt index/descent (ns)\n");
+  const int levels[] = { 5, 8 };
+  for (int l = 0; l < 2; ++l) {
+    const float scale = 100.0f;
+    const Terrain terrain(3, 1.0f, levels[l], scale, false, 42, 0, false,
+                          false);
+    std::vector<float> xs(RESIDENT_QUERIES), zs(RESIDENT_QUERIES);
+    const Random random(42, 0);
+    for (int i = 0; i < RESIDENT_QUERIES; ++i) {
+      const Random point(random, i, 0);
+      xs[i] = point.GetSignedFloat(0) * 0.5f * scale;
+      zs[i] = point.GetSignedFloat(1) * 0.5f * scale;
+    }
+    const std::vector<Tile *> &tiles =
+        terrain.lod_tiles_[terrain.resident_lod_];
+
+    // Nur das Auffinden des Tiles, die Summe verhindert, dass der Compiler
+    // die Schleifen verwirft
+    size_t check[2] = { 0, 0 };
+    double start = omp_get_wtime();
+    for (int i = 0; i < RESIDENT_QUERIES; ++i) {
+      check[0] += reinterpret_cast<size_t>(
+          tiles[terrain.GetResidentTileIndex(xs[i], zs[i])]);
+    }
+    const double index = omp_get_wtime() - start;
+    start = omp_get_wtime();
+    for (int i = 0; i < RESIDENT_QUERIES; ++i) {
+      check[1] += reinterpret_cast<size_t>(
+          FindResidentTile(terrain.tile_, xs[i], zs[i]));
+    }
+    const double descent = omp_get_wtime() - start;
+
+    // Ganze Höhenabfrage über den Index bzw. vom Wurzel-Tile aus
+    float sums[2] = { 0.0f, 0.0f };
+    start = omp_get_wtime();
+    for (int i = 0; i < RESIDENT_QUERIES; ++i) {
+      sums[0] += terrain.GetHeightAt(D3DXVECTOR3(xs[i], 0.0f, zs[i]));
+    }
+    const double height_index = omp_get_wtime() - start;
+    start = omp_get_wtime();
+    for (int i = 0; i < RESIDENT_QUERIES; ++i) {
+      sums[1] += terrain.tile_->GetHeightAt(D3DXVECTOR3(xs[i], 0.0f, zs[i]));
+    }
+    const double height_descent = omp_get_wtime() - start;
+
+    const double ns = 1e9 / RESIDENT_QUERIES;
+    printf("%6d  %10.1f  %12.1f  %14.1f / %.1f", levels[l], index * ns,
+           descent * ns, height_index * ns, height_descent * ns);
+    if (check[0] != check[1] || sums[0] != sums[1]) {
+      printf("  results differ!");
+    }
+    printf("\n");
+  }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+class Tile;
+
+/**
+ * Laufzeitmessungen der Terrain-Klassen aus TerrainRenderer, ohne
+ * D3D10-Device. Die Messungen sind statische Methoden dieser Klasse, damit
+ * sie als friend (siehe Tile, Terrain, TileGenerator) auch interne
+ * Schritte einzeln messen können. Gemessen wird mit omp_get_wtime, die
+ * Ergebnisse werden als Tabelle ausgegeben.
+ */
+class TerrainBench {
+ public:
+  /**
+   * Samples pro Sekunde von TileGenerator::Refine (Blockgröße 2) in der
+   * skalaren und der SSE4.1-Variante für Tiles mit n = 6 bis 11, auf einem
+   * Thread. Prüft dabei, dass beide bitgenau dieselben Höhen liefern.
+   */
+  static void BenchRefine(void);
+
+  /**
+   * Laufzeit von Tile::CalculateNormals für ein Tile mit 1025 x 1025
+   * Vertices mit 1, 2, 4, ... Threads bis omp_get_max_threads(), im
+   * Vergleich zur früheren indexbasierten Berechnung (siehe
+   * CalculateIndexedNormals, ohne den Aufbau des Index Buffers).
+   */
+  static void BenchNormals(void);
+
+  /**
+   * Dauer je Punkt, das Tile der untersten residenten LOD-Stufe zu finden:
+   * mit Terrain::GetResidentTileIndex und durch Abstieg vom Wurzel-Tile
+   * (wie früher Tile::GetHeightAt), für Terrains mit 5 und 8 LOD-Stufen.
+   * Misst außerdem die ganze Höhenabfrage auf beiden Wegen.
+   */
+  static void BenchResidentTile(void);
+
+  /**
+   * Spielt einen festen Kamerapfad (CFirstPersonCamera, eine Runde knapp
+   * über dem Terrain) mit Terrain::BuildRenderList ab, ohne D3D10-Device,
+   * für ein Terrain mit allen LOD-Stufen im Voraus und im Lazy-Modus. Gibt
+   * die mittlere und maximale Dauer je Bild und die über die Bilder
+   * gemittelte Terrain::CullingStats aus.
+   */
+  static void BenchReplay(void);
+
+  /**
+   * Dauer je Tile von SelectLODs für DynamicLODSelector (beide Metriken) und
+   * FixedLODSelector, mit SSE und mit der Standard-Implementierung
+   * (IsLODSufficient je Tile), für alle Knoten eines Terrains mit 7
+   * LOD-Stufen in einem LODBatch.
+   */
+  static void BenchSelectLODs(void);
+
+ private:
+  /**
+   * Steigt von tile nach Quadranten bis zur untersten residenten LOD-Stufe
+   * ab und gibt das Tile zurück, das (x, z) enthält.
+   */
+  static const Tile *FindResidentTile(const Tile *tile, float x, float z);
+};
@@ -0,0 +1,34 @@
+// main.cpp : Definiert den Einstiegspunkt für die Konsolenanwendung.
+//
+
+#include "stdafx.h"
+#include "TerrainBench.h"
+
+int _tmain(int argc, _TCHAR* argv[])
+{
+  struct Benchmark {
+    const _TCHAR *name;
+    void (*run)(void);
+  };
+  const Benchmark benchmarks[] = {
+    { _T("refine"), TerrainBench::BenchRefine },
+    { _T("normals"), TerrainBench::BenchNormals },
+    { _T("resident"), TerrainBench::BenchResidentTile },
+    { _T("replay"), TerrainBench::BenchReplay },
+    { _T("select"), TerrainBench::BenchSelectLODs },
+  };
+
+  // Ohne Argumente alle Messungen, sonst nur die angegebenen
+  const int num_benchmarks =
+      static_cast<int>(sizeof(benchmarks) / sizeof(benchmarks[0]));
+  for (int i = 0; i < num_benchmarks; ++i) {
+    bool selected = argc < 2;
+    for (int arg = 1; arg < argc; ++arg) {
+      if (_tcscmp(argv[arg], benchmarks[i].name) == 0) selected = true;
+    }
+    if (!selected) continue;
+    _tprintf(_T("%s\n"), benchmarks[i].name);
+    benchmarks[i].run();
+  }
+  return 0;
+}
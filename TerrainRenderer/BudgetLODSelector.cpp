@@ -0,0 +1,14 @@
+#include "BudgetLODSelector.h"
+#include "Terrain.h"
+
+BudgetLODSelector::BudgetLODSelector(float fov_y, int screen_height,
+                                     int budget, Unit unit, Metric metric)
+    : DynamicLODSelector(fov_y, screen_height, 0, metric),
+      budget_(budget),
+      unit_(unit) {
+}
+
+void BudgetLODSelector::Prepare(Terrain *terrain, const CBaseCamera *camera) {
+  SetMaxError(terrain->GetScreenErrorForBudget(*this, camera, budget_,
+                                               unit_ == TRIANGLES));
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "DynamicLODSelector.h"
+
+/**
+ * LOD-Auswahl mit fester Obergrenze für die Anzahl der gezeichneten Tiles
+ * bzw. Dreiecke statt eines festen Bildschirmfehlers. Vor jeder Auswahl
+ * wird das Terrain gierig nach Bildschirmfehler verfeinert, bis die
+ * Obergrenze erreicht ist (siehe Terrain::GetScreenErrorForBudget); der
+ * dabei erreichte Fehler dient dann als zulässiger Fehler der
+ * DynamicLODSelector-Auswahl. Aufwand auf CPU und GPU bleiben so je Bild
+ * begrenzt, der Fehler schwankt stattdessen.
+ */
+class BudgetLODSelector : public DynamicLODSelector {
+ public:
+  /**
+   * Einheit der Obergrenze. Dreiecke werden je Tile gezählt, wie es ohne
+   * Stitching gezeichnet würde, also auch mit Terrain::SetSimplification
+   * (siehe Terrain::GetNumTriangles).
+   */
+  enum Unit { TILES, TRIANGLES };
+
+  /**
+   * Konstruktor.
+   * @param budget Höchstzahl der Tiles bzw. Dreiecke in der Sichtpyramide
+   * @param metric Fehlermaß (siehe DynamicLODSelector)
+   */
+  BudgetLODSelector(float fov_y, int screen_height, int budget,
+                    Unit unit = TILES, Metric metric = GRID_SPACING);
+
+  virtual void Prepare(Terrain *terrain, const CBaseCamera *camera);
+
+  /**
+   * Gibt den bei der letzten Auswahl erreichten Bildschirmfehler in Pixeln
+   * zurück.
+   */
+  float GetAchievedError(void) const { return GetMaxError(); }
+
+ private:
+  const int budget_;
+  const Unit unit_;
+};
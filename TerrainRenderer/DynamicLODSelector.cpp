@@ -1,5 +1,7 @@
 #include <algorithm>
 #include <cmath>
+#include <limits>
+#include <xmmintrin.h>
 #include "DynamicLODSelector.h"
 #include "Tile.h"
 
@@ -8,15 +10,41 @@
 
 DynamicLODSelector::DynamicLODSelector(float fov_y,
                                        int screen_height,
-                                       float max_error) {
-  factor_ = 2 * std::tan(fov_y / 2) * max_error / (float)screen_height;
+                                       float max_error,
+                                       Metric metric)
+    : pixel_size_(2 * std::tan(fov_y / 2) / (float)screen_height),
+      metric_(metric) {
+  SetMaxError(max_error);
 }
 
 DynamicLODSelector::~DynamicLODSelector(void) {
 }
 
+void DynamicLODSelector::SetMaxError(float max_error) {
+  max_error_ = max_error;
+}
+
 bool DynamicLODSelector::IsLODSufficient(const Tile *tile,
                                          const CBaseCamera *camera) const {
+  return GetScreenError(tile, camera) <= max_error_;
+}
+
+float DynamicLODSelector::GetScreenError(const Tile *tile,
+                                         const CBaseCamera *camera) const {
+  const float error = GetError(tile);
+  if (error == 0) return 0;
+  const float min_z = GetNearestZ(tile, camera);
+  if (min_z <= 0) return std::numeric_limits<float>::max();
+  return error / (pixel_size_ * min_z);
+}
+
+float DynamicLODSelector::GetError(const Tile *tile) const {
+  return metric_ == GEOMETRIC_ERROR ? tile->GetGeometricError() :
+                                      tile->GetWorldError();
+}
+
+float DynamicLODSelector::GetNearestZ(const Tile *tile,
+                                      const CBaseCamera *camera) const {
   D3DXVECTOR3 bbox[8];
   tile->GetBoundingBox(bbox, NULL);
   D3DXVec3TransformCoordArray(bbox, sizeof(D3DXVECTOR3),
@@ -31,6 +59,90 @@ bool DynamicLODSelector::IsLODSufficient(const Tile *tile,
       min_z = bbox[i].z;
     }
   }
-  float max_world_error = factor_ * min_z;
-  return tile->GetWorldError() <= max_world_error;
+  return min_z;
+}
+
+void DynamicLODSelector::SelectLODs(const LODBatch &batch,
+                                    const CBaseCamera *camera,
+                                    unsigned int *sufficient) const {
+  std::fill(sufficient, sufficient + batch.GetMaskSize(), 0u);
+  // Die View-Matrix ist affin (w = 1), die Division von
+  // D3DXVec3TransformCoord entfällt
+  const D3DXMATRIX &view = *camera->GetViewMatrix();
+  const __m128 pixel_size = _mm_set1_ps(pixel_size_);
+  const __m128 max_error = _mm_set1_ps(max_error_);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 unbounded = _mm_set1_ps(std::numeric_limits<float>::max());
+  const std::vector<float> &error =
+      metric_ == GEOMETRIC_ERROR ? batch.geometric_error : batch.world_error;
+  for (int i = 0; i < batch.GetSize(); i += LODBatch::WIDTH) {
+    // Bits aufgefüllter Tiles am Ende löschen
+    const int valid = (1 << std::min(batch.GetSize() - i,
+                                     static_cast<int>(LODBatch::WIDTH))) - 1;
+    const __m128 world_error = _mm_loadu_ps(&error[i]);
+    const __m128 no_error = _mm_cmpeq_ps(world_error, zero);
+    if (_mm_movemask_ps(no_error) == 0xf) {
+      // Wie GetScreenError ohne Transformation der Boxen (z.B. die Tiles
+      // der feinsten Stufe beim geometrischen Fehler)
+      if (max_error_ >= 0.0f) {
+        sufficient[i / 32] |= static_cast<unsigned int>(valid) << (i % 32);
+      }
+      continue;
+    }
+
+    const __m128 x[2] = { _mm_loadu_ps(&batch.min_x[i]),
+                          _mm_loadu_ps(&batch.max_x[i]) };
+    const __m128 y[2] = { _mm_loadu_ps(&batch.min_y[i]),
+                          _mm_loadu_ps(&batch.max_y[i]) };
+    const __m128 z[2] = { _mm_loadu_ps(&batch.min_z[i]),
+                          _mm_loadu_ps(&batch.max_z[i]) };
+    // Beiträge der Koordinaten zu den View-Koordinaten (vx, vy, vz), je
+    // für die minimale und die maximale Koordinate der Boxen
+    __m128 x_to[2][3], y_to[2][3], z_to[2][3];
+    for (int k = 0; k < 2; ++k) {
+      for (int j = 0; j < 3; ++j) {
+        x_to[k][j] = _mm_mul_ps(x[k], _mm_set1_ps(view.m[0][j]));
+        y_to[k][j] = _mm_mul_ps(y[k], _mm_set1_ps(view.m[1][j]));
+        z_to[k][j] = _mm_mul_ps(z[k], _mm_set1_ps(view.m[2][j]));
+      }
+    }
+    const __m128 offset[3] = { _mm_set1_ps(view._41), _mm_set1_ps(view._42),
+                               _mm_set1_ps(view._43) };
+
+    // Nächstgelegene Ecke, in der Reihenfolge von Tile::GetBoundingBox
+    __m128 min_dist_sq, min_z;
+    for (int corner = 0; corner < 8; ++corner) {
+      const int xi = (corner >> 1) & 1, yi = corner >> 2, zi = corner & 1;
+      __m128 v[3];
+      for (int j = 0; j < 3; ++j) {
+        v[j] = _mm_add_ps(_mm_add_ps(_mm_add_ps(x_to[xi][j], y_to[yi][j]),
+                                     z_to[zi][j]),
+                          offset[j]);
+      }
+      const __m128 dist_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(v[0], v[0]),
+                                                   _mm_mul_ps(v[1], v[1])),
+                                        _mm_mul_ps(v[2], v[2]));
+      if (corner == 0) {
+        min_dist_sq = dist_sq;
+        min_z = v[2];
+      } else {
+        const __m128 closer = _mm_cmplt_ps(dist_sq, min_dist_sq);
+        min_dist_sq = _mm_min_ps(dist_sq, min_dist_sq);
+        min_z = _mm_or_ps(_mm_and_ps(closer, v[2]),
+                          _mm_andnot_ps(closer, min_z));
+      }
+    }
+
+    // Bildschirmfehler wie in GetScreenError, die Fallunterscheidungen
+    // über Masken
+    const __m128 in_front = _mm_cmpgt_ps(min_z, zero);
+    __m128 screen_error = _mm_div_ps(world_error,
+                                     _mm_mul_ps(pixel_size, min_z));
+    screen_error = _mm_or_ps(_mm_and_ps(in_front, screen_error),
+                             _mm_andnot_ps(in_front, unbounded));
+    screen_error = _mm_andnot_ps(no_error, screen_error);
+    const __m128 ok = _mm_cmple_ps(screen_error, max_error);
+    sufficient[i / 32] |=
+        static_cast<unsigned int>(_mm_movemask_ps(ok) & valid) << (i % 32);
+  }
 }
@@ -3,17 +3,77 @@
 
 class DynamicLODSelector : public LODSelector {
  public:
-  DynamicLODSelector(float fov_y, int screen_height, float max_error);
+  /**
+   * Fehlermaß der Tiles, das auf höchstens max_error Pixel projiziert
+   * werden darf
+   */
+  enum Metric {
+    /**
+     * Abstand der Gitterpunkte (Tile::GetWorldError), unabhängig vom
+     * Terrain
+     */
+    GRID_SPACING,
+    /**
+     * Geometrischer Fehler (Tile::GetGeometricError): flache Bereiche
+     * werden gröber dargestellt als zerklüftete
+     */
+    GEOMETRIC_ERROR
+  };
+
+  DynamicLODSelector(float fov_y, int screen_height, float max_error,
+                     Metric metric = GRID_SPACING);
   ~DynamicLODSelector(void);
 
   virtual bool IsLODSufficient(const Tile *tile,
                                const CBaseCamera *camera) const;
 
+  /**
+   * Wie IsLODSufficient, mit SSE für je vier Tiles: Die Ecken der Boxen
+   * werden Koordinate für Koordinate transformiert, jede Rechnung also für
+   * vier Tiles gleichzeitig, in derselben Reihenfolge wie bei
+   * IsLODSufficient.
+   */
+  virtual void SelectLODs(const LODBatch &batch, const CBaseCamera *camera,
+                          unsigned int *sufficient) const;
+
+  /**
+   * Gibt den Fehler des Tiles in Pixeln zurück, projiziert auf die
+   * View-Space-Tiefe der nächsten Ecke der Bounding-Box. Die LOD-Stufe
+   * reicht aus, wenn der Wert höchstens GetMaxError() ist. Liegt die
+   * nächste Ecke der Bounding-Box nicht vor der Kamera, ist er beliebig
+   * groß (außer für Tiles ohne Fehler).
+   */
+  float GetScreenError(const Tile *tile, const CBaseCamera *camera) const;
+
+  /**
+   * Gibt den zulässigen Fehler in Pixeln zurück.
+   */
+  float GetMaxError(void) const { return max_error_; }
+
+ protected:
+  /**
+   * Setzt den zulässigen Fehler in Pixeln.
+   */
+  void SetMaxError(float max_error);
+
  private:
   /**
-   * delta = factor_ * tau * z;
-   * delta: World Space Error
-   * tau: Auf View Plan proj. World Space Error
+   * Gibt das Fehlermaß metric_ des Tiles zurück.
+   */
+  float GetError(const Tile *tile) const;
+
+  /**
+   * Gibt die View-Space-z-Koordinate der Ecke der Bounding-Box des Tiles
+   * zurück, die der Kamera am nächsten liegt.
+   */
+  float GetNearestZ(const Tile *tile, const CBaseCamera *camera) const;
+
+  /**
+   * Größe eines Pixels im Abstand 1 vor der Kamera: Ein Fehler delta im
+   * Abstand z erscheint auf dem Bildschirm delta / (pixel_size_ * z)
+   * Pixel groß.
    */
-  float factor_;
+  const float pixel_size_;
+  float max_error_;
+  Metric metric_;
 };
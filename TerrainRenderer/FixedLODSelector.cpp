@@ -1,9 +1,35 @@
+#include <algorithm>
+#include <emmintrin.h>
 #include "FixedLODSelector.h"
 #include "Tile.h"
 
+#undef min
+#undef max
+
 bool FixedLODSelector::IsLODSufficient(const Tile *tile,
                                        const CBaseCamera *camera) const {
-  return tile->GetLOD() == lod_;
+  // Auch tiefere Stufen reichen aus, damit ein LOD-Schnitt, der von einer
+  // feineren Auswahl kommt, wieder zusammengefasst wird (siehe
+  // Terrain::UpdateLODCut)
+  return tile->GetLOD() >= lod_;
+}
+
+void FixedLODSelector::SelectLODs(const LODBatch &batch,
+                                  const CBaseCamera *camera,
+                                  unsigned int *sufficient) const {
+  std::fill(sufficient, sufficient + batch.GetMaskSize(), 0u);
+  const __m128i lod = _mm_set1_epi32(lod_);
+  for (int i = 0; i < batch.GetSize(); i += LODBatch::WIDTH) {
+    const __m128i tile_lod =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(&batch.lod[i]));
+    // tile_lod >= lod_, d.h. nicht tile_lod < lod_
+    const int too_coarse =
+        _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(tile_lod, lod)));
+    const int valid = (1 << std::min(batch.GetSize() - i,
+                                     static_cast<int>(LODBatch::WIDTH))) - 1;
+    sufficient[i / 32] |=
+        static_cast<unsigned int>(~too_coarse & valid) << (i % 32);
+  }
 }
 
 FixedLODSelector::FixedLODSelector(int lod) : lod_(lod) {
@@ -13,6 +13,8 @@ class FixedLODSelector : public LODSelector {
   FixedLODSelector(int lod);
   virtual bool IsLODSufficient(const Tile *tile,
                                const CBaseCamera *camera) const;
+  virtual void SelectLODs(const LODBatch &batch, const CBaseCamera *camera,
+                          unsigned int *sufficient) const;
  private:
   void operator=(const FixedLODSelector &);
 
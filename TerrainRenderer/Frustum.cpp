@@ -0,0 +1,56 @@
+#include "Frustum.h"
+
+Frustum::Frustum(const D3DXMATRIX &view_projection) {
+  SetPlanes(view_projection);
+}
+
+Frustum::Frustum(const CBaseCamera *camera) {
+  D3DXMATRIX view_projection;
+  D3DXMatrixMultiply(&view_projection, camera->GetViewMatrix(),
+                     camera->GetProjMatrix());
+  SetPlanes(view_projection);
+}
+
+void Frustum::SetPlanes(const D3DXMATRIX &view_projection) {
+  // Ebenen direkt aus den Spalten der Matrix (Gribb/Hartmann): ein Punkt p
+  // liegt im Frustum, wenn für (x, y, z, w) = p * view_projection gilt
+  // -w <= x <= w, -w <= y <= w, 0 <= z <= w.
+  const D3DXMATRIX &m = view_projection;
+  planes_[0] = D3DXPLANE(m._14 + m._11, m._24 + m._21, m._34 + m._31,
+                         m._44 + m._41);
+  planes_[1] = D3DXPLANE(m._14 - m._11, m._24 - m._21, m._34 - m._31,
+                         m._44 - m._41);
+  planes_[2] = D3DXPLANE(m._14 + m._12, m._24 + m._22, m._34 + m._32,
+                         m._44 + m._42);
+  planes_[3] = D3DXPLANE(m._14 - m._12, m._24 - m._22, m._34 - m._32,
+                         m._44 - m._42);
+  planes_[4] = D3DXPLANE(m._13, m._23, m._33, m._43);
+  planes_[5] = D3DXPLANE(m._14 - m._13, m._24 - m._23, m._34 - m._33,
+                         m._44 - m._43);
+  for (int i = 0; i < NUM_PLANES; ++i) {
+    D3DXPlaneNormalize(&planes_[i], &planes_[i]);
+  }
+}
+
+Frustum::Result Frustum::Test(const D3DXVECTOR3 &box_min,
+                              const D3DXVECTOR3 &box_max,
+                              unsigned int *plane_mask) const {
+  for (int i = 0; i < NUM_PLANES; ++i) {
+    const unsigned int bit = 1 << i;
+    if ((*plane_mask & bit) == 0) continue;
+    const D3DXPLANE &plane = planes_[i];
+    // Ecke der Box, die am weitesten auf der Innenseite liegt ...
+    const float inner = plane.a * (plane.a >= 0 ? box_max.x : box_min.x) +
+                        plane.b * (plane.b >= 0 ? box_max.y : box_min.y) +
+                        plane.c * (plane.c >= 0 ? box_max.z : box_min.z) +
+                        plane.d;
+    if (inner < 0) return OUTSIDE;
+    // ... und die gegenüberliegende Ecke
+    const float outer = plane.a * (plane.a >= 0 ? box_min.x : box_max.x) +
+                        plane.b * (plane.b >= 0 ? box_min.y : box_max.y) +
+                        plane.c * (plane.c >= 0 ? box_min.z : box_max.z) +
+                        plane.d;
+    if (outer >= 0) *plane_mask &= ~bit;
+  }
+  return *plane_mask == 0 ? INSIDE : INTERSECTING;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "DXUT.h"
+#include "DXUTCamera.h"
+
+/**
+ * Sichtpyramide (View Frustum) aus sechs Ebenen, für das Culling
+ * achsenparalleler Bounding-Boxen.
+ *
+ * Für hierarchisches Culling führt jeder Test eine Ebenenmaske mit: Liegt
+ * eine Box vollständig auf der Innenseite einer Ebene, liegen auch alle
+ * Boxen darin (z.B. die der Kind-Tiles) innen, und die Ebene wird aus der
+ * Maske gelöscht. Die Kinder testen dann nur noch die verbliebenen Ebenen,
+ * Teilbäume vollständig im Frustum gar keine mehr.
+ */
+class Frustum {
+ public:
+  enum {
+    NUM_PLANES = 6,
+    /**
+     * Maske aller Ebenen, für den Test der Wurzel
+     */
+    ALL_PLANES = (1 << NUM_PLANES) - 1
+  };
+
+  /**
+   * Ergebnis von Test
+   */
+  enum Result { OUTSIDE = 0, INTERSECTING, INSIDE };
+
+  /**
+   * Konstruktor. Bestimmt die Ebenen aus der View-Projection-Matrix
+   * (D3D-Konvention 0 <= z <= w, Normalen zeigen nach innen).
+   */
+  explicit Frustum(const D3DXMATRIX &view_projection);
+
+  /**
+   * Konstruktor. Bestimmt die Ebenen aus View- und Projection-Matrix der
+   * Kamera.
+   */
+  explicit Frustum(const CBaseCamera *camera);
+
+  /**
+   * Testet die Box [box_min, box_max] gegen die Ebenen in *plane_mask.
+   * Ebenen, auf deren Innenseite die Box vollständig liegt, werden aus
+   * *plane_mask gelöscht.
+   * @return OUTSIDE, wenn die Box vollständig außerhalb einer Ebene liegt,
+   *         INSIDE, wenn keine Ebene mehr zu testen ist, sonst INTERSECTING
+   */
+  Result Test(const D3DXVECTOR3 &box_min, const D3DXVECTOR3 &box_max,
+              unsigned int *plane_mask) const;
+
+ private:
+  /**
+   * Bestimmt die Ebenen aus der View-Projection-Matrix.
+   */
+  void SetPlanes(const D3DXMATRIX &view_projection);
+
+  /**
+   * Links, rechts, unten, oben, nah, fern
+   */
+  D3DXPLANE planes_[NUM_PLANES];
+};
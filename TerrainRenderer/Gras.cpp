@@ -1,5 +1,6 @@
 #include <cmath>
 #include "Gras.h"
+#include "Random.h"
 
 ID3D10InputLayout* Gras::vertex_layout_ = NULL;
 ID3D10EffectTechnique* Gras::technique_ = NULL;
@@ -23,7 +24,8 @@ void Gras::ReleaseBuffers(void) {
 
 void Gras::PlaceSeed(const D3DXVECTOR3 &position,
                      float normalized_height,
-                     const D3DXVECTOR3 &normal) {
+                     const D3DXVECTOR3 &normal,
+                     const Random &random) {
   if (normalized_height < 0.05f) return;
   float slope = 1.0f - normal.y; // 0 = plain, 1 = steep face
 
@@ -82,12 +84,11 @@ void Gras::PlaceSeed(const D3DXVECTOR3 &position,
 
   float prob = std::exp(-0.5f*std::pow((normalized_height-0.3f)*8.0f, 2)) *
     std::pow(std::cos(slope*D3DX_PI)*0.5f+0.5f, 4);
-  float random = (float)std::rand() / RAND_MAX;
-  if (random <= prob) {
+  if (random.GetFloat(0) <= prob) {
     SEED seed = {
       position,
-      ((float)std::rand() / RAND_MAX) * D3DX_PI,
-      ((float)std::rand() / RAND_MAX) * 0.1f + 0.15f,
+      random.GetFloat(1) * D3DX_PI,
+      random.GetFloat(2) * 0.1f + 0.15f,
       normal
     };
     seeds_.push_back(seed);
@@ -9,7 +9,8 @@ class Gras : public Vegetation {
 
   virtual void PlaceSeed(const D3DXVECTOR3 &position,
                          float normalized_height,
-                         const D3DXVECTOR3 &normal);
+                         const D3DXVECTOR3 &normal,
+                         const Random &random);
   virtual HRESULT CreateBuffers(ID3D10Device *device);
   virtual void GetShaderHandles(ID3D10Effect *effect);
   virtual void Draw(void);
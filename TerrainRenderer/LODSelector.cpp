@@ -0,0 +1,57 @@
+#include <algorithm>
+#include "LODSelector.h"
+#include "Tile.h"
+
+void LODBatch::Clear(void) {
+  size_ = 0;
+  min_x.clear();
+  min_y.clear();
+  min_z.clear();
+  max_x.clear();
+  max_y.clear();
+  max_z.clear();
+  world_error.clear();
+  geometric_error.clear();
+  lod.clear();
+  tiles.clear();
+}
+
+int LODBatch::Add(const Tile *tile, const D3DXVECTOR3 &box_min,
+                  const D3DXVECTOR3 &box_max) {
+  const int index = size_++;
+  if (index % WIDTH == 0) {
+    // Nächste Gruppe von WIDTH Tiles anlegen
+    const size_t padded = index + WIDTH;
+    min_x.resize(padded, 0.0f);
+    min_y.resize(padded, 0.0f);
+    min_z.resize(padded, 0.0f);
+    max_x.resize(padded, 0.0f);
+    max_y.resize(padded, 0.0f);
+    max_z.resize(padded, 0.0f);
+    world_error.resize(padded, 0.0f);
+    geometric_error.resize(padded, 0.0f);
+    lod.resize(padded, 0);
+    tiles.resize(padded, NULL);
+  }
+  min_x[index] = box_min.x;
+  min_y[index] = box_min.y;
+  min_z[index] = box_min.z;
+  max_x[index] = box_max.x;
+  max_y[index] = box_max.y;
+  max_z[index] = box_max.z;
+  world_error[index] = tile->GetWorldError();
+  geometric_error[index] = tile->GetGeometricError();
+  lod[index] = tile->GetLOD();
+  tiles[index] = tile;
+  return index;
+}
+
+void LODSelector::SelectLODs(const LODBatch &batch, const CBaseCamera *camera,
+                             unsigned int *sufficient) const {
+  std::fill(sufficient, sufficient + batch.GetMaskSize(), 0u);
+  for (int i = 0; i < batch.GetSize(); ++i) {
+    if (IsLODSufficient(batch.tiles[i], camera)) {
+      sufficient[i / 32] |= 1u << (i % 32);
+    }
+  }
+}
@@ -1,11 +1,75 @@
 #pragma once
+#include <vector>
 #include "DXUT.h"
 #include "DXUTCamera.h"
 
+class Terrain;
 class Tile;
 
 /**
- * Strategie fr die Bestimmung der anzuzeigenden LOD-Stufe.
+ * Mehrere Tiles für eine gemeinsame LOD-Auswahl (siehe
+ * LODSelector::SelectLODs). Bounding-Boxen, Fehler und LOD-Stufen liegen
+ * als Struct of Arrays vor, damit je WIDTH Tiles mit einem SSE-Register
+ * bearbeitet werden können. Die Felder sind dazu immer auf ein Vielfaches
+ * von WIDTH aufgefüllt (mit Nullen bzw. NULL).
+ */
+class LODBatch {
+ public:
+  enum { WIDTH = 4 };
+
+  LODBatch(void) : size_(0) {}
+
+  /**
+   * Leert den Batch, der Speicher bleibt reserviert.
+   */
+  void Clear(void);
+
+  /**
+   * Fügt ein Tile mit seiner Bounding-Box [box_min, box_max] an.
+   * @return Index des Tiles im Batch (und Bit in der Ausgabe von
+   *         LODSelector::SelectLODs)
+   */
+  int Add(const Tile *tile, const D3DXVECTOR3 &box_min,
+          const D3DXVECTOR3 &box_max);
+
+  /**
+   * Gibt die Anzahl der Tiles zurück.
+   */
+  int GetSize(void) const { return size_; }
+
+  /**
+   * Gibt die Anzahl der Wörter der Bitmaske für SelectLODs zurück.
+   */
+  int GetMaskSize(void) const { return (size_ + 31) / 32; }
+
+  /**
+   * Prüft Bit index der Bitmaske mask.
+   */
+  static bool IsSet(const unsigned int *mask, int index) {
+    return (mask[index / 32] & (1u << (index % 32))) != 0;
+  }
+
+  /**
+   * Bounding-Boxen
+   */
+  std::vector<float> min_x, min_y, min_z, max_x, max_y, max_z;
+  /**
+   * Fehlermaße der Tiles (siehe Tile::GetWorldError und
+   * Tile::GetGeometricError)
+   */
+  std::vector<float> world_error, geometric_error;
+  /**
+   * LOD-Stufen der Tiles
+   */
+  std::vector<int> lod;
+  std::vector<const Tile *> tiles;
+
+ private:
+  int size_;
+};
+
+/**
+ * Strategie für die Bestimmung der anzuzeigenden LOD-Stufe.
  */
 class LODSelector {
  public:
@@ -15,4 +79,21 @@ class LODSelector {
    */
   virtual bool IsLODSufficient(const Tile *tile,
                                const CBaseCamera *camera) const = 0;
+
+  /**
+   * Wie IsLODSufficient, für alle Tiles von batch auf einmal. Bit i von
+   * sufficient wird gesetzt, wenn die LOD-Stufe von Tile i ausreicht.
+   * Die Standard-Implementierung ruft IsLODSufficient für jedes Tile auf.
+   * @param sufficient Feld für batch.GetMaskSize() Wörter
+   */
+  virtual void SelectLODs(const LODBatch &batch, const CBaseCamera *camera,
+                          unsigned int *sufficient) const;
+
+  /**
+   * Wird von Terrain::BuildRenderList aufgerufen, bevor der LOD-Schnitt an
+   * eine neue Kamera angepasst wird. Für Strategien, die dazu das ganze
+   * Terrain betrachten (z.B. BudgetLODSelector); die Standard-
+   * Implementierung tut nichts.
+   */
+  virtual void Prepare(Terrain *terrain, const CBaseCamera *camera) {}
 };
@@ -12,7 +12,7 @@ class LightSource {
       : color_(color), rotation_(rotation) {};
   virtual ~LightSource(void) {};
   /**
-   * Fhrt Per-Frame-Updates an der Lichtquelle aus (Rotation).
+   * Führt Per-Frame-Updates an der Lichtquelle aus (Rotation).
    */
   virtual void OnFrameMove(float elapsed_time) = 0;
   virtual HRESULT OnCreateDevice(ID3D10Device *device) { return S_OK; };
@@ -0,0 +1,144 @@
+#pragma once
+#include <cmath>
+#include <emmintrin.h>
+#include "DXUT.h"
+
+/**
+ * Kodierung von Normalen in 32 Bit (Oktaeder-Abbildung).
+ *
+ * Die Normale wird auf den Oktaeder |x| + |y| + |z| = 1 projiziert, die
+ * untere Hälfte (y < 0) wird über die Diagonalen nach außen geklappt. Die
+ * verbleibenden Koordinaten x und z werden mit je 16 Bit (vorzeichenbehaftet
+ * normiert) gespeichert, x in den unteren, z in den oberen 16 Bit. Der
+ * Winkelfehler liegt unter 0,05 Grad.
+ *
+ * Das Terrain-Shader-Gegenstück ist DecodeNormal in TerrainRenderer.fx.
+ */
+class PackedNormal {
+ public:
+  /**
+   * Kodiert die Normale normal. Sie muss nicht normiert sein, da die
+   * Projektion auf den Oktaeder ohnehin durch die Betragssumme teilt.
+   */
+  static unsigned int Encode(const D3DXVECTOR3 &normal) {
+    const float sum = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+    if (sum <= 0.0f) return Pack(0.0f, 0.0f);
+    float x = normal.x / sum;
+    float z = normal.z / sum;
+    if (normal.y < 0.0f) {
+      const float fx = (1.0f - fabsf(z)) * (x >= 0.0f ? 1.0f : -1.0f);
+      const float fz = (1.0f - fabsf(x)) * (z >= 0.0f ? 1.0f : -1.0f);
+      x = fx;
+      z = fz;
+    }
+    return Pack(x, z);
+  }
+
+  /**
+   * Kodiert vier Normalen gleichzeitig (SSE2). Liefert bitgenau dieselben
+   * Werte wie Encode.
+   */
+  static void Encode4(const D3DXVECTOR3 *normals, unsigned int *packed) {
+    __m128 x = _mm_setr_ps(normals[0].x, normals[1].x, normals[2].x,
+                           normals[3].x);
+    const __m128 y = _mm_setr_ps(normals[0].y, normals[1].y, normals[2].y,
+                                 normals[3].y);
+    __m128 z = _mm_setr_ps(normals[0].z, normals[1].z, normals[2].z,
+                           normals[3].z);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(sign_mask, x),
+                                             _mm_andnot_ps(sign_mask, y)),
+                                  _mm_andnot_ps(sign_mask, z));
+    // Nullvektoren ergeben (0, 0)
+    const __m128 valid = _mm_cmpgt_ps(sum, zero);
+    x = _mm_and_ps(_mm_div_ps(x, sum), valid);
+    z = _mm_and_ps(_mm_div_ps(z, sum), valid);
+    // Untere Hälfte nach außen klappen
+    const __m128 lower = _mm_cmplt_ps(y, zero);
+    const __m128 sign_x = _mm_or_ps(one, _mm_andnot_ps(_mm_cmpge_ps(x, zero),
+                                                       sign_mask));
+    const __m128 sign_z = _mm_or_ps(one, _mm_andnot_ps(_mm_cmpge_ps(z, zero),
+                                                       sign_mask));
+    const __m128 fx = _mm_mul_ps(
+        _mm_sub_ps(one, _mm_andnot_ps(sign_mask, z)), sign_x);
+    const __m128 fz = _mm_mul_ps(
+        _mm_sub_ps(one, _mm_andnot_ps(sign_mask, x)), sign_z);
+    x = _mm_or_ps(_mm_and_ps(lower, fx), _mm_andnot_ps(lower, x));
+    z = _mm_or_ps(_mm_and_ps(lower, fz), _mm_andnot_ps(lower, z));
+    const __m128i qx = Quantize4(x);
+    const __m128i qz = Quantize4(z);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(packed), _mm_or_si128(
+        _mm_and_si128(qx, _mm_set1_epi32(0xffff)), _mm_slli_epi32(qz, 16)));
+  }
+
+  /**
+   * Dekodiert eine mit Encode kodierte Normale.
+   */
+  static D3DXVECTOR3 Decode(unsigned int packed) {
+    D3DXVECTOR3 out[4];
+    const unsigned int in[4] = { packed, packed, packed, packed };
+    Decode4(in, out);
+    return out[0];
+  }
+
+  /**
+   * Dekodiert vier Normalen gleichzeitig (SSE2).
+   */
+  static void Decode4(const unsigned int *packed, D3DXVECTOR3 *out) {
+    const __m128i p =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed));
+    const __m128 scale = _mm_set1_ps(1.0f / 32767.0f);
+    const __m128 minus_one = _mm_set1_ps(-1.0f);
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    // Untere bzw. obere 16 Bit mit Vorzeichen erweitern
+    __m128 x = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(p, 16), 16));
+    __m128 z = _mm_cvtepi32_ps(_mm_srai_epi32(p, 16));
+    x = _mm_max_ps(_mm_mul_ps(x, scale), minus_one);
+    z = _mm_max_ps(_mm_mul_ps(z, scale), minus_one);
+    // y = 1 - |x| - |z|, für y < 0 zurückklappen: |x| -= -y, |z| -= -y
+    const __m128 abs_x = _mm_andnot_ps(sign_mask, x);
+    const __m128 abs_z = _mm_andnot_ps(sign_mask, z);
+    const __m128 y = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), abs_x), abs_z);
+    const __m128 t = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), y),
+                                _mm_setzero_ps());
+    x = _mm_sub_ps(x, _mm_or_ps(t, _mm_and_ps(x, sign_mask)));
+    z = _mm_sub_ps(z, _mm_or_ps(t, _mm_and_ps(z, sign_mask)));
+    // Normieren
+    const __m128 inv_length = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+                   _mm_mul_ps(z, z))));
+    x = _mm_mul_ps(x, inv_length);
+    const __m128 ny = _mm_mul_ps(y, inv_length);
+    z = _mm_mul_ps(z, inv_length);
+    float xs[4], ys[4], zs[4];
+    _mm_storeu_ps(xs, x);
+    _mm_storeu_ps(ys, ny);
+    _mm_storeu_ps(zs, z);
+    for (int i = 0; i < 4; ++i) out[i] = D3DXVECTOR3(xs[i], ys[i], zs[i]);
+  }
+
+ private:
+  /**
+   * Speichert x und z (jeweils zwischen -1 und 1) mit je 16 Bit.
+   */
+  static unsigned int Pack(float x, float z) {
+    const int qx = static_cast<int>(floorf(x * 32767.0f + 0.5f));
+    const int qz = static_cast<int>(floorf(z * 32767.0f + 0.5f));
+    return (static_cast<unsigned int>(qx) & 0xffff) |
+           (static_cast<unsigned int>(qz) << 16);
+  }
+
+  /**
+   * Vierfache Variante der Quantisierung in Pack (floor(v * 32767 + 0,5)).
+   */
+  static __m128i Quantize4(__m128 v) {
+    const __m128 t = _mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(32767.0f)),
+                                _mm_set1_ps(0.5f));
+    const __m128i i = _mm_cvttps_epi32(t);
+    // Abschneiden rundet negative Werte auf, dann um eins korrigieren
+    return _mm_add_epi32(i, _mm_castps_si128(
+        _mm_cmpgt_ps(_mm_cvtepi32_ps(i), t)));
+  }
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+/**
+ * Zufallsströme des Terrains. Jeder Strom liefert unabhängige Zufallszahlen,
+ * so dass z.B. das Hinzufügen eines Baums die Vegetation nicht verändert.
+ */
+enum RandomStream {
+  RANDOM_STREAM_HEIGHTS = 0,
+  RANDOM_STREAM_TREES,
+  RANDOM_STREAM_VEGETATION
+};
+
+/**
+ * Zustandsloser, zählerbasierter Zufallsgenerator.
+ * Eine Instanz ist nur ein Schlüssel, der aus Startwert und weiteren
+ * Koordinaten (z.B. LOD-Stufe und Zeile) abgeleitet wird. Die eigentliche
+ * Zufallszahl wird durch Hashen von Schlüssel und Index berechnet. Dadurch
+ * lässt sich jede Zufallszahl unabhängig von allen anderen (und damit in
+ * beliebiger Reihenfolge oder parallel) berechnen, und ein Startwert ergibt
+ * immer exakt dieselbe Welt.
+ */
+class Random {
+ public:
+  /**
+   * Konstruktor.
+   * @param seed Startwert
+   * @param stream Zufallsstrom (siehe RandomStream)
+   */
+  Random(unsigned int seed, unsigned int stream)
+      : key_(Mix(Mix(seed) + stream * 0x9e3779b9)) {
+  }
+
+  /**
+   * Leitet einen Unterschlüssel für die Koordinaten (a, b) ab.
+   */
+  Random(const Random &parent, unsigned int a, unsigned int b)
+      : key_(Mix(Mix(parent.key_ + a * 0x9e3779b9) + b * 0x85ebca6b)) {
+  }
+
+  /**
+   * Gibt den Schlüssel zurück (für vektorisierte Implementierungen, die
+   * Random::Get selbst nachbilden).
+   */
+  unsigned int GetKey(void) const { return key_; }
+
+  /**
+   * Liefert die index-te Zufallszahl als 32-Bit-Wert.
+   */
+  unsigned int Get(unsigned int index) const {
+    return Mix(key_ ^ (index * 0x9e3779b9));
+  }
+
+  /**
+   * Liefert die index-te Zufallszahl als Fließkommazahl zwischen 0 und 1.
+   */
+  float GetFloat(unsigned int index) const {
+    return (Get(index) >> 8) * (1.0f / (1 << 24));
+  }
+
+  /**
+   * Liefert die index-te Zufallszahl als Fließkommazahl zwischen -1 und 1.
+   */
+  float GetSignedFloat(unsigned int index) const {
+    return (Get(index) >> 8) * (2.0f / (1 << 24)) - 1.0f;
+  }
+
+  /**
+   * Mischt die Bits eines 32-Bit-Werts (Finalizer aus MurmurHash3).
+   */
+  static unsigned int Mix(unsigned int h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+  }
+
+ private:
+  unsigned int key_;
+};
@@ -52,6 +52,12 @@ void Scene::SetMaterial(float ambient, float diffuse, float specular,
   pMaterialParameters->SetFloatVector(material_parameters);
 }
 
+void Scene::SetLODSelector(LODSelector *lod_selector) {
+  lod_selector_ = lod_selector;
+  // Der neue LODSelector kann an der Adresse des alten liegen
+  if (terrain_) terrain_->InvalidateLODCut();
+}
+
 void Scene::AddPointLight(const D3DXVECTOR3 &position,
                           const D3DXVECTOR3 &color,
                           const D3DXVECTOR3 &rotation,
@@ -215,10 +221,15 @@ void Scene::SetShadowMapPrecision(bool high_precision) {
     shadowed_directional_light_->SetShadowMapPrecision(high_precision);
 }
 
-void Scene::CreateTerrain(int n, float roughness, int num_lod, float scale) {
+void Scene::CreateTerrain(int n, float roughness, int num_lod, float scale,
+                          unsigned int seed, size_t max_cached_tiles,
+                          bool residual_heights, bool quantized_heights,
+                          Terrain::Triangulation triangulation) {
   SAFE_DELETE(terrain_);
-  terrain_ = new Terrain(n, roughness, num_lod, scale, true);
-  terrain_->TriangulateZOrder();
+  terrain_ = new Terrain(n, roughness, num_lod, scale, true, seed,
+                         max_cached_tiles, residual_heights,
+                         quantized_heights);
+  terrain_->Triangulate(triangulation);
   if (device_)
     terrain_->CreateBuffers(device_);
   if (effect_)
@@ -247,7 +258,7 @@ void Scene::Draw(ID3D10EffectTechnique *technique, bool shadow_pass) {
     environment_->Draw();
   }
   if (terrain_) {
-    terrain_->DrawVegetation(shadow_pass);
+    terrain_->DrawVegetation(camera_, shadow_pass);
   }
 }
 
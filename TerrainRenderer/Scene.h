@@ -2,10 +2,10 @@
 #include <vector>
 #include "DXUT.h"
 #include "LightSource.h"
+#include "Terrain.h"
 
 class Environment;
 class CFirstPersonCamera;
-class Terrain;
 class LODSelector;
 class ShadowedDirectionalLight;
 class ShadowedPointLight;
@@ -33,7 +33,7 @@ class Scene {
   void SetCamera(CFirstPersonCamera *camera) { camera_ = camera; }
   CFirstPersonCamera *GetCamera(void) { return camera_; }
 
-  void SetLODSelector(LODSelector *lod_selector) { lod_selector_ = lod_selector; }
+  void SetLODSelector(LODSelector *lod_selector);
   LODSelector *GetLODSelector(void) { return lod_selector_; }
 
   /**
@@ -56,16 +56,27 @@ class Scene {
                     float cutoff_angle, float exponent);
 
   /**
-   * Erzeugt ein neues Terrain mit den bergebenen Parametern und bereitet es auf
+   * Erzeugt ein neues Terrain mit den übergebenen Parametern und bereitet es auf
    * das Rendering vor.
+   * @param max_cached_tiles 0 oder Größe des Tile-Caches im Lazy-Modus (siehe
+   *                         Terrain::Terrain)
+   * @param residual_heights Residual-Speicherung der Höhenwerte (siehe
+   *                         Terrain::Terrain)
+   * @param quantized_heights 16-Bit-Speicherung der Höhenwerte (siehe
+   *                          Terrain::Terrain)
+   * @param triangulation Triangulierung der Tiles (siehe
+   *                      Terrain::Triangulate)
    */
-  void CreateTerrain(int n, float roughness, int num_lod, float scale);
+  void CreateTerrain(int n, float roughness, int num_lod, float scale,
+                     unsigned int seed, size_t max_cached_tiles,
+                     bool residual_heights, bool quantized_heights,
+                     Terrain::Triangulation triangulation);
   Terrain *GetTerrain(void) { return terrain_; }
 
   void GetBoundingBox(D3DXVECTOR3 *box, D3DXVECTOR3 *mid);
 
   /**
-   * Fhrt Per-Frame-Updates in der Szene aus
+   * Führt Per-Frame-Updates in der Szene aus
    */
   void OnFrameMove(float elapsed_time);
 
@@ -82,7 +93,7 @@ class Scene {
 
  private:
    /**
-   * Smtliche Lichtquellen in der Szene
+   * Sämtliche Lichtquellen in der Szene
    */
   std::vector<LightSource *> light_sources_;
   ShadowedPointLight *shadowed_point_light_;
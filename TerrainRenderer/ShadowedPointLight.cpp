@@ -166,7 +166,7 @@ void ShadowedPointLight::OnFrameMove(float elapsed_time) {
 
   // Unsere Textur als Depth-Stencil-Target setzen
   device_->OMSetRenderTargets(0, NULL, depth_stencil_view_);
-  // Inhalt zurcksetzen
+  // Inhalt zurücksetzen
   device_->ClearDepthStencilView(depth_stencil_view_, D3D10_CLEAR_DEPTH, 1.0f, 0);
 
   // Viewport setzen
@@ -7,7 +7,7 @@ class SpotLight : public LightSource {
    * Konstruktor.
    * Erzeugt eine neue Scheinwerfer-Lichtquelle an einer bestimmten Start-
    * position, mit bestimmter Richtung, Farbe und Rotationsgeschwindigkeit,
-   * ffnungswinkel und Abfall-Exponenten.
+   * Öffnungswinkel und Abfall-Exponenten.
    */
   SpotLight(const D3DXVECTOR3 &position, const D3DXVECTOR3 &direction,
             const D3DXVECTOR3 &color, const D3DXVECTOR3 &rotation,
@@ -1,10 +1,30 @@
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include "Terrain.h"
+#include "DynamicLODSelector.h"
+#include "Frustum.h"
+#include "LODSelector.h"
 #include "Tile.h"
+#include "TileGenerator.h"
+#include "TileArena.h"
+#include "VertexCache.h"
 #include "SDKmesh.h"
 #include "Gras.h"
+#include "Random.h"
 
 const UINT NUM_SEEDS = 1000000;
+// Anzahl der Vegetations-Keime, die zusammen abgefragt werden
+const UINT SEED_BATCH_SIZE = 65536;
+// Anzahl der Abfragen, die Terrain::QueryAt am Stck bearbeitet
+const size_t QUERY_BLOCK_SIZE = 16384;
+// Anzahl der im Lazy-Modus im Voraus erzeugten LOD-Stufen
+const int LAZY_RESIDENT_LOD = 2;
+// Breite der Bnder von Terrain::TriangulateStrips (in Zellen). Die
+// 2*(7+1) Vertices einer Zeile passen gerade in einen FIFO-Cache mit 16
+// Eintrgen; bei breiteren Bndern verdrngt jede Zeile die Vertices, die
+// die nchste wieder braucht.
+const int STRIP_BAND_CELLS = 7;
 
 // Makro, um die Indexberechnungen fr das "flachgeklopfte" 2D-Array von
 // Vertices zu vereinfachen
@@ -13,20 +33,53 @@ const UINT NUM_SEEDS = 1000000;
 namespace {
 
 /**
- * Generiert zufllige Fliekommazahl zwischen -1 und 1
+ * Verteilt die unteren 16 Bit von v auf die geraden Bits (fr die
+ * Morton-Codes in CutEntry::code).
  */
-inline float randf(void) {
-  return rand() / (RAND_MAX * 0.5f) - 1.0f;
+unsigned int SpreadBits(unsigned int v) {
+  v &= 0x0000ffff;
+  v = (v | (v << 8)) & 0x00ff00ff;
+  v = (v | (v << 4)) & 0x0f0f0f0f;
+  v = (v | (v << 2)) & 0x33333333;
+  v = (v | (v << 1)) & 0x55555555;
+  return v;
+}
+
+/**
+ * Umkehrung von SpreadBits: sammelt die geraden Bits von v.
+ */
+unsigned int CompactBits(unsigned int v) {
+  v &= 0x55555555;
+  v = (v | (v >> 1)) & 0x33333333;
+  v = (v | (v >> 2)) & 0x0f0f0f0f;
+  v = (v | (v >> 4)) & 0x00ff00ff;
+  v = (v | (v >> 8)) & 0x0000ffff;
+  return v;
 }
 
 }
 
-Terrain::Terrain(int n, float roughness, int num_lod, float scale, bool water)
-    : size_((1 << n) + 1),
+Terrain::Terrain(int n, float roughness, int num_lod, float scale, bool water,
+                 unsigned int seed, size_t max_cached_tiles,
+                 bool residual_heights, bool quantized_heights)
+    : seed_(seed),
+      resident_lod_(max_cached_tiles > 0 && num_lod > LAZY_RESIDENT_LOD ?
+                    LAZY_RESIDENT_LOD : num_lod),
+      max_cached_tiles_(max_cached_tiles),
+      draw_count_(0),
+      culling_stats_(),
+      cut_lod_selector_(NULL),
+      stitching_(true),
+      simplification_(-1.0f),
+      residual_heights_(residual_heights),
+      size_((1 << n) + 1),
       device_(NULL),
       vertex_layout_(NULL),
       vertex_buffer_(NULL),
       index_buffer_(NULL),
+      // 16 Bit, wenn alle Vertices (und der Strip-Cut-Index) passen
+      index_format_(size_ * size_ <= 0xffff ? DXGI_FORMAT_R16_UINT :
+                                              DXGI_FORMAT_R32_UINT),
       tile_scale_ev_(NULL),
       tile_translate_ev_(NULL),
       tile_lod_ev_(NULL),
@@ -34,37 +87,173 @@ Terrain::Terrain(int n, float roughness, int num_lod, float scale, bool water)
       terrain_size_ev_(NULL),
       technique_(NULL),
       indices_(NULL),
+      num_indices_(0),
+      strips_(false),
       mesh_vertex_layout_(NULL),
       mesh_texture_ev_(NULL),
       mesh_pass_(NULL),
       mesh_shadow_pass_(NULL),
       tree_buffer_(NULL) {
-  tile_ = new Tile(this, n, roughness, num_lod, scale, water);
+  // Die Morton-Codes des LOD-Schnitts (CutEntry::code) haben 32 Bit
+  assert(num_lod < 16);
+  generator_ = new TileGenerator(seed, n, roughness, scale);
+  arena_ = new TileArena(size_, Tile::GetNumStoredHeights(size_,
+                                                          residual_heights),
+                         resident_lod_, quantized_heights);
+  tile_ = new Tile(this, n, num_lod, scale, water);
+  InitTiles();
+  tile_->CalculateHeights();
   mesh_[0] = mesh_[1] = NULL;
   mesh_texture_srv_[0] = mesh_texture_srv_[1] = NULL;
-  InitMeshes();
 }
 
 Terrain::~Terrain(void) {
   SAFE_DELETE(indices_);
   SAFE_DELETE(tile_);
+  SAFE_DELETE(arena_);
+  SAFE_DELETE(generator_);
   SAFE_DELETE(mesh_[0]);
   SAFE_DELETE(mesh_[1]);
   ReleaseBuffers();
 }
 
-void Terrain::InitMeshes(void) {
+void Terrain::InitTiles(void) {
+  lod_tiles_.clear();
+  lod_tiles_.resize(resident_lod_ + 1);
+  lod_tiles_[0].push_back(tile_);
+
+  for (int lod = 1; lod <= resident_lod_; ++lod) {
+    const int num_tiles_1d = 1 << lod;
+    std::vector<Tile *> &parents = lod_tiles_[lod - 1];
+    std::vector<Tile *> &tiles = lod_tiles_[lod];
+    tiles.resize(num_tiles_1d * num_tiles_1d);
+
+    // Kind-Tiles anlegen und in das Raster der Stufe einsortieren
+    for (size_t i = 0; i < parents.size(); ++i) {
+      parents[i]->CreateChildren();
+      for (int dir = 0; dir < 4; ++dir) {
+        Tile *child = parents[i]->children_[dir];
+        tiles[child->tile_y_ * num_tiles_1d + child->tile_x_] = child;
+      }
+    }
+
+    // Jedes Tile hngt hier nur von seinem Eltern-Tile ab
+    const int num_tiles = static_cast<int>(tiles.size());
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < num_tiles; ++i) {
+      tiles[i]->Generate();
+    }
+  }
+}
+
+void Terrain::CalculateNormals(void) {
+  std::vector<Tile *> tiles;
+  for (size_t lod = 0; lod < lod_tiles_.size(); ++lod) {
+    tiles.insert(tiles.end(), lod_tiles_[lod].begin(), lod_tiles_[lod].end());
+  }
+  for (size_t i = 0; i < lazy_parents_.size(); ++i) {
+    tiles.insert(tiles.end(), lazy_parents_[i]->children_,
+                 lazy_parents_[i]->children_ + 4);
+  }
+  const int num_tiles = static_cast<int>(tiles.size());
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < num_tiles; ++i) {
+    tiles[i]->CalculateNormals();
+  }
+}
+
+void Terrain::LoadChildren(Tile *parent) {
+  if (parent->lod_ < resident_lod_) return;
+  parent->last_used_ = draw_count_;
+  if (parent->HasChildren()) return;
+
+  parent->CreateChildren();
+#pragma omp parallel for
+  for (int dir = 0; dir < 4; ++dir) {
+    Tile *child = parent->children_[dir];
+    child->Generate();
+    child->CalculateHeights();
+    // Die Nachbarn mssen dazu nicht existieren
+    child->CalculateNormals();
+  }
+  if (device_) {
+    for (int dir = 0; dir < 4; ++dir) {
+      parent->children_[dir]->CreateBuffers(device_);
+    }
+  }
+  // Der geometrische Fehler von parent ist jetzt nicht mehr geschtzt, die
+  // Vorfahren mssen ihn weiterhin einschlieen
+  Tile *tile = parent;
+  while (tile != NULL && tile->UpdateGeometricError()) tile = tile->parent_;
+  // Ebenso die Hhen der Kinder, sonst wren die Bounding-Boxen fr
+  // LOD-Auswahl und Culling zu klein
+  tile = parent;
+  while (tile != NULL && tile->UpdateHeightBounds()) tile = tile->parent_;
+  lazy_parents_.push_back(parent);
+}
+
+void Terrain::TrimCache(void) {
+  while (4 * lazy_parents_.size() > max_cached_tiles_) {
+    // ltestes Tile suchen, dessen Kinder selbst keine Kinder haben. Kinder
+    // werden beim Zeichnen nach ihren Eltern benutzt, also nie vor ihnen
+    // verdrngt.
+    size_t oldest = lazy_parents_.size();
+    for (size_t i = 0; i < lazy_parents_.size(); ++i) {
+      Tile *parent = lazy_parents_[i];
+      if (parent->last_used_ == draw_count_) continue;
+      bool has_grandchildren = false;
+      for (int dir = 0; dir < 4; ++dir) {
+        if (parent->children_[dir]->HasChildren()) has_grandchildren = true;
+      }
+      if (has_grandchildren) continue;
+      if (oldest == lazy_parents_.size() ||
+          parent->last_used_ < lazy_parents_[oldest]->last_used_) {
+        oldest = i;
+      }
+    }
+    if (oldest == lazy_parents_.size()) break;
+
+    Tile *parent = lazy_parents_[oldest];
+    TileArena::Block blocks[4];
+    for (int dir = 0; dir < 4; ++dir) {
+      blocks[dir].heights = parent->children_[dir]->heights_;
+      blocks[dir].quantized_heights =
+          parent->children_[dir]->quantized_heights_;
+      blocks[dir].normals = parent->children_[dir]->vertex_normals_;
+      SAFE_DELETE(parent->children_[dir]);
+    }
+    arena_->ReleaseChildBlocks(blocks);
+    lazy_parents_[oldest] = lazy_parents_.back();
+    lazy_parents_.pop_back();
+  }
+}
+
+void Terrain::GetHeightMemory(std::vector<size_t> *stored,
+                              std::vector<size_t> *full) const {
+  stored->clear();
+  full->clear();
+  tile_->GetHeightMemory(stored, full);
+}
+
+HRESULT Terrain::InitMeshes(ID3D10Device *device) {
+  HRESULT hr;
+  SAFE_DELETE(mesh_[0]);
+  SAFE_DELETE(mesh_[1]);
   mesh_[0] = new CDXUTSDKMesh();
-  mesh_[0]->Create(DXUTGetD3D10Device(), L"Meshes\\AshTree.sdkmesh");
+  V_RETURN(mesh_[0]->Create(device, L"Meshes\\AshTree.sdkmesh"));
   mesh_[1] = new CDXUTSDKMesh();
-  mesh_[1]->Create(DXUTGetD3D10Device(), L"Meshes\\Palm.sdkmesh");
+  V_RETURN(mesh_[1]->Create(device, L"Meshes\\Palm.sdkmesh"));
+  return S_OK;
 }
 
 void Terrain::InitIndexBuffer(void) {
   if (indices_ == NULL) {
     // (size_-1)^2 Blcke, pro Block 2 Dreiecke, pro Dreieck 3 Indizes
+    // (Streifen brauchen weniger Indizes)
     indices_ = new unsigned int[(size_-1)*(size_-1)*2*3];
   }
+  num_indices_ = (size_-1)*(size_-1)*2*3;
+  strips_ = false;
 }
 
 void Terrain::TriangulateLines(void) {
@@ -89,6 +278,56 @@ void Terrain::TriangulateZOrder(void) {
   TriangulateZOrder0(0, 0, size_-1, size_-1, i);
 }
 
+void Terrain::TriangulateVertexCache(void) {
+  TriangulateZOrder();
+  VertexCache::Optimize(indices_, num_indices_, size_*size_);
+}
+
+void Terrain::TriangulateStrips(void) {
+  InitIndexBuffer();
+  int i = 0;
+  for (int x1 = 0; x1 < size_ - 1; x1 += STRIP_BAND_CELLS) {
+    // Das letzte Band ist schmaler
+    const int x2 = x1 + STRIP_BAND_CELLS < size_ - 1 ?
+                   x1 + STRIP_BAND_CELLS : size_ - 1;
+    for (int y = 0; y < size_ - 1; y++) {
+      // Abwechselnd oben und unten, so entstehen dieselben Dreiecke (mit
+      // derselben Umlaufrichtung) wie bei TriangulateLines
+      for (int x = x1; x <= x2; x++) {
+        indices_[i++] = I(x, y);
+        indices_[i++] = I(x, y+1);
+      }
+      indices_[i++] = VertexCache::STRIP_CUT;
+    }
+  }
+  num_indices_ = i;
+  strips_ = true;
+}
+
+void Terrain::Triangulate(Triangulation triangulation) {
+  switch (triangulation) {
+    case LINES:
+      TriangulateLines();
+      break;
+    case Z_ORDER:
+      TriangulateZOrder();
+      break;
+    case VERTEX_CACHE:
+      TriangulateVertexCache();
+      break;
+    case STRIPS:
+      TriangulateStrips();
+      break;
+  }
+}
+
+VertexCache::Stats Terrain::GetVertexCacheStats(
+    int cache_size, VertexCache::Policy policy) const {
+  assert(indices_ != NULL);
+  return VertexCache::Measure(indices_, num_indices_, size_*size_,
+                              cache_size, policy, strips_);
+}
+
 void Terrain::TriangulateZOrder0(int x1, int y1, int x2, int y2, int &i){
   if (x1 + 1 == x2) {
     // Rekursionsabbruch, Dreiecke erzeugen
@@ -109,6 +348,142 @@ void Terrain::TriangulateZOrder0(int x1, int y1, int x2, int y2, int &i){
   }
 }
 
+void Terrain::CreateStitchedIndices(std::vector<unsigned int> *out) {
+  out->clear();
+  out->reserve(NUM_STITCH_VARIANTS * num_indices_);
+  for (int mask = 0; mask < NUM_STITCH_VARIANTS; ++mask) {
+    index_start_[mask] = static_cast<UINT>(out->size());
+    if (strips_) {
+      num_triangles_[mask] = 0;
+      for (int i = 0; i < num_indices_; ++i) {
+        out->push_back(indices_[i] == VertexCache::STRIP_CUT ?
+                       indices_[i] : StitchVertex(indices_[i], mask));
+        // Dreieck aus den letzten drei Indizes desselben Streifens
+        if (i >= 2 && indices_[i - 2] != VertexCache::STRIP_CUT &&
+            indices_[i - 1] != VertexCache::STRIP_CUT &&
+            indices_[i] != VertexCache::STRIP_CUT &&
+            !IsDegenerate(&(*out)[out->size() - 3])) {
+          ++num_triangles_[mask];
+        }
+      }
+    } else {
+      StitchTriangles(indices_, num_indices_, mask, out);
+      num_triangles_[mask] =
+          (static_cast<UINT>(out->size()) - index_start_[mask]) / 3;
+    }
+    index_count_[mask] = static_cast<UINT>(out->size()) - index_start_[mask];
+  }
+}
+
+void Terrain::StitchTriangles(const unsigned int *indices, size_t num_indices,
+                              int stitch_mask,
+                              std::vector<unsigned int> *out) const {
+  for (size_t i = 0; i < num_indices; i += 3) {
+    unsigned int triangle[3];
+    for (int k = 0; k < 3; ++k) {
+      triangle[k] = StitchVertex(indices[i + k], stitch_mask);
+    }
+    // Dreiecke, die durch das Zusammenfallen entarten (zu einem Punkt oder
+    // einer Strecke, z.B. in der SO-Ecke), entfallen
+    if (IsDegenerate(triangle)) continue;
+    out->insert(out->end(), triangle, triangle + 3);
+  }
+}
+
+bool Terrain::IsDegenerate(const unsigned int *triangle) const {
+  int x[3], y[3];
+  for (int k = 0; k < 3; ++k) {
+    x[k] = triangle[k] % size_;
+    y[k] = triangle[k] / size_;
+  }
+  return (x[1] - x[0]) * (y[2] - y[0]) == (x[2] - x[0]) * (y[1] - y[0]);
+}
+
+HRESULT Terrain::CreateIndexBuffer(const std::vector<unsigned int> &indices,
+                                   ID3D10Buffer **buffer) const {
+  HRESULT hr;
+  std::vector<unsigned short> short_indices;
+  D3D10_BUFFER_DESC buffer_desc;
+  buffer_desc.Usage = D3D10_USAGE_DEFAULT;
+  buffer_desc.BindFlags = D3D10_BIND_INDEX_BUFFER;
+  buffer_desc.CPUAccessFlags = 0;
+  buffer_desc.MiscFlags = 0;
+  D3D10_SUBRESOURCE_DATA init_data;
+  init_data.SysMemPitch = 0;
+  init_data.SysMemSlicePitch = 0;
+  if (index_format_ == DXGI_FORMAT_R16_UINT) {
+    short_indices.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+      short_indices[i] = indices[i] == VertexCache::STRIP_CUT ? 0xffff :
+                         static_cast<unsigned short>(indices[i]);
+    }
+    buffer_desc.ByteWidth =
+        static_cast<UINT>(sizeof(short_indices[0]) * short_indices.size());
+    init_data.pSysMem = &short_indices[0];
+  } else {
+    buffer_desc.ByteWidth =
+        static_cast<UINT>(sizeof(indices[0]) * indices.size());
+    init_data.pSysMem = &indices[0];
+  }
+  V_RETURN(device_->CreateBuffer(&buffer_desc, &init_data, buffer));
+  return S_OK;
+}
+
+HRESULT Terrain::GetSimplifiedMesh(Tile *tile, int stitch_mask,
+                                   ID3D10Buffer **buffer,
+                                   UINT *num_indices) {
+  HRESULT hr;
+  tile->SetSimplifiedError(simplification_);
+  std::vector<Tile::SimplifiedMesh> &meshes = tile->simplified_meshes_;
+  for (size_t i = 0; i < meshes.size(); ++i) {
+    if (meshes[i].stitch_mask == stitch_mask) {
+      *buffer = meshes[i].index_buffer;
+      *num_indices = meshes[i].num_indices;
+      return S_OK;
+    }
+  }
+
+  std::vector<unsigned int> simplified, indices;
+  tile->Simplify(simplification_, &simplified);
+  tile->simplified_triangles_ = static_cast<int>(simplified.size() / 3);
+  StitchTriangles(&simplified[0], simplified.size(), stitch_mask, &indices);
+  Tile::SimplifiedMesh mesh;
+  mesh.stitch_mask = stitch_mask;
+  mesh.num_indices = static_cast<UINT>(indices.size());
+  V_RETURN(CreateIndexBuffer(indices, &mesh.index_buffer));
+  meshes.push_back(mesh);
+  *buffer = mesh.index_buffer;
+  *num_indices = mesh.num_indices;
+  return S_OK;
+}
+
+int Terrain::GetNumTriangles(Tile *tile) {
+  if (simplification_ < 0) return GetNumTrianglesPerTile();
+  tile->SetSimplifiedError(simplification_);
+  if (tile->simplified_triangles_ < 0) {
+    std::vector<unsigned int> simplified;
+    tile->Simplify(simplification_, &simplified);
+    tile->simplified_triangles_ = static_cast<int>(simplified.size() / 3);
+  }
+  return tile->simplified_triangles_;
+}
+
+unsigned int Terrain::StitchVertex(unsigned int index,
+                                   int stitch_mask) const {
+  int x = index % size_;
+  int y = index / size_;
+  // Die Ecken sind gerade, jeder Vertex liegt also auf hchstens einer der
+  // betroffenen Kanten
+  if (((stitch_mask & STITCH_N) && y == 0) ||
+      ((stitch_mask & STITCH_S) && y == size_ - 1)) {
+    x &= ~1;
+  } else if (((stitch_mask & STITCH_W) && x == 0) ||
+             ((stitch_mask & STITCH_E) && x == size_ - 1)) {
+    y &= ~1;
+  }
+  return I(x, y);
+}
+
 HRESULT Terrain::CreateBuffers(ID3D10Device *device) {
   assert(indices_ != NULL);
   assert(tile_ != NULL);
@@ -139,16 +514,16 @@ HRESULT Terrain::CreateBuffers(ID3D10Device *device) {
   V_RETURN(device->CreateBuffer(&buffer_desc, &init_data, &vertex_buffer_));
   delete[] vertices;
 
-  // Index Buffer anlegen
-  buffer_desc.ByteWidth = sizeof(indices_[0]) * (size_-1)*(size_-1)*2*3;
-  buffer_desc.BindFlags = D3D10_BIND_INDEX_BUFFER;
-  init_data.pSysMem = indices_;
-  V_RETURN(device->CreateBuffer(&buffer_desc, &init_data, &index_buffer_));
+  // Index Buffer mit allen Varianten fr grbere Nachbarn anlegen
+  std::vector<unsigned int> indices;
+  CreateStitchedIndices(&indices);
+  V_RETURN(CreateIndexBuffer(indices, &index_buffer_));
 
-  tile_->CalculateNormals(indices_);
+  CalculateNormals();
   V_RETURN(tile_->CreateBuffers(device));
 
-  // Texturen laden
+  // Baum-Meshes und ihre Texturen laden
+  V_RETURN(InitMeshes(device));
   V_RETURN(D3DX10CreateShaderResourceViewFromFile(device_,
       L"Meshes\\AshTree.png", NULL, NULL, &mesh_texture_srv_[0], NULL));
   V_RETURN(D3DX10CreateShaderResourceViewFromFile(device_,
@@ -169,26 +544,38 @@ HRESULT Terrain::InitTrees(void) {
   float max_height = GetMaxHeight();
 
   std::vector<D3DXMATRIX> tree_transforms[2];
+  const Random trees_random(seed_, RANDOM_STREAM_TREES);
 
-  for (int i = 0; i < 250; ++i) {
-    D3DXVECTOR3 seed(randf() * 0.5f, 0, randf() * 0.5f);
-    seed *= tile_->scale_;
-    seed.y = GetHeightAt(seed);
+  // Hhen und Normalen aller Kandidaten auf einmal abfragen
+  const int num_candidates = 250;
+  std::vector<float> xs(num_candidates), zs(num_candidates);
+  std::vector<float> heights(num_candidates);
+  std::vector<D3DXVECTOR3> normals(num_candidates);
+  for (int i = 0; i < num_candidates; ++i) {
+    const Random random(trees_random, i, 0);
+    xs[i] = random.GetSignedFloat(0) * 0.5f * tile_->scale_;
+    zs[i] = random.GetSignedFloat(1) * 0.5f * tile_->scale_;
+  }
+  QueryAt(&xs[0], &zs[0], &heights[0], &normals[0], num_candidates);
+
+  for (int i = 0; i < num_candidates; ++i) {
+    const Random random(trees_random, i, 0);
+    D3DXVECTOR3 seed(xs[i], heights[i], zs[i]);
 
     // Keine Bume im Wasser
     if (seed.y < 0.05f) continue;
      // Keine Bume im Gebirge
     if (seed.y > 0.5f * max_height) continue;
 
-    D3DXVECTOR3 normal = tile_->GetNormalAt(seed);
+    const D3DXVECTOR3 &normal = normals[i];
     // Keine Bume in zu steilem Gelnde
     if (normal.x > normal.y || normal.z > normal.y) continue;
 
-    D3DXVECTOR3 scale(0, 1 + randf() * 0.5f, 0);
-    scale.x = scale.z = scale.y * (1 + randf() * 0.2f);
+    D3DXVECTOR3 scale(0, 1 + random.GetSignedFloat(2) * 0.5f, 0);
+    scale.x = scale.z = scale.y * (1 + random.GetSignedFloat(3) * 0.2f);
     scale *= tile_->scale_ * 0.05f;
     seed.y -= 0.05f * scale.y; // Wurzel in den Boden
-    float rotation = randf() * D3DX_PI;
+    float rotation = random.GetSignedFloat(4) * D3DX_PI;
     D3DXMATRIX transform, temp;
     D3DXMatrixTranslation(&transform, 0.0f, 0.5f, 0.0f);
     D3DXMatrixMultiply(&transform, &transform, D3DXMatrixScaling(&temp, scale.x, scale.y, scale.z));
@@ -238,6 +625,8 @@ void Terrain::ReleaseBuffers(void) {
   SAFE_RELEASE(mesh_vertex_layout_);
   SAFE_RELEASE(mesh_texture_srv_[0]);
   SAFE_RELEASE(mesh_texture_srv_[1]);
+  SAFE_DELETE(mesh_[0]);
+  SAFE_DELETE(mesh_[1]);
   SAFE_RELEASE(tree_buffer_);
   Gras::ReleaseStaticBuffers();
 }
@@ -296,6 +685,402 @@ void Terrain::GetBoundingBox(D3DXVECTOR3 *out, D3DXVECTOR3 *mid) const {
 
 void Terrain::Draw(ID3D10EffectTechnique *technique, LODSelector *lod_selector,
                    const CBaseCamera *camera, bool shadow_pass) {
+  BuildRenderList(lod_selector, camera, !shadow_pass, &render_list_);
+  const int triangles = DrawRenderList(technique, render_list_);
+  if (!shadow_pass) culling_stats_.triangles_drawn = triangles;
+
+  tile_scale_ev_->SetFloat(tile_->scale_);
+  tile_translate_ev_->SetFloatVector(tile_->translation_);
+  tile_heightmap_ev_->SetResource(tile_->shader_resource_view_);
+
+  if (tree_buffer_) {
+    if (mesh_[0]) DrawMesh(0, shadow_pass);
+    if (mesh_[1]) DrawMesh(1, shadow_pass);
+  }
+}
+
+void Terrain::BuildRenderList(LODSelector *lod_selector,
+                              const CBaseCamera *camera, bool culling,
+                              RenderList *list) {
+  list->clear();
+  const Frustum frustum(camera);
+  CullingStats stats = CullingStats();
+  const bool update = lod_selector != cut_lod_selector_ ||
+                      *camera->GetViewMatrix() != cut_view_ ||
+                      *camera->GetProjMatrix() != cut_proj_;
+  if (update) {
+    ++draw_count_;
+    lod_selector->Prepare(this, camera);
+    UpdateLODCut(lod_selector, camera, frustum, &stats);
+    cut_lod_selector_ = lod_selector;
+    cut_view_ = *camera->GetViewMatrix();
+    cut_proj_ = *camera->GetProjMatrix();
+  }
+  for (size_t i = 0; i < lod_cut_.size(); ++i) {
+    const CutEntry &entry = lod_cut_[i];
+    if (culling) {
+      ++stats.tiles_visited;
+      if (!entry.visible) {
+        ++stats.tiles_culled;
+        continue;
+      }
+      ++stats.tiles_drawn;
+    }
+    list->push_back(entry.item);
+  }
+  if (culling) {
+    culling_stats_.tiles_visited = stats.tiles_visited;
+    culling_stats_.tiles_culled = stats.tiles_culled;
+    culling_stats_.tiles_drawn = stats.tiles_drawn;
+    culling_stats_.lod_tests = stats.lod_tests;
+    culling_stats_.tiles_split = stats.tiles_split;
+    culling_stats_.tiles_merged = stats.tiles_merged;
+    culling_stats_.tiles_balanced = stats.tiles_balanced;
+  }
+  if (update && max_cached_tiles_ > 0) TrimCache();
+}
+
+void Terrain::UpdateLODCut(LODSelector *lod_selector,
+                           const CBaseCamera *camera, const Frustum &frustum,
+                           CullingStats *stats) {
+  if (lod_cut_.empty()) lod_cut_.push_back(MakeCutEntry(tile_));
+
+  // LOD-Auswahl fr alle Tiles des Schnitts und die Eltern-Tiles aller
+  // Geschwistergruppen (das sind hchstens size / 4, cut_parents_ wird
+  // also nicht umkopiert)
+  const size_t size = lod_cut_.size();
+  cut_parents_.clear();
+  cut_parents_.reserve(size / 4);
+  cut_tests_.clear();
+  for (size_t j = 0; j < size; ++j) {
+    if (lod_cut_[j].first_child && j + 3 < size &&
+        lod_cut_[j + 3].parent == lod_cut_[j].parent) {
+      cut_parents_.push_back(MakeCutEntry(lod_cut_[j].parent));
+      cut_tests_.push_back(&cut_parents_.back());
+    }
+    cut_tests_.push_back(&lod_cut_[j]);
+  }
+  SelectLODs(&cut_tests_[0], cut_tests_.size(), lod_selector, camera,
+             frustum, &stats->lod_tests);
+
+  next_lod_cut_.clear();
+  size_t i = 0;
+  size_t group = 0;
+  while (i < size) {
+    // Vier Geschwister im Schnitt: Zuerst das Eltern-Tile, beim Abstieg
+    // von der Wurzel wird es gezeichnet, wenn es ausreicht, egal wie es um
+    // seine Kinder steht
+    const bool siblings = lod_cut_[i].first_child && i + 3 < size &&
+                          lod_cut_[i + 3].parent == lod_cut_[i].parent;
+    if (siblings) {
+      const CutEntry &parent = cut_parents_[group++];
+      if (!parent.split) {
+        ++stats->tiles_merged;
+        AppendToCut(parent, lod_selector, camera, frustum, stats);
+        i += 4;
+        continue;
+      }
+    }
+    // Sonst das Tile selbst. Das Eltern-Tile muss dann geteilt bleiben,
+    // wenn eines der Geschwister geteilt wird.
+    const size_t end = siblings ? i + 4 : i + 1;
+    for (; i < end; ++i) {
+      const CutEntry &entry = lod_cut_[i];
+      if (entry.split) {
+        SplitIntoCut(entry.item.tile, lod_selector, camera, frustum, stats);
+      } else if (siblings) {
+        next_lod_cut_.push_back(entry);
+      } else {
+        AppendToCut(entry, lod_selector, camera, frustum, stats);
+      }
+    }
+  }
+  lod_cut_.swap(next_lod_cut_);
+  BalanceLODCut(frustum, stats);
+
+  // Die Tiles des Schnitts drfen nicht verdrngt werden
+  if (max_cached_tiles_ > 0) {
+    for (size_t j = 0; j < lod_cut_.size(); ++j) {
+      Tile *parent = lod_cut_[j].parent;
+      if (parent != NULL) parent->last_used_ = draw_count_;
+    }
+  }
+}
+
+void Terrain::AppendToCut(const CutEntry &entry, LODSelector *lod_selector,
+                          const CBaseCamera *camera, const Frustum &frustum,
+                          CullingStats *stats) {
+  next_lod_cut_.push_back(entry);
+  // Schliet das Tile vier Geschwister ab (dazwischen liegende Tiles wren
+  // Nachkommen der Geschwister)?
+  while (next_lod_cut_.back().last_child && next_lod_cut_.size() >= 4) {
+    const size_t first = next_lod_cut_.size() - 4;
+    Tile *parent_tile = next_lod_cut_.back().parent;
+    if (!next_lod_cut_[first].first_child ||
+        next_lod_cut_[first].parent != parent_tile) {
+      break;
+    }
+    CutEntry parent = MakeCutEntry(parent_tile);
+    CutEntry *test = &parent;
+    SelectLODs(&test, 1, lod_selector, camera, frustum, &stats->lod_tests);
+    if (parent.split) break;
+    ++stats->tiles_merged;
+    next_lod_cut_.resize(first);
+    next_lod_cut_.push_back(parent);
+  }
+}
+
+void Terrain::SplitIntoCut(Tile *tile, LODSelector *lod_selector,
+                           const CBaseCamera *camera, const Frustum &frustum,
+                           CullingStats *stats) {
+  // Erzeugt die Kinder bei Bedarf (nur im Lazy-Modus)
+  LoadChildren(tile);
+  ++stats->tiles_split;
+  // Die vier Kinder gemeinsam auswhlen. Das Ergebnis steht danach in
+  // children, der Batch kann beim Abstieg wiederverwendet werden.
+  CutEntry children[4];
+  CutEntry *tests[4];
+  for (int dir = 0; dir < 4; ++dir) {
+    children[dir] = MakeCutEntry(tile->children_[dir]);
+    tests[dir] = &children[dir];
+  }
+  SelectLODs(tests, 4, lod_selector, camera, frustum, &stats->lod_tests);
+  for (int dir = 0; dir < 4; ++dir) {
+    if (children[dir].split) {
+      SplitIntoCut(children[dir].item.tile, lod_selector, camera, frustum,
+                   stats);
+    } else {
+      next_lod_cut_.push_back(children[dir]);
+    }
+  }
+}
+
+Terrain::CutEntry Terrain::MakeCutEntry(Tile *tile) {
+  CutEntry entry;
+  entry.item.scale = tile->scale_;
+  entry.item.translation = tile->translation_;
+  entry.item.lod = tile->lod_;
+  entry.item.stitch_mask = 0;
+  entry.item.tile = tile;
+  entry.parent = tile->parent_;
+  tile->GetBounds(&entry.box_min, &entry.box_max);
+  entry.code = (SpreadBits(tile->tile_x_) | SpreadBits(tile->tile_y_) << 1)
+               << (2 * tile->num_lod_);
+  entry.can_split = tile->num_lod_ > 0;
+  entry.first_child = tile->parent_ != NULL && tile->direction_ == Tile::NW;
+  entry.last_child = tile->parent_ != NULL && tile->direction_ == Tile::SE;
+  entry.visible = false;
+  entry.split = false;
+  return entry;
+}
+
+void Terrain::BalanceLODCut(const Frustum &frustum, CullingStats *stats) {
+  if (!stitching_) {
+    for (size_t i = 0; i < lod_cut_.size(); ++i) {
+      lod_cut_[i].item.stitch_mask = 0;
+    }
+    return;
+  }
+
+  // stitch_mask bestimmen und dabei zu grobe sichtbare Nachbarn markieren
+  // (split). Diese werden geteilt und der Schnitt erneut geprft, bis keine
+  // mehr brig sind; danach unterscheiden sich sichtbare Nachbarn um
+  // hchstens eine Stufe, die Varianten des Index-Buffers schlieen also
+  // alle Lcken. Da der Schnitt nach Morton-Code sortiert bleibt, wenn ein
+  // Tile durch seine Kinder ersetzt wird, kann er in einem Durchlauf
+  // umgeschrieben werden.
+  static const int edges[4] = { STITCH_N, STITCH_E, STITCH_S, STITCH_W };
+  int neighbours[4];
+  for (;;) {
+    cut_codes_.resize(lod_cut_.size());
+    for (size_t i = 0; i < lod_cut_.size(); ++i) {
+      cut_codes_[i] = lod_cut_[i].code;
+    }
+    bool balanced = true;
+    for (size_t i = 0; i < lod_cut_.size(); ++i) {
+      CutEntry &entry = lod_cut_[i];
+      GetCutNeighbours(static_cast<int>(i), neighbours);
+      entry.item.stitch_mask = 0;
+      for (int k = 0; k < 4; ++k) {
+        if (neighbours[k] < 0) continue;
+        CutEntry &neighbour = lod_cut_[neighbours[k]];
+        if (neighbour.item.lod >= entry.item.lod) continue;
+        entry.item.stitch_mask |= edges[k];
+        if (entry.visible && neighbour.visible &&
+            neighbour.item.lod < entry.item.lod - 1) {
+          neighbour.split = true;
+          balanced = false;
+        }
+      }
+    }
+    if (balanced) break;
+
+    next_lod_cut_.clear();
+    for (size_t i = 0; i < lod_cut_.size(); ++i) {
+      const CutEntry &entry = lod_cut_[i];
+      if (!entry.split) {
+        next_lod_cut_.push_back(entry);
+        continue;
+      }
+      Tile *tile = entry.item.tile;
+      LoadChildren(tile);
+      ++stats->tiles_balanced;
+      for (int dir = 0; dir < 4; ++dir) {
+        CutEntry child = MakeCutEntry(tile->children_[dir]);
+        unsigned int plane_mask = Frustum::ALL_PLANES;
+        child.visible = frustum.Test(child.box_min, child.box_max,
+                                     &plane_mask) != Frustum::OUTSIDE;
+        next_lod_cut_.push_back(child);
+      }
+    }
+    lod_cut_.swap(next_lod_cut_);
+  }
+}
+
+void Terrain::GetCutNeighbours(int index, int neighbours[4]) const {
+  const int num_lod = tile_->num_lod_;
+  const unsigned int cells = 1u << num_lod;
+  const unsigned int size = 1u << (num_lod - lod_cut_[index].item.lod);
+  const unsigned int x = CompactBits(cut_codes_[index]);
+  const unsigned int y = CompactBits(cut_codes_[index] >> 1);
+  neighbours[0] = y > 0 ? FindCutEntry(x, y - 1, index) : -1;
+  neighbours[1] = x + size < cells ? FindCutEntry(x + size, y, index) : -1;
+  neighbours[2] = y + size < cells ? FindCutEntry(x, y + size, index) : -1;
+  neighbours[3] = x > 0 ? FindCutEntry(x - 1, y, index) : -1;
+}
+
+int Terrain::FindCutEntry(unsigned int x, unsigned int y, int start) const {
+  const unsigned int code = SpreadBits(x) | SpreadBits(y) << 1;
+  const int size = static_cast<int>(cut_codes_.size());
+  // Gesucht ist der letzte Eintrag mit cut_codes_[low] <= code. Zuerst
+  // das Intervall [low, high] von start aus mit wachsender Schrittweite
+  // eingrenzen, dann darin binr suchen.
+  int low = start;
+  int high = start;
+  int step = 1;
+  if (cut_codes_[start] <= code) {
+    // cut_codes_[low] <= code
+    while (low + step < size && cut_codes_[low + step] <= code) {
+      low += step;
+      step *= 2;
+    }
+    high = low + step < size ? low + step - 1 : size - 1;
+  } else {
+    // cut_codes_[high] > code
+    while (high - step >= 0 && cut_codes_[high - step] > code) {
+      high -= step;
+      step *= 2;
+    }
+    low = high - step >= 0 ? high - step : 0;
+    --high;
+  }
+  while (low < high) {
+    const int mid = (low + high + 1) / 2;
+    if (cut_codes_[mid] <= code) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
+  return low;
+}
+
+void Terrain::SelectLODs(CutEntry *const *entries, size_t count,
+                         LODSelector *lod_selector, const CBaseCamera *camera,
+                         const Frustum &frustum, int *num_tests) {
+  lod_batch_.Clear();
+  batch_entries_.clear();
+  for (size_t i = 0; i < count; ++i) {
+    CutEntry *entry = entries[i];
+    unsigned int plane_mask = Frustum::ALL_PLANES;
+    entry->visible = frustum.Test(entry->box_min, entry->box_max,
+                                  &plane_mask) != Frustum::OUTSIDE;
+    entry->split = false;
+    // Auerhalb der Sichtpyramide wird nicht verfeinert
+    if (entry->can_split && entry->visible) {
+      lod_batch_.Add(entry->item.tile, entry->box_min, entry->box_max);
+      batch_entries_.push_back(entry);
+    }
+  }
+  if (batch_entries_.empty()) return;
+
+  lod_mask_.resize(lod_batch_.GetMaskSize());
+  lod_selector->SelectLODs(lod_batch_, camera, &lod_mask_[0]);
+  for (size_t i = 0; i < batch_entries_.size(); ++i) {
+    batch_entries_[i]->split =
+        !LODBatch::IsSet(&lod_mask_[0], static_cast<int>(i));
+  }
+  *num_tests += static_cast<int>(batch_entries_.size());
+}
+
+float Terrain::GetScreenErrorForBudget(const DynamicLODSelector &selector,
+                                       const CBaseCamera *camera,
+                                       int budget, bool triangles) {
+  const Frustum frustum(camera);
+  D3DXVECTOR3 box_min, box_max;
+  BudgetEntry root = { 0, tile_, Frustum::ALL_PLANES, 0 };
+  tile_->GetBounds(&box_min, &box_max);
+  if (frustum.Test(box_min, box_max, &root.plane_mask) == Frustum::OUTSIDE) {
+    return 0;
+  }
+  root.error = selector.GetScreenError(tile_, camera);
+  root.parent_error = root.error;
+  budget_queue_.clear();
+  budget_queue_.push_back(root);
+  // Die Wurzel wird immer gezeichnet
+  int used = triangles ? GetNumTriangles(tile_) : 1;
+
+  while (!budget_queue_.empty()) {
+    BudgetEntry entry = budget_queue_.front();
+    // Weiteres Teilen verringert den Fehler nicht mehr
+    if (entry.error <= 0) return 0;
+    std::pop_heap(budget_queue_.begin(), budget_queue_.end());
+    budget_queue_.pop_back();
+    // Tiles der untersten Stufe bleiben, wie sie sind
+    if (entry.tile->num_lod_ == 0) continue;
+
+    LoadChildren(entry.tile);
+    // Im Lazy-Modus ist der geometrische Fehler erst mit den Kindern exakt
+    // (siehe Tile::UpdateGeometricError). Hat er sich gendert, neu
+    // einreihen, sonst wrde die Auswahl mit dem erreichten Fehler von
+    // der Warteschlange abweichen.
+    float error = selector.GetScreenError(entry.tile, camera);
+    if (error > entry.parent_error) error = entry.parent_error;
+    if (error != entry.error) {
+      entry.error = error;
+      budget_queue_.push_back(entry);
+      std::push_heap(budget_queue_.begin(), budget_queue_.end());
+      continue;
+    }
+    BudgetEntry children[4];
+    int num_visible = 0;
+    // Das Tile wird durch seine sichtbaren Kinder ersetzt
+    int cost = triangles ? -GetNumTriangles(entry.tile) : -1;
+    for (int dir = 0; dir < 4; ++dir) {
+      BudgetEntry child = { 0, entry.tile->children_[dir], entry.plane_mask,
+                            entry.error };
+      child.tile->GetBounds(&box_min, &box_max);
+      if (frustum.Test(box_min, box_max, &child.plane_mask) ==
+          Frustum::OUTSIDE) {
+        continue;
+      }
+      child.error = selector.GetScreenError(child.tile, camera);
+      if (child.error > entry.error) child.error = entry.error;
+      children[num_visible++] = child;
+      cost += triangles ? GetNumTriangles(child.tile) : 1;
+    }
+    if (used + cost > budget) return entry.error;
+    used += cost;
+    for (int i = 0; i < num_visible; ++i) {
+      budget_queue_.push_back(children[i]);
+      std::push_heap(budget_queue_.begin(), budget_queue_.end());
+    }
+  }
+  return 0;
+}
+
+int Terrain::DrawRenderList(ID3D10EffectTechnique *technique,
+                            const RenderList &list) {
   assert(vertex_buffer_ != NULL);
   assert(index_buffer_ != NULL);
   assert(vertex_layout_ != NULL);
@@ -306,28 +1091,29 @@ void Terrain::Draw(ID3D10EffectTechnique *technique, LODSelector *lod_selector,
   UINT offset = 0;
   device_->IASetVertexBuffers(0, 1, &vertex_buffer_, &stride, &offset);
   // Index Buffer setzen
-  device_->IASetIndexBuffer(index_buffer_, DXGI_FORMAT_R32_UINT, 0);
+  device_->IASetIndexBuffer(index_buffer_, index_format_, 0);
   // Primitivtyp setzen
-  device_->IASetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+  // (die vereinfachten Triangulierungen sind immer Dreieckslisten)
+  device_->IASetPrimitiveTopology(strips_ && simplification_ < 0 ?
+      D3D10_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP :
+      D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
   // Vertex Layout setzen
   device_->IASetInputLayout(vertex_layout_);
 
   technique_ = technique;
-  tile_->Draw(lod_selector, camera, !shadow_pass);
+  int triangles = 0;
+  for (size_t i = 0; i < list.size(); ++i) triangles += DrawTile(list[i]);
   technique_ = NULL;
-
-  tile_scale_ev_->SetFloat(tile_->scale_);
-  tile_translate_ev_->SetFloatVector(tile_->translation_);
-  tile_heightmap_ev_->SetResource(tile_->shader_resource_view_);
-
-  if (tree_buffer_) {
-    if (mesh_[0]) DrawMesh(0, shadow_pass);
-    if (mesh_[1]) DrawMesh(1, shadow_pass);
-  }
+  return triangles;
 }
 
-void Terrain::DrawVegetation(bool shadow_pass) {
-  if (!shadow_pass) tile_->DrawVegetation();
+void Terrain::DrawVegetation(const CBaseCamera *camera, bool shadow_pass) {
+  if (shadow_pass) return;
+  const Frustum frustum(camera);
+  culling_stats_.vegetation_visited = 0;
+  culling_stats_.vegetation_culled = 0;
+  culling_stats_.vegetation_drawn = 0;
+  tile_->DrawVegetation(&frustum, Frustum::ALL_PLANES);
 }
 
 void Terrain::DrawMesh(int num, bool shadow_pass) {
@@ -375,25 +1161,41 @@ void Terrain::DrawMesh(int num, bool shadow_pass) {
   }
 }
 
-void Terrain::DrawTile(float scale, D3DXVECTOR2 &translate, UINT lod,
-                       ID3D10ShaderResourceView *srv) {
+int Terrain::DrawTile(const RenderItem &item) {
   assert(tile_scale_ev_ != NULL);
   assert(tile_translate_ev_ != NULL);
   assert(tile_lod_ev_ != NULL);
   assert(tile_heightmap_ev_ != NULL);
   assert(device_ != NULL);
   assert(technique_ != NULL);
-  tile_scale_ev_->SetFloat(scale);
-  tile_translate_ev_->SetFloatVector(translate);
-  tile_lod_ev_->SetInt(lod);
-  tile_heightmap_ev_->SetResource(srv);
+  assert(item.tile->shader_resource_view_ != NULL);
+  D3DXVECTOR2 translation = item.translation;
+  tile_scale_ev_->SetFloat(item.scale);
+  tile_translate_ev_->SetFloatVector(translation);
+  tile_lod_ev_->SetInt(item.lod);
+  tile_heightmap_ev_->SetResource(item.tile->shader_resource_view_);
+
+  UINT index_count = index_count_[item.stitch_mask];
+  UINT index_start = index_start_[item.stitch_mask];
+  int triangles = num_triangles_[item.stitch_mask];
+  if (simplification_ >= 0) {
+    ID3D10Buffer *buffer;
+    if (FAILED(GetSimplifiedMesh(item.tile, item.stitch_mask, &buffer,
+                                 &index_count))) {
+      return 0;
+    }
+    device_->IASetIndexBuffer(buffer, index_format_, 0);
+    index_start = 0;
+    triangles = index_count / 3;
+  }
 
   D3D10_TECHNIQUE_DESC tech_desc;
   technique_->GetDesc(&tech_desc);
   for (UINT p = 0; p < tech_desc.Passes; ++p) {
     technique_->GetPassByIndex(p)->Apply(0);
-    device_->DrawIndexed((size_-1)*(size_-1)*2*3, 0, 0);
+    device_->DrawIndexed(index_count, index_start, 0);
   }
+  return triangles;
 }
 
 float Terrain::GetMinHeight() const {
@@ -405,14 +1207,105 @@ float Terrain::GetMaxHeight() const {
 }
 
 float Terrain::GetHeightAt(const D3DXVECTOR3 &pos) const {
-  return tile_->GetHeightAt(pos);
+  return lod_tiles_[resident_lod_][GetResidentTileIndex(pos.x, pos.z)]->
+      GetHeightAt(pos);
+}
+
+D3DXVECTOR3 Terrain::GetNormalAt(const D3DXVECTOR3 &pos) const {
+  return lod_tiles_[resident_lod_][GetResidentTileIndex(pos.x, pos.z)]->
+      GetNormalAt(pos);
+}
+
+int Terrain::GetResidentTileIndex(float x, float z) const {
+  const int num_tiles_1d = 1 << resident_lod_;
+  const float factor = num_tiles_1d / tile_->scale_;
+  int tile_x = static_cast<int>(floorf((x - tile_->translation_.x) * factor));
+  int tile_y = static_cast<int>(floorf((z - tile_->translation_.y) * factor));
+  tile_x = tile_x < 0 ? 0 :
+           (tile_x < num_tiles_1d ? tile_x : num_tiles_1d - 1);
+  tile_y = tile_y < 0 ? 0 :
+           (tile_y < num_tiles_1d ? tile_y : num_tiles_1d - 1);
+  return tile_y * num_tiles_1d + tile_x;
+}
+
+bool Terrain::Raycast(const D3DXVECTOR3 &origin, const D3DXVECTOR3 &dir,
+                      float max_t, float *t) const {
+  return tile_->Raycast(Tile::Ray(origin, dir, 0.0f, max_t), t);
+}
+
+void Terrain::Raycast(const D3DXVECTOR3 *origins, const D3DXVECTOR3 *dirs,
+                      float max_t, float *ts, size_t n) const {
+  const int num_rays = static_cast<int>(n);
+#pragma omp parallel for schedule(dynamic, 64)
+  for (int i = 0; i < num_rays; ++i) {
+    if (!Raycast(origins[i], dirs[i], max_t, &ts[i])) ts[i] = -1.0f;
+  }
+}
+
+void Terrain::GetHeightsAt(const float *xs, const float *zs, float *out,
+                           size_t n) const {
+  QueryAt(xs, zs, out, NULL, n);
+}
+
+void Terrain::GetNormalsAt(const float *xs, const float *zs,
+                           D3DXVECTOR3 *out, size_t n) const {
+  QueryAt(xs, zs, NULL, out, n);
+}
+
+void Terrain::QueryAt(const float *xs, const float *zs, float *heights,
+                      D3DXVECTOR3 *normals, size_t n) const {
+  const std::vector<Tile *> &tiles = lod_tiles_[resident_lod_];
+  const int num_blocks =
+      static_cast<int>((n + QUERY_BLOCK_SIZE - 1) / QUERY_BLOCK_SIZE);
+#pragma omp parallel for schedule(dynamic)
+  for (int block = 0; block < num_blocks; ++block) {
+    const size_t begin = block * QUERY_BLOCK_SIZE;
+    const size_t end = begin + QUERY_BLOCK_SIZE < n ?
+                       begin + QUERY_BLOCK_SIZE : n;
+    // Abfragen nach Tiles der untersten residenten Stufe sortieren
+    std::vector<int> tile_indices(end - begin);
+    std::vector<size_t> offsets(tiles.size() + 1, 0);
+    for (size_t i = begin; i < end; ++i) {
+      tile_indices[i - begin] = GetResidentTileIndex(xs[i], zs[i]);
+      ++offsets[tile_indices[i - begin] + 1];
+    }
+    for (size_t t = 0; t < tiles.size(); ++t) offsets[t + 1] += offsets[t];
+    std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+    std::vector<Tile::Query> queries(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+      Tile::Query &query = queries[next[tile_indices[i - begin]]++];
+      query.x = xs[i];
+      query.z = zs[i];
+      query.index = static_cast<unsigned int>(i);
+    }
+    for (size_t t = 0; t < tiles.size(); ++t) {
+      if (offsets[t + 1] == offsets[t]) continue;
+      tiles[t]->QueryAt(&queries[offsets[t]], offsets[t + 1] - offsets[t],
+                        heights, normals);
+    }
+  }
 }
 
 void Terrain::InitVegetation(void) {
-  for (int i = 0; i < NUM_SEEDS; ++i) {
-    D3DXVECTOR3 seed(randf() * 0.5f, 0, randf() * 0.5f);
-    seed *= tile_->scale_;
-    tile_->PlaceVegetation(seed);
+  const Random vegetation_random(seed_, RANDOM_STREAM_VEGETATION);
+  std::vector<float> xs(SEED_BATCH_SIZE), zs(SEED_BATCH_SIZE);
+  std::vector<float> heights(SEED_BATCH_SIZE);
+  std::vector<D3DXVECTOR3> normals(SEED_BATCH_SIZE);
+  for (UINT first = 0; first < NUM_SEEDS; first += SEED_BATCH_SIZE) {
+    const UINT count = NUM_SEEDS - first < SEED_BATCH_SIZE ?
+                       NUM_SEEDS - first : SEED_BATCH_SIZE;
+    for (UINT i = 0; i < count; ++i) {
+      const Random random(vegetation_random, first + i, 0);
+      xs[i] = random.GetSignedFloat(0) * 0.5f * tile_->scale_;
+      zs[i] = random.GetSignedFloat(1) * 0.5f * tile_->scale_;
+    }
+    QueryAt(&xs[0], &zs[0], &heights[0], &normals[0], count);
+    for (UINT i = 0; i < count; ++i) {
+      Tile *tile = lod_tiles_[resident_lod_][GetResidentTileIndex(xs[i],
+                                                                  zs[i])];
+      tile->PlaceVegetation(D3DXVECTOR3(xs[i], heights[i], zs[i]),
+                            normals[i], Random(vegetation_random, first + i, 1));
+    }
   }
   tile_->GrowVegetation();
 }
@@ -1,13 +1,21 @@
 #pragma once
+#include <vector>
 #include "DXUT.h"
 #include "DXUTCamera.h"
+#include "LODSelector.h"
+#include "VertexCache.h"
 
+class DynamicLODSelector;
+class Frustum;
 class Tile;
-class LODSelector;
+class TileGenerator;
+class TileArena;
 class CDXUTSDKMesh;
 
 class Terrain {
  friend class Tile;
+ friend class TerrainTest;
+ friend class TerrainBench;
 
  public:
   /**
@@ -16,8 +24,26 @@ class Terrain {
    * @param roughness Rauheits-Faktor (je hher desto grer die
    *                  Hhenunterschiede)
    * @param num_lod Anzahl LOD-Ebenen
+   * @param seed Startwert fr alle Zufallszahlen (Hhen, Bume, Vegetation).
+   *             Derselbe Startwert ergibt bei gleichen Parametern immer
+   *             dasselbe Terrain.
+   * @param max_cached_tiles 0 erzeugt alle LOD-Stufen im Voraus. Sonst
+   *                         werden nur die obersten LOD-Stufen im Voraus
+   *                         erzeugt (Lazy-Modus), tiefere erst, wenn der
+   *                         LODSelector sie verlangt. Hchstens so viele
+   *                         dieser Tiles werden gehalten, die am lngsten
+   *                         ungenutzten werden wieder verworfen.
+   * @param residual_heights Ob Kind-Tiles nur die neu berechneten Hhenwerte
+   *                         speichern und die brigen beim Eltern-Tile
+   *                         nachschlagen (spart ca. 25% des Speichers)
+   * @param quantized_heights Ob die Hhenwerte mit 16 Bit relativ zum
+   *                          Wertebereich des Tiles gespeichert werden
+   *                          (halbiert den Speicher, Fehler hchstens
+   *                          1/131070 des Wertebereichs)
    */
-  Terrain(int n, float roughness, int num_lod, float scale, bool water);
+  Terrain(int n, float roughness, int num_lod, float scale, bool water,
+          unsigned int seed, size_t max_cached_tiles, bool residual_heights,
+          bool quantized_heights);
   ~Terrain(void);
 
   /**
@@ -30,11 +56,47 @@ class Terrain {
    */
   void TriangulateZOrder(void);
 
+  /**
+   * Trianguliert mit Z-Order und ordnet die Dreiecke dann fr den
+   * Vertex-Cache der GPU um (siehe VertexCache::Optimize).
+   */
+  void TriangulateVertexCache(void);
+
+  /**
+   * Trianguliert mit Dreiecksstreifen: Das Tile wird in senkrechte Bnder
+   * von STRIP_BAND_CELLS Zellen geteilt, jede Zeile eines Bands ist ein
+   * Streifen (getrennt durch VertexCache::STRIP_CUT). Ergibt dieselben
+   * Dreiecke wie TriangulateLines mit gut einem statt drei Indizes je
+   * Dreieck; die Vertices einer Zeile passen in einen Vertex-Cache mit 16
+   * Eintrgen, so wird jeder Vertex nur etwa einmal transformiert.
+   */
+  void TriangulateStrips(void);
+
+  /**
+   * Triangulierungen des Terrains
+   */
+  enum Triangulation { LINES, Z_ORDER, VERTEX_CACHE, STRIPS };
+
+  /**
+   * Trianguliert mit TriangulateLines, TriangulateZOrder,
+   * TriangulateVertexCache oder TriangulateStrips.
+   */
+  void Triangulate(Triangulation triangulation);
+
+  /**
+   * Bestimmt ACMR und ATVR der Triangulierung eines Tiles (ohne Vernhen)
+   * fr einen Vertex-Cache mit cache_size Eintrgen (siehe
+   * VertexCache::Measure).
+   * @warning Das Terrain muss zuvor trianguliert worden sein.
+   */
+  VertexCache::Stats GetVertexCacheStats(int cache_size,
+                                         VertexCache::Policy policy) const;
+
   /**
    * Erzeugt Vertex- und Index-Buffer und ldt das Dreiecksgitter in diese hoch.
    * Auerdem werden die Hhenkarten der Tiles erzeugt.
    * @warning Das Terrain muss zuvor trianguliert worden sein (durch Aufruf von
-   *          Terrain::TriangulateLines oder Terrain::TriangulateZOrder).
+   *          Terrain::Triangulate oder einer der Triangulate-Methoden).
    * @see Terrain::ReleaseBuffers
    */
   HRESULT CreateBuffers(ID3D10Device *device);
@@ -47,9 +109,173 @@ class Terrain {
   void ReleaseBuffers(void);
 
   void GetBoundingBox(D3DXVECTOR3 *out, D3DXVECTOR3 *mid) const;
+
+  /**
+   * Kanten eines Tiles, an die ein Tile einer grberen LOD-Stufe grenzt
+   * (Bits von RenderItem::stitch_mask; N ist die Kante mit y = 0). Fr jede
+   * der NUM_STITCH_VARIANTS Kombinationen enthlt der Index-Buffer eine
+   * Variante der Triangulierung, die auf diesen Kanten nur jeden zweiten
+   * Vertex verwendet, also genau die Vertices des grberen Nachbarn. So
+   * entstehen keine T-Junctions und damit keine Risse.
+   */
+  enum StitchEdge {
+    STITCH_N = 1,
+    STITCH_E = 2,
+    STITCH_S = 4,
+    STITCH_W = 8,
+    NUM_STITCH_VARIANTS = 16
+  };
+
+  /**
+   * Eintrag der Render-Liste: ein zu zeichnendes Tile
+   */
+  struct RenderItem {
+    float scale;
+    D3DXVECTOR2 translation;
+    int lod;
+    /**
+     * Kanten zu grberen Nachbarn (siehe StitchEdge), whlt die Variante
+     * des Index-Buffers
+     */
+    int stitch_mask;
+    /**
+     * Das Tile selbst, als Kennung und fr seine Hhenkarte beim Zeichnen
+     */
+    Tile *tile;
+  };
+  typedef std::vector<RenderItem> RenderList;
+
+  /**
+   * Rendert das Terrain. Tiles auerhalb der Sichtpyramide der Kamera
+   * werden verworfen (auer im Schattenpass). Ruft BuildRenderList und
+   * DrawRenderList auf.
+   */
   void Draw(ID3D10EffectTechnique *technique, LODSelector *lod_selector,
             const CBaseCamera *camera, bool shadow_pass=false);
-  void DrawVegetation(bool shadow_pass=false);
+
+  /**
+   * Bestimmt die zu zeichnenden Tiles, ohne D3D10-Aufrufe. Funktioniert
+   * daher auch ohne CreateBuffers, z.B. um Kamerapfade ohne GPU zu
+   * vermessen. Dazu wird der LOD-Schnitt des letzten Aufrufs an Kamera und
+   * LODSelector angepasst (siehe UpdateLODCut). Im Lazy-Modus werden dabei
+   * fehlende Tiles erzeugt und nicht mehr benutzte verdrngt; die Tiles in
+   * list bleiben bis zum nchsten Aufruf erhalten. Sind LODSelector und
+   * Kamera dieselben wie beim letzten Aufruf (z.B. Schatten- und Hauptpass
+   * eines Bildes), bleibt der Schnitt unverndert (siehe
+   * InvalidateLODCut).
+   * @param culling Ob nur die Tiles des Schnitts in der Sichtpyramide der
+   *                Kamera bernommen werden (nur dann wird die Statistik
+   *                gezhlt). Auerhalb wird der Schnitt in jedem Fall nicht
+   *                verfeinert.
+   * @param list Wird geleert und erhlt die Tiles; der Speicher wird ber
+   *             die Aufrufe hinweg wiederverwendet
+   */
+  void BuildRenderList(LODSelector *lod_selector, const CBaseCamera *camera,
+                       bool culling, RenderList *list);
+
+  /**
+   * Verwirft den LOD-Schnitt des letzten BuildRenderList, z.B. wenn sich
+   * die Parameter des LODSelector gendert haben. Der nchste Aufruf
+   * passt den Schnitt dann auch bei unvernderter Kamera neu an.
+   */
+  void InvalidateLODCut(void) { cut_lod_selector_ = NULL; }
+
+  /**
+   * Schaltet das Vernhen benachbarter Tiles unterschiedlicher LOD-Stufen
+   * ein oder aus (Standard: ein). Dazu wird der LOD-Schnitt so ausbalanciert,
+   * dass sich sichtbare Nachbarn um hchstens eine Stufe unterscheiden
+   * (siehe BalanceLODCut), und jedes Tile erhlt die passende Variante des
+   * Index-Buffers (siehe StitchEdge). Das Ausbalancieren kann einige Tiles
+   * mehr erfordern, als der LODSelector verlangt, auch ber das Budget
+   * eines BudgetLODSelector hinaus.
+   */
+  void SetStitching(bool stitching) {
+    stitching_ = stitching;
+    InvalidateLODCut();
+  }
+  bool GetStitching(void) const { return stitching_; }
+
+  /**
+   * Zeichnet die Tiles statt mit der Triangulierung des Terrains adaptiv
+   * vereinfacht (siehe Tile::Simplify), mit hchstens max_error
+   * senkrechter Abweichung an den Samples und Zellmitten eines Tiles;
+   * negativ: aus (Standard). Die Abweichung kommt zum Fehler der LOD-Stufe
+   * hinzu. Die Index-Buffer werden je Tile beim ersten Zeichnen erzeugt
+   * (siehe GetSimplifiedMesh).
+   */
+  void SetSimplification(float max_error) { simplification_ = max_error; }
+  float GetSimplification(void) const { return simplification_; }
+
+  /**
+   * Bestimmt den kleinsten Bildschirmfehler, der mit hchstens budget
+   * Tiles bzw. Dreiecken in der Sichtpyramide erreichbar ist (fr
+   * BudgetLODSelector): Von der Wurzel aus wird gierig immer das sichtbare
+   * Tile mit dem grten Fehler (DynamicLODSelector::GetScreenError)
+   * geteilt, ber eine Priorittswarteschlange, bis das nchste Teilen das
+   * Budget berschritte. Der Aufwand hngt also nur vom Budget ab. Im
+   * Lazy-Modus werden fehlende Kind-Tiles dabei erzeugt.
+   * @param triangles Ob budget Dreiecke statt Tiles zhlt, je Tile die
+   *                  tatschliche Anzahl (siehe GetNumTriangles). Stitching
+   *                  entfernt nur Dreiecke, kann beim Ausgleichen der
+   *                  LOD-Stufen aber Tiles hinzufgen.
+   * @return Fehler des ersten nicht mehr geteilten Tiles, 0, wenn alle
+   *         sichtbaren Tiles mit Fehler voll verfeinert wurden. Mit diesem
+   *         Wert als zulssigem Fehler whlt selector dieselben Tiles aus
+   *         (bis auf solche mit genau diesem Fehler).
+   */
+  float GetScreenErrorForBudget(const DynamicLODSelector &selector,
+                                const CBaseCamera *camera, int budget,
+                                bool triangles);
+
+  /**
+   * Gibt die Anzahl der Dreiecke eines Tiles zurck.
+   */
+  int GetNumTrianglesPerTile(void) const {
+    return 2 * (size_ - 1) * (size_ - 1);
+  }
+
+  /**
+   * Zeichnet die Tiles einer mit BuildRenderList erstellten Liste.
+   * @return Anzahl der gezeichneten Dreiecke (ohne entartete)
+   */
+  int DrawRenderList(ID3D10EffectTechnique *technique,
+                     const RenderList &list);
+
+  /**
+   * Rendert die Vegetation, ebenfalls mit Culling gegen die Sichtpyramide
+   * der Kamera.
+   */
+  void DrawVegetation(const CBaseCamera *camera, bool shadow_pass=false);
+
+  /**
+   * Zhler des Culling und der LOD-Auswahl fr ein Bild
+   */
+  struct CullingStats {
+    /**
+     * Besuchte, verworfene und gezeichnete Tiles in Draw
+     */
+    int tiles_visited, tiles_culled, tiles_drawn;
+    /**
+     * Aufrufe von LODSelector::IsLODSufficient, geteilte und
+     * zusammengefasste Tiles beim Anpassen des LOD-Schnitts, sowie nur zum
+     * Ausbalancieren geteilte Tiles (siehe SetStitching)
+     */
+    int lod_tests, tiles_split, tiles_merged, tiles_balanced;
+    /**
+     * Besuchte, verworfene und gezeichnete Tiles in DrawVegetation
+     */
+    int vegetation_visited, vegetation_culled, vegetation_drawn;
+    /**
+     * Gezeichnete Dreiecke des Terrains in Draw (siehe DrawRenderList)
+     */
+    int triangles_drawn;
+  };
+
+  /**
+   * Gibt die Culling-Statistik des letzten Draw und DrawVegetation (ohne
+   * Schattenpass) zurck.
+   */
+  const CullingStats &GetCullingStats(void) const { return culling_stats_; }
 
   /**
    * Ermittelt die minimale Hhe im Terrain und gibt sie zurck.
@@ -63,29 +289,313 @@ class Terrain {
 
   D3DXVECTOR3 GetHighestPoint(void) const;
   float GetHeightAt(const D3DXVECTOR3 &pos) const;
+  D3DXVECTOR3 GetNormalAt(const D3DXVECTOR3 &pos) const;
+
+  /**
+   * Ermittelt die Hhen an den n Positionen (xs[i], zs[i]). Batch-Variante
+   * von GetHeightAt fr viele Abfragen (z.B. beim Platzieren der
+   * Vegetation): die Abfragen werden nach Blatt-Tiles sortiert und dort
+   * gemeinsam interpoliert (siehe Tile::QueryAt).
+   */
+  void GetHeightsAt(const float *xs, const float *zs, float *out,
+                    size_t n) const;
+
+  /**
+   * Ermittelt die Normalen an den n Positionen (xs[i], zs[i]), wie
+   * GetHeightsAt.
+   */
+  void GetNormalsAt(const float *xs, const float *zs, D3DXVECTOR3 *out,
+                    size_t n) const;
+
+  /**
+   * Schneidet den Strahl origin + t * dir (0 <= t <= max_t) mit dem Terrain
+   * der untersten residenten LOD-Stufe (ohne Lazy-Modus also mit dem
+   * feinsten Terrain). Die Tiles und deren Zellblcke werden anhand ihrer
+   * minimalen und maximalen Hhe von vorne nach hinten durchlaufen (siehe
+   * Tile::Raycast), so dass nur Zellen nahe am Strahl getestet werden.
+   * dir muss nicht normiert sein, t ist in Vielfachen von dir angegeben.
+   * @param t Erhlt bei einem Treffer den Strahlparameter des ersten
+   *          Schnittpunkts
+   * @return Ob das Terrain getroffen wurde
+   */
+  bool Raycast(const D3DXVECTOR3 &origin, const D3DXVECTOR3 &dir, float max_t,
+               float *t) const;
+
+  /**
+   * Batch-Variante von Raycast fr n Strahlen (z.B. fr Sichtbarkeits- oder
+   * Schattentests), die Strahlen werden parallel verfolgt.
+   * @param ts Erhlt je Strahl den Strahlparameter des ersten Schnittpunkts
+   *           oder -1, wenn das Terrain verfehlt wird
+   */
+  void Raycast(const D3DXVECTOR3 *origins, const D3DXVECTOR3 *dirs,
+               float max_t, float *ts, size_t n) const;
 
   int GetNumTrees(void) const { return num_trees_[0] + num_trees_[1]; }
 
+  unsigned int GetSeed(void) const { return seed_; }
+
+  /**
+   * Gibt den TileGenerator zurck, mit dem sich die Hhenwerte beliebiger
+   * Tiles dieses Terrains direkt berechnen lassen.
+   */
+  const TileGenerator *GetTileGenerator(void) const { return generator_; }
+
+  /**
+   * Gibt die Anzahl der bei Bedarf erzeugten Tiles zurck, die zur Zeit
+   * gehalten werden (0, falls nicht im Lazy-Modus).
+   */
+  size_t GetNumCachedTiles(void) const { return 4 * lazy_parents_.size(); }
+
+  /**
+   * Ermittelt den Speicherbedarf der Hhenwerte aller vorhandenen Tiles je
+   * LOD-Stufe (in Bytes).
+   * @param stored Tatschlich belegter Speicher je Stufe
+   * @param full Speicherbedarf je Stufe bei vollstndiger Speicherung als
+   *             float
+   */
+  void GetHeightMemory(std::vector<size_t> *stored,
+                       std::vector<size_t> *full) const;
+
  private:
   // Kopierkonstruktor und Zuweisungsoperator verbieten.
   Terrain(const Terrain &t);
   void operator=(const Terrain &t);
 
-  void DrawTile(float scale, D3DXVECTOR2 &translate, UINT lod,
-                ID3D10ShaderResourceView *srv);
+  /**
+   * @return Anzahl der gezeichneten Dreiecke
+   */
+  int DrawTile(const RenderItem &item);
   void DrawMesh(int num=0, bool shadow_pass=false);
 
   /**
-   * Reserviert Speicher fr den Index Buffer.
+   * Reserviert Speicher fr den Index Buffer und setzt num_indices_ und
+   * strips_ fr eine Dreiecksliste.
    */
   void InitIndexBuffer(void);
 
+  /**
+   * Erzeugt aus indices_ die NUM_STITCH_VARIANTS Varianten der
+   * Triangulierung (siehe StitchEdge), hintereinander in out, und setzt
+   * index_start_ und index_count_. Die Reihenfolge der Dreiecke bleibt
+   * erhalten, Dreiecke, die durch das Vernhen entarten, entfallen (nur
+   * bei Dreieckslisten; in Streifen bleiben sie stehen und werden von der
+   * GPU verworfen).
+   */
+  void CreateStitchedIndices(std::vector<unsigned int> *out);
+
+  /**
+   * Hngt die Dreiecksliste indices in der Variante stitch_mask an out an,
+   * ohne die dabei entarteten Dreiecke.
+   */
+  void StitchTriangles(const unsigned int *indices, size_t num_indices,
+                       int stitch_mask, std::vector<unsigned int> *out) const;
+
+  /**
+   * Gibt an, ob das Dreieck (drei Indizes) zu einem Punkt oder einer
+   * Strecke entartet ist.
+   */
+  bool IsDegenerate(const unsigned int *triangle) const;
+
+  /**
+   * Legt einen Index-Buffer mit indices im Format index_format_ an
+   * (VertexCache::STRIP_CUT wird dabei zu 0xffff).
+   */
+  HRESULT CreateIndexBuffer(const std::vector<unsigned int> &indices,
+                            ID3D10Buffer **buffer) const;
+
+  /**
+   * Gibt den Index-Buffer der vereinfachten Triangulierung (siehe
+   * SetSimplification) von tile in der Variante stitch_mask zurck und
+   * erzeugt ihn beim ersten Mal. Die Buffer hlt das Tile, bis es
+   * freigegeben wird oder sich die Fehlerschranke ndert.
+   */
+  HRESULT GetSimplifiedMesh(Tile *tile, int stitch_mask,
+                            ID3D10Buffer **buffer, UINT *num_indices);
+
+  /**
+   * Gibt die Anzahl der Dreiecke zurck, mit denen tile ohne Stitching
+   * gezeichnet wird: GetNumTrianglesPerTile bzw. mit Vereinfachung die von
+   * Tile::Simplify (je Tile und Fehlerschranke nur einmal berechnet).
+   */
+  int GetNumTriangles(Tile *tile);
+
+  /**
+   * Gibt den Vertex zurck, der in der Variante stitch_mask an die Stelle
+   * von Vertex index tritt: Ungerade Vertices auf den Kanten zu grberen
+   * Nachbarn fallen mit dem vorhergehenden geraden Vertex der Kante
+   * zusammen.
+   */
+  unsigned int StitchVertex(unsigned int index, int stitch_mask) const;
+
   /**
    * Rekursive Implementierung der Z-Order-Triangulierung.
    */
   void TriangulateZOrder0(int x1, int y1, int x2, int y2, int &i);
 
-  void InitMeshes(void);
+  /**
+   * Erzeugt die Kind-Tiles aller residenten LOD-Stufen. Die Tiles einer
+   * Stufe werden parallel und unabhngig voneinander aus ihren Eltern-Tiles
+   * berechnet.
+   */
+  void InitTiles(void);
+
+  /**
+   * Passt den LOD-Schnitt lod_cut_ an: Tiles des Schnitts, deren LOD-Stufe
+   * nicht ausreicht, werden durch ihre Kinder ersetzt (rekursiv), und vier
+   * Geschwister, deren Eltern-Tile ausreicht, durch dieses (ebenfalls
+   * rekursiv nach oben). Getestet werden also nur Tiles am Rand des
+   * Schnitts, nicht die Vorfahren darber, und der Schnitt ndert sich nur
+   * dort, wo sich die Auswahl gendert hat. Fr LODSelector, bei denen die
+   * Vorfahren eines unzureichenden Tiles ebenfalls nicht ausreichen, ist
+   * das Ergebnis dasselbe wie beim Abstieg von der Wurzel.
+   *
+   * Der Schnitt liegt in Tiefensuch-Reihenfolge vor, Geschwister also
+   * direkt hintereinander. Er wird in einem Durchlauf nach next_lod_cut_
+   * umgeschrieben, ohne Buchfhrung in den Tiles. Vorher wird die
+   * LOD-Auswahl fr alle Tiles des Schnitts und die Eltern-Tiles aller
+   * Geschwistergruppen in einem Batch getroffen (siehe SelectLODs).
+   * @param stats Erhlt lod_tests, tiles_split und tiles_merged
+   */
+  void UpdateLODCut(LODSelector *lod_selector, const CBaseCamera *camera,
+                    const Frustum &frustum, CullingStats *stats);
+
+  /**
+   * Eintrag des LOD-Schnitts. Enthlt alles, was UpdateLODCut und
+   * BuildRenderList auer dem LODSelector brauchen, damit die im Speicher
+   * verstreuten Tiles selbst nicht gelesen werden mssen.
+   */
+  struct CutEntry {
+    RenderItem item;
+    Tile *parent;
+    D3DXVECTOR3 box_min, box_max;
+    /**
+     * Morton-Code der NW-Ecke des Tiles im Zellraster der feinsten
+     * LOD-Stufe. Der Schnitt ist danach aufsteigend sortiert, die Tiles
+     * berdecken also die Intervalle bis zum nchsten Code.
+     */
+    unsigned int code;
+    /**
+     * Ob das Tile Kinder hat bzw. haben kann
+     */
+    bool can_split;
+    /**
+     * Ob das Tile das erste (NW) bzw. letzte (SE) Kind seines Eltern-Tiles
+     * ist
+     */
+    bool first_child, last_child;
+    /**
+     * Ob das Tile in der Sichtpyramide liegt (von SelectLODs gesetzt)
+     */
+    bool visible;
+    /**
+     * Ob das Tile durch seine Kinder ersetzt werden muss (von SelectLODs
+     * gesetzt)
+     */
+    bool split;
+  };
+
+  static CutEntry MakeCutEntry(Tile *tile);
+
+  /**
+   * Teilt (nur bei SetStitching) sichtbare Tiles des Schnitts, an die ein
+   * sichtbares Tile grenzt, das mehr als eine LOD-Stufe feiner ist, bis
+   * sich alle sichtbaren Nachbarn um hchstens eine Stufe unterscheiden.
+   * Danach erhalten alle Tiles ihre stitch_mask (sonst 0). Solche Tiles
+   * fasst UpdateLODCut im nchsten Bild ggf. wieder zusammen, und sie werden
+   * hier erneut geteilt.
+   * @param stats Erhlt tiles_balanced
+   */
+  void BalanceLODCut(const Frustum &frustum, CullingStats *stats);
+
+  /**
+   * Bestimmt die Nachbarn von lod_cut_[index]: neighbours[k] ist der Index
+   * des Eintrags, der an Kante k (N, O, S, W) an die NW-Ecke des Tiles
+   * grenzt bzw. an die NO- oder SW-Ecke, -1 am Rand des Terrains. Ist der
+   * Nachbar grber, grenzt er an die ganze Kante. cut_codes_ muss zu
+   * lod_cut_ passen.
+   */
+  void GetCutNeighbours(int index, int neighbours[4]) const;
+
+  /**
+   * Gibt den Index des Eintrags von lod_cut_ zurck, der die Zelle (x, y)
+   * der feinsten LOD-Stufe enthlt. Sucht in cut_codes_ von Index start
+   * aus mit exponentiell wachsender Schrittweite, dann binr; nahe
+   * Eintrge (wie meist die Nachbarn) werden also schneller gefunden.
+   */
+  int FindCutEntry(unsigned int x, unsigned int y, int start) const;
+
+  /**
+   * Hngt entry an next_lod_cut_ an. Schliet es dort vier Geschwister ab,
+   * werden diese durch das Eltern-Tile ersetzt, falls es ausreicht, und
+   * dasselbe fr dessen Eltern-Tile usw.
+   */
+  void AppendToCut(const CutEntry &entry, LODSelector *lod_selector,
+                   const CBaseCamera *camera, const Frustum &frustum,
+                   CullingStats *stats);
+
+  /**
+   * Hngt statt tile seine Kinder an next_lod_cut_ an, rekursiv deren
+   * Kinder, falls ntig.
+   */
+  void SplitIntoCut(Tile *tile, LODSelector *lod_selector,
+                    const CBaseCamera *camera, const Frustum &frustum,
+                    CullingStats *stats);
+
+  /**
+   * Bestimmt fr entries[0] bis entries[count - 1], ob das Tile im
+   * LOD-Schnitt durch seine Kinder ersetzt werden muss (CutEntry::split):
+   * Es liegt in der Sichtpyramide (CutEntry::visible), hat Kinder und
+   * seine LOD-Stufe reicht nicht aus. Die LOD-Auswahl wird fr alle
+   * betroffenen Tiles mit einem Aufruf von LODSelector::SelectLODs
+   * getroffen.
+   * @param num_tests Wird um die Anzahl der ausgewhlten Tiles erhht
+   */
+  void SelectLODs(CutEntry *const *entries, size_t count,
+                  LODSelector *lod_selector, const CBaseCamera *camera,
+                  const Frustum &frustum, int *num_tests);
+
+
+  /**
+   * Gibt den Index (in lod_tiles_[resident_lod_]) des Tiles der untersten
+   * residenten LOD-Stufe zurck, in dem die Position (x, z) liegt; auerhalb
+   * des Terrains den des nchstgelegenen. Wird direkt aus der Position
+   * berechnet, ohne Abstieg durch den Baum.
+   */
+  int GetResidentTileIndex(float x, float z) const;
+
+  /**
+   * Implementierung von GetHeightsAt und GetNormalsAt; heights bzw.
+   * normals darf NULL sein. Teilt die Abfragen in Blcke, die parallel
+   * bearbeitet werden.
+   */
+  void QueryAt(const float *xs, const float *zs, float *heights,
+               D3DXVECTOR3 *normals, size_t n) const;
+
+  /**
+   * Berechnet die Normalen aller vorhandenen Tiles, alle Tiles aller
+   * LOD-Stufen parallel (siehe Tile::CalculateNormals).
+   */
+  void CalculateNormals(void);
+
+  /**
+   * Stellt sicher, dass die Kind-Tiles von parent vorhanden sind, und merkt
+   * sie als benutzt vor. Im Lazy-Modus werden sie dazu ggf. erzeugt; die
+   * residenten LOD-Stufen sind immer vorhanden.
+   */
+  void LoadChildren(Tile *parent);
+
+  /**
+   * Verwirft im Lazy-Modus die am lngsten ungenutzten Kind-Tiles, bis
+   * hchstens max_cached_tiles_ Tiles gehalten werden. Tiles, die im
+   * aktuellen Draw benutzt wurden, bleiben erhalten.
+   */
+  void TrimCache(void);
+
+  /**
+   * Ldt die Baum-Meshes mit device (aus CreateBuffers; ohne Device
+   * bleiben mesh_[0] und mesh_[1] NULL).
+   */
+  HRESULT InitMeshes(ID3D10Device *device);
   HRESULT InitTrees(void);
   void InitVegetation(void);
 
@@ -93,6 +603,120 @@ class Terrain {
    * Zeiger auf das Wurzel-Tile
    */
   Tile *tile_;
+  /**
+   * Startwert fr alle Zufallszahlen
+   */
+  const unsigned int seed_;
+  /**
+   * Berechnet die Hhenwerte der Tiles
+   */
+  TileGenerator *generator_;
+  /**
+   * Speicher der Hhenwerte und Normalen aller Tiles
+   */
+  TileArena *arena_;
+  /**
+   * Anzahl der im Voraus erzeugten LOD-Stufen unter dem Wurzel-Tile. Die
+   * Vegetation liegt in den Tiles der untersten dieser Stufen.
+   */
+  int resident_lod_;
+  /**
+   * Tiles jeder residenten LOD-Stufe, zeilenweise nach ihrer Position im
+   * Tile-Raster der Stufe geordnet (Stufe l hat 2^l x 2^l Tiles). Die
+   * unterste Stufe dient als flacher Index fr Punktabfragen (siehe
+   * GetResidentTileIndex).
+   */
+  std::vector<std::vector<Tile *> > lod_tiles_;
+  /**
+   * Maximale Anzahl bei Bedarf erzeugter Tiles (0: kein Lazy-Modus)
+   */
+  const size_t max_cached_tiles_;
+  /**
+   * Tiles, deren Kinder bei Bedarf erzeugt wurden
+   */
+  std::vector<Tile *> lazy_parents_;
+  /**
+   * Zhler der Aufrufe von Terrain::BuildRenderList (siehe Tile::last_used_)
+   */
+  unsigned int draw_count_;
+  CullingStats culling_stats_;
+  /**
+   * Render-Liste von Draw, bleibt ber die Bilder hinweg reserviert
+   */
+  RenderList render_list_;
+  /**
+   * LOD-Schnitt des letzten BuildRenderList: die Tiles, die gezeichnet
+   * wrden, ohne Culling (siehe UpdateLODCut)
+   */
+  std::vector<CutEntry> lod_cut_;
+  /**
+   * Der neue Schnitt whrend UpdateLODCut (wird danach mit lod_cut_
+   * getauscht, beide bleiben reserviert)
+   */
+  std::vector<CutEntry> next_lod_cut_;
+  /**
+   * LODSelector und Kamera-Matrizen, fr die lod_cut_ zuletzt angepasst
+   * wurde
+   */
+  const LODSelector *cut_lod_selector_;
+  D3DXMATRIX cut_view_, cut_proj_;
+  /**
+   * Ob benachbarte Tiles vernht werden (siehe SetStitching)
+   */
+  bool stitching_;
+  /**
+   * Fehlerschranke der vereinfachten Triangulierung, negativ: aus (siehe
+   * SetSimplification)
+   */
+  float simplification_;
+  /**
+   * Die Codes (CutEntry::code) von lod_cut_ fr FindCutEntry, bleibt
+   * reserviert
+   */
+  std::vector<unsigned int> cut_codes_;
+  /**
+   * Eltern-Tiles der Geschwistergruppen in lod_cut_ und die Eintrge, fr
+   * die UpdateLODCut die LOD-Auswahl vorab trifft
+   */
+  std::vector<CutEntry> cut_parents_;
+  std::vector<CutEntry *> cut_tests_;
+  /**
+   * Batch, Ergebnis-Bitmaske und zugehrige Eintrge von SelectLODs
+   */
+  LODBatch lod_batch_;
+  std::vector<unsigned int> lod_mask_;
+  std::vector<CutEntry *> batch_entries_;
+
+  /**
+   * Eintrag der Priorittswarteschlange von GetScreenErrorForBudget
+   */
+  struct BudgetEntry {
+    float error;
+    Tile *tile;
+    /**
+     * Noch zu testende Ebenen der Sichtpyramide (siehe Frustum::Test)
+     */
+    unsigned int plane_mask;
+    /**
+     * Fehler des Eltern-Eintrags, begrenzt error: Der Bildschirmfehler
+     * eines Kinds kann grer sein als der des Tiles (siehe
+     * DynamicLODSelector::GetNearestZ), der DynamicLODSelector teilt es
+     * aber nur, wenn er auch alle Vorfahren teilt.
+     */
+    float parent_error;
+
+    bool operator<(const BudgetEntry &entry) const {
+      return error < entry.error;
+    }
+  };
+  /**
+   * Heap fr GetScreenErrorForBudget, bleibt reserviert
+   */
+  std::vector<BudgetEntry> budget_queue_;
+  /**
+   * Ob Kind-Tiles nur die Residuen ihrer Hhenwerte speichern
+   */
+  const bool residual_heights_;
   /**
    * Gre eines Tiles (Seitenlnge)
    */
@@ -105,9 +729,24 @@ class Terrain {
    */
   ID3D10Buffer *vertex_buffer_;
   /**
-   * Zeiger auf den D3D10-Index-Buffer.
+   * Zeiger auf den D3D10-Index-Buffer. Enthlt alle Varianten der
+   * Triangulierung (siehe CreateStitchedIndices).
    */
   ID3D10Buffer *index_buffer_;
+  /**
+   * Format des Index-Buffers: 16 Bit, wenn alle Vertex-Indizes und der
+   * Strip-Cut-Index 0xffff hineinpassen (Tiles bis 129x129), sonst 32 Bit
+   */
+  DXGI_FORMAT index_format_;
+  /**
+   * Erster Index und Anzahl der Indizes jeder Variante im Index-Buffer
+   */
+  UINT index_start_[NUM_STITCH_VARIANTS];
+  UINT index_count_[NUM_STITCH_VARIANTS];
+  /**
+   * Anzahl der nicht entarteten Dreiecke jeder Variante
+   */
+  UINT num_triangles_[NUM_STITCH_VARIANTS];
   ID3D10Buffer *tree_buffer_; // Bume Transformationsmatrizen
   UINT num_trees_[2];
   UINT tree_offset_[2];
@@ -126,6 +765,15 @@ class Terrain {
    * @see Terrain::TriangulateZOrder
    */
   unsigned int *indices_;
+  /**
+   * Anzahl der Indizes in indices_
+   */
+  int num_indices_;
+  /**
+   * Ob indices_ Dreiecksstreifen statt einer Dreiecksliste enthlt
+   * @see Terrain::TriangulateStrips
+   */
+  bool strips_;
 
   CDXUTSDKMesh *mesh_[2];
   ID3D10InputLayout *mesh_vertex_layout_;
@@ -19,6 +19,7 @@
 #include "LODSelector.h"
 #include "FixedLODSelector.h"
 #include "DynamicLODSelector.h"
+#include "BudgetLODSelector.h"
 #include "Scene.h"
 #include "Environment.h"
 #include "ShadowedDirectionalLight.h"
@@ -38,6 +39,21 @@ int   g_nTerrainN = 7;
 float g_fTerrainR = 1.0f;
 int   g_nTerrainLOD = 2;
 float g_fTerrainScale = 50.0f;
+UINT  g_uiTerrainSeed = 0;
+bool  g_bTerrainLazy = false;
+bool  g_bTerrainResidual = false;
+bool  g_bTerrainQuantized = false;
+Terrain::Triangulation g_eTerrainTriangulation = Terrain::Z_ORDER;
+// ACMR und ATVR der Triangulierung fr FIFO- und LRU-Caches mit 16 und 32
+// Eintrgen (siehe UpdateVertexCacheStats)
+const int g_nVertexCacheSizes[2] = { 16, 32 };
+VertexCache::Stats g_VertexCacheStats[2][2];
+// Maximale Anzahl bei Bedarf erzeugter Tiles im Lazy-Modus
+const UINT g_uiMaxCachedTiles = 512;
+// Hchstzahl der LOD-Stufen im Dialog: Ohne Lazy-Modus wird der ganze Baum
+// erzeugt (bei 12 Stufen etwa 22 Mio. Tiles)
+const int g_nMaxEagerTerrainLOD = 5;
+const int g_nMaxLazyTerrainLOD = 12;
 
 extern const float g_fFOV = D3DX_PI / 4;
 
@@ -85,6 +101,12 @@ bool                        g_bShowSettings = false;
 bool                        g_bWireframe = false;
 bool                        g_bPaused = false;
 float                       g_fScreenError = 1.0f;
+bool                        g_bGeometricError = true;
+bool                        g_bTileBudget = false;
+int                         g_nTileBudget = 500;
+bool                        g_bStitching = true;
+bool                        g_bSimplify = false;
+float                       g_fSimplifyError = 0.05f;
 UINT                        g_uiScreenHeight = 600;
 ID3D10RasterizerState*      g_pRSWireframe = NULL;
 bool                        g_bTSM = false;
@@ -196,6 +218,14 @@ ID3D10EffectShaderResourceVariable* g_tDOFTex2;
 #define IDC_SCREEN_ERROR_S          22
 #define IDC_POINT_EMITTER           23
 #define IDC_BOX_EMITTER             24
+#define IDC_GEOMETRIC_ERROR         25
+#define IDC_TILE_BUDGET             26
+#define IDC_TILE_BUDGET_SLIDER      27
+#define IDC_TILE_BUDGET_S           28
+#define IDC_STITCHING               29
+#define IDC_SIMPLIFY                30
+#define IDC_SIMPLIFY_ERROR          31
+#define IDC_SIMPLIFY_ERROR_S        32
 
 #define IDC_NEWTERRAIN_LOD          100
 #define IDC_NEWTERRAIN_SIZE         101
@@ -206,6 +236,10 @@ ID3D10EffectShaderResourceVariable* g_tDOFTex2;
 #define IDC_NEWTERRAIN_ROUGHNESS_S  106
 #define IDC_NEWTERRAIN_SCALE_S      107
 #define IDC_NEWTERRAIN_OK           108
+#define IDC_NEWTERRAIN_LAZY         109
+#define IDC_NEWTERRAIN_RESIDUAL     110
+#define IDC_NEWTERRAIN_QUANTIZED    111
+#define IDC_NEWTERRAIN_TRIANGULATION 112
 
 #define IDC_HDR_ENABLED             201
 #define IDC_DOF_ENABLED             202
@@ -244,6 +278,8 @@ void CALLBACK OnD3D10DestroyDevice(void* pUserContext);
 
 void InitApp();
 void RenderText();
+void CreateLODSelector();
+void UpdateVertexCacheStats();
 
 void DrawFullscreenQuad( ID3D10Device* pd3dDevice, ID3D10EffectTechnique* pTech, UINT Width, UINT Height );
 HRESULT GetSampleOffsets_Bloom_D3D10( DWORD dwD3DTexSize, float afTexCoordOffset[15],
@@ -307,6 +343,40 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
 }
 
 
+//--------------------------------------------------------------------------------------
+// (Re)create the LOD selector as chosen in the UI
+//--------------------------------------------------------------------------------------
+void CreateLODSelector() {
+  const DynamicLODSelector::Metric metric =
+      g_bGeometricError ? DynamicLODSelector::GEOMETRIC_ERROR :
+                          DynamicLODSelector::GRID_SPACING;
+  SAFE_DELETE(g_pLODSelector);
+  if (g_bTileBudget) {
+    g_pLODSelector = new BudgetLODSelector(g_fFOV, g_uiScreenHeight,
+                                           g_nTileBudget,
+                                           BudgetLODSelector::TILES, metric);
+  } else {
+    g_pLODSelector = new DynamicLODSelector(g_fFOV, g_uiScreenHeight,
+                                            g_fScreenError, metric);
+  }
+  if (g_pScene) g_pScene->SetLODSelector(g_pLODSelector);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Measure the vertex cache efficiency of the terrain triangulation for the HUD
+//--------------------------------------------------------------------------------------
+void UpdateVertexCacheStats() {
+  const Terrain *terrain = g_pScene->GetTerrain();
+  for (int policy = 0; policy < 2; ++policy) {
+    for (int i = 0; i < 2; ++i) {
+      g_VertexCacheStats[policy][i] = terrain->GetVertexCacheStats(
+          g_nVertexCacheSizes[i], static_cast<VertexCache::Policy>(policy));
+    }
+  }
+}
+
+
 //--------------------------------------------------------------------------------------
 // Initialize the app
 //--------------------------------------------------------------------------------------
@@ -355,6 +425,22 @@ void InitApp() {
   StringCchPrintf(sz, 100, L"Screen error: %.1f", 1.0f);
   g_SampleUI.AddStatic(IDC_SCREEN_ERROR_S, sz, 35, iY += 24, 125, 22);
   g_SampleUI.AddSlider(IDC_SCREEN_ERROR, 35, iY += 24, 125, 22, 0, 100, (int)(10*g_fScreenError));
+  g_SampleUI.AddCheckBox(IDC_GEOMETRIC_ERROR, L"Geometric error", 35,
+                         iY += 24, 125, 22, g_bGeometricError);
+  g_SampleUI.AddCheckBox(IDC_TILE_BUDGET, L"Tile budget", 35, iY += 24, 125,
+                         22, g_bTileBudget);
+  StringCchPrintf(sz, 100, L"Budget: %d tiles", g_nTileBudget);
+  g_SampleUI.AddStatic(IDC_TILE_BUDGET_S, sz, 35, iY += 24, 125, 22);
+  g_SampleUI.AddSlider(IDC_TILE_BUDGET_SLIDER, 35, iY += 24, 125, 22, 1, 100,
+                       g_nTileBudget / 20);
+  g_SampleUI.AddCheckBox(IDC_STITCHING, L"Stitch tiles", 35, iY += 24, 125,
+                         22, g_bStitching);
+  g_SampleUI.AddCheckBox(IDC_SIMPLIFY, L"Simplify tiles", 35, iY += 24, 125,
+                         22, g_bSimplify);
+  StringCchPrintf(sz, 100, L"Max. error: %.2f", g_fSimplifyError);
+  g_SampleUI.AddStatic(IDC_SIMPLIFY_ERROR_S, sz, 35, iY += 24, 125, 22);
+  g_SampleUI.AddSlider(IDC_SIMPLIFY_ERROR, 35, iY += 24, 125, 22, 0, 100,
+                       (int)(100*g_fSimplifyError));
 
   g_SampleUI.AddStatic(0, L"Technique:", 35, iY += 24, 125, 22);
   g_SampleUI.AddComboBox(IDC_TECHNIQUE, 35, iY += 24, 125, 22);
@@ -406,8 +492,24 @@ void InitApp() {
 
   StringCchPrintf(sz, 100, L"LOD Levels: %d", g_nTerrainLOD);
   g_TerrainUI.AddStatic(IDC_NEWTERRAIN_LOD_S, sz, 0, iY += 24, 125, 22);
-  g_TerrainUI.AddSlider(IDC_NEWTERRAIN_LOD, 0, iY += 24, 125, 22, 0, 5,
-                  g_nTerrainLOD);
+  g_TerrainUI.AddSlider(IDC_NEWTERRAIN_LOD, 0, iY += 24, 125, 22, 0,
+                        g_bTerrainLazy ? g_nMaxLazyTerrainLOD :
+                                         g_nMaxEagerTerrainLOD,
+                        g_nTerrainLOD);
+  g_TerrainUI.AddCheckBox(IDC_NEWTERRAIN_LAZY, L"Generate on demand", 0,
+                          iY += 24, 125, 22, g_bTerrainLazy);
+  g_TerrainUI.AddCheckBox(IDC_NEWTERRAIN_RESIDUAL, L"Residual heights", 0,
+                          iY += 24, 125, 22, g_bTerrainResidual);
+  g_TerrainUI.AddCheckBox(IDC_NEWTERRAIN_QUANTIZED, L"16-bit heights", 0,
+                          iY += 24, 125, 22, g_bTerrainQuantized);
+  g_TerrainUI.AddStatic(0, L"Triangulation:", 0, iY += 24, 125, 22);
+  g_TerrainUI.AddComboBox(IDC_NEWTERRAIN_TRIANGULATION, 0, iY += 24, 125, 22);
+  g_TerrainUI.GetComboBox(IDC_NEWTERRAIN_TRIANGULATION)->AddItem(L"Lines", NULL);
+  g_TerrainUI.GetComboBox(IDC_NEWTERRAIN_TRIANGULATION)->AddItem(L"Z-Order", NULL);
+  g_TerrainUI.GetComboBox(IDC_NEWTERRAIN_TRIANGULATION)->AddItem(L"Vertex cache", NULL);
+  g_TerrainUI.GetComboBox(IDC_NEWTERRAIN_TRIANGULATION)->AddItem(L"Strips", NULL);
+  g_TerrainUI.GetComboBox(IDC_NEWTERRAIN_TRIANGULATION)->SetSelectedByIndex(
+      g_eTerrainTriangulation);
 
   StringCchPrintf(sz, 100, L"Scale: %.1f", g_fTerrainScale);
   g_TerrainUI.AddStatic(IDC_NEWTERRAIN_SCALE_S, sz, 0, iY += 24, 125, 22);
@@ -441,11 +543,65 @@ void RenderText() {
     g_pTxtHelper->DrawTextLine(sz);
     StringCchPrintf(sz, 100, L"LOD Levels: %d", g_nTerrainLOD);
     g_pTxtHelper->DrawTextLine(sz);
+    StringCchPrintf(sz, 100, L"Seed: %u", g_uiTerrainSeed);
+    g_pTxtHelper->DrawTextLine(sz);
+    const WCHAR *triangulations[] = { L"Lines", L"Z-Order", L"Vertex cache",
+                                      L"Strips" };
+    StringCchPrintf(sz, 100, L"Triangulation: %s",
+                    triangulations[g_eTerrainTriangulation]);
+    g_pTxtHelper->DrawTextLine(sz);
+    const WCHAR *policies[] = { L"FIFO", L"LRU" };
+    for (int policy = 0; policy < 2; ++policy) {
+      StringCchPrintf(sz, 100, L"%s %d/%d: ACMR %.3f/%.3f, ATVR %.2f/%.2f",
+                      policies[policy], g_nVertexCacheSizes[0],
+                      g_nVertexCacheSizes[1],
+                      g_VertexCacheStats[policy][0].acmr,
+                      g_VertexCacheStats[policy][1].acmr,
+                      g_VertexCacheStats[policy][0].atvr,
+                      g_VertexCacheStats[policy][1].atvr);
+      g_pTxtHelper->DrawTextLine(sz);
+    }
+    if (g_bTerrainLazy) {
+      StringCchPrintf(sz, 100, L"Cached Tiles: %u / %u",
+                      (UINT)g_pScene->GetTerrain()->GetNumCachedTiles(),
+                      g_uiMaxCachedTiles);
+      g_pTxtHelper->DrawTextLine(sz);
+    }
+    if (g_bTerrainResidual || g_bTerrainQuantized) {
+      std::vector<size_t> stored, full;
+      g_pScene->GetTerrain()->GetHeightMemory(&stored, &full);
+      for (size_t lod = 0; lod < stored.size(); ++lod) {
+        StringCchPrintf(sz, 100, L"Heights LOD %u: %.2f / %.2f MB", (UINT)lod,
+                        stored[lod] / 1048576.0f, full[lod] / 1048576.0f);
+        g_pTxtHelper->DrawTextLine(sz);
+      }
+    }
     D3DXVECTOR3 cam_pos = *g_Camera.GetEyePt();
     StringCchPrintf(sz, 100, L"Camera: (%f, %f, %f)", cam_pos.x, cam_pos.y, cam_pos.z);
     g_pTxtHelper->DrawTextLine(sz);
     StringCchPrintf(sz, 100, L"Trees: %d", g_pScene->GetTerrain()->GetNumTrees());
     g_pTxtHelper->DrawTextLine(sz);
+    const Terrain::CullingStats &stats = g_pScene->GetTerrain()->GetCullingStats();
+    StringCchPrintf(sz, 100, L"Tiles: %d visited, %d culled, %d drawn",
+                    stats.tiles_visited, stats.tiles_culled, stats.tiles_drawn);
+    g_pTxtHelper->DrawTextLine(sz);
+    StringCchPrintf(sz, 100, L"Triangles: %d drawn", stats.triangles_drawn);
+    g_pTxtHelper->DrawTextLine(sz);
+    StringCchPrintf(sz, 100, L"LOD: %d tests, %d split, %d merged, %d balanced",
+                    stats.lod_tests, stats.tiles_split, stats.tiles_merged,
+                    stats.tiles_balanced);
+    g_pTxtHelper->DrawTextLine(sz);
+    if (g_bTileBudget) {
+      const BudgetLODSelector *budget =
+          static_cast<const BudgetLODSelector *>(g_pLODSelector);
+      StringCchPrintf(sz, 100, L"Budget error: %.2f px",
+                      budget->GetAchievedError());
+      g_pTxtHelper->DrawTextLine(sz);
+    }
+    StringCchPrintf(sz, 100, L"Vegetation: %d visited, %d culled, %d drawn",
+                    stats.vegetation_visited, stats.vegetation_culled,
+                    stats.vegetation_drawn);
+    g_pTxtHelper->DrawTextLine(sz);
     if (g_bTSM) {
       g_pTxtHelper->DrawTextLine(L"Shadow Mapping Technique: Trapezoidal (EXPERIMENTAL)");
     } else {
@@ -569,8 +725,15 @@ HRESULT CALLBACK OnD3D10CreateDevice(ID3D10Device* pd3dDevice,
   g_pScene->SetLODSelector(g_pLODSelector);  
 
   // Terrain erzeugen
-  g_pScene->CreateTerrain(g_nTerrainN, g_fTerrainR, g_nTerrainLOD, g_fTerrainScale);
+  g_pScene->CreateTerrain(g_nTerrainN, g_fTerrainR, g_nTerrainLOD, g_fTerrainScale,
+                          g_uiTerrainSeed,
+                          g_bTerrainLazy ? g_uiMaxCachedTiles : 0,
+                          g_bTerrainResidual, g_bTerrainQuantized,
+                          g_eTerrainTriangulation);
   Terrain *terrain = g_pScene->GetTerrain();
+  terrain->SetStitching(g_bStitching);
+  terrain->SetSimplification(g_bSimplify ? g_fSimplifyError : -1.0f);
+  UpdateVertexCacheStats();
   g_pfMinHeight->SetFloat(terrain->GetMinHeight());
   g_pfMaxHeight->SetFloat(terrain->GetMaxHeight());
 
@@ -805,11 +968,8 @@ HRESULT CALLBACK OnD3D10ResizedSwapChain(ID3D10Device* pd3dDevice,
   g_TerrainUI.SetSize(150, 300);
 
   g_uiScreenHeight = pBackBufferSurfaceDesc->Height;
-  SAFE_DELETE(g_pLODSelector);
-  g_pLODSelector = new DynamicLODSelector(g_fFOV, g_uiScreenHeight,
-                                          g_fScreenError);
+  CreateLODSelector();
   if (g_pScene) {
-    g_pScene->SetLODSelector(g_pLODSelector);
     g_pScene->OnResizedSwapChain(pBackBufferSurfaceDesc->Width,
                                  pBackBufferSurfaceDesc->Height);
   }
@@ -1502,11 +1662,43 @@ void CALLBACK OnGUIEvent(UINT nEvent, int nControlID, CDXUTControl* pControl,
       StringCchPrintf(sz, 100, L"Screen error: %.1f", value);
       g_SampleUI.GetStatic(IDC_SCREEN_ERROR_S)->SetText(sz);
       g_fScreenError = value;
-      SAFE_DELETE(g_pLODSelector);
-      g_pLODSelector = new DynamicLODSelector(g_fFOV, g_uiScreenHeight, g_fScreenError);
-      if (g_pScene) g_pScene->SetLODSelector(g_pLODSelector);
+      CreateLODSelector();
+      break;
+    }
+    case IDC_GEOMETRIC_ERROR:
+      g_bGeometricError =
+          g_SampleUI.GetCheckBox(IDC_GEOMETRIC_ERROR)->GetChecked();
+      CreateLODSelector();
+      break;
+    case IDC_TILE_BUDGET:
+      g_bTileBudget = g_SampleUI.GetCheckBox(IDC_TILE_BUDGET)->GetChecked();
+      CreateLODSelector();
+      break;
+    case IDC_TILE_BUDGET_SLIDER: {
+      g_nTileBudget =
+          20 * g_SampleUI.GetSlider(IDC_TILE_BUDGET_SLIDER)->GetValue();
+      StringCchPrintf(sz, 100, L"Budget: %d tiles", g_nTileBudget);
+      g_SampleUI.GetStatic(IDC_TILE_BUDGET_S)->SetText(sz);
+      CreateLODSelector();
       break;
     }
+    case IDC_STITCHING:
+      g_bStitching = g_SampleUI.GetCheckBox(IDC_STITCHING)->GetChecked();
+      g_pScene->GetTerrain()->SetStitching(g_bStitching);
+      break;
+    case IDC_SIMPLIFY:
+      g_bSimplify = g_SampleUI.GetCheckBox(IDC_SIMPLIFY)->GetChecked();
+      g_pScene->GetTerrain()->SetSimplification(
+          g_bSimplify ? g_fSimplifyError : -1.0f);
+      break;
+    case IDC_SIMPLIFY_ERROR:
+      g_fSimplifyError =
+          g_SampleUI.GetSlider(IDC_SIMPLIFY_ERROR)->GetValue() / 100.0f;
+      StringCchPrintf(sz, 100, L"Max. error: %.2f", g_fSimplifyError);
+      g_SampleUI.GetStatic(IDC_SIMPLIFY_ERROR_S)->SetText(sz);
+      g_pScene->GetTerrain()->SetSimplification(
+          g_bSimplify ? g_fSimplifyError : -1.0f);
+      break;
     case IDC_POINT_EMITTER:
       g_bPointEmitter = g_SampleUI.GetCheckBox(IDC_POINT_EMITTER)->GetChecked();
       break;
@@ -1547,6 +1739,16 @@ void CALLBACK OnGUIEvent(UINT nEvent, int nControlID, CDXUTControl* pControl,
       g_TerrainUI.GetStatic(IDC_NEWTERRAIN_LOD_S)->SetText(sz);
       break;
     }
+    case IDC_NEWTERRAIN_LAZY: {
+      // Begrenzt auch den eingestellten Wert
+      const bool lazy =
+          g_TerrainUI.GetCheckBox(IDC_NEWTERRAIN_LAZY)->GetChecked();
+      CDXUTSlider *slider = g_TerrainUI.GetSlider(IDC_NEWTERRAIN_LOD);
+      slider->SetRange(0, lazy ? g_nMaxLazyTerrainLOD : g_nMaxEagerTerrainLOD);
+      StringCchPrintf(sz, 100, L"LOD Levels: %d", slider->GetValue());
+      g_TerrainUI.GetStatic(IDC_NEWTERRAIN_LOD_S)->SetText(sz);
+      break;
+    }
     case IDC_NEWTERRAIN_SCALE: {
       float value =
           g_TerrainUI.GetSlider(IDC_NEWTERRAIN_SCALE)->GetValue() / 10.0f;
@@ -1561,11 +1763,29 @@ void CALLBACK OnGUIEvent(UINT nEvent, int nControlID, CDXUTControl* pControl,
       g_fTerrainR =
           g_TerrainUI.GetSlider(IDC_NEWTERRAIN_ROUGHNESS)->GetValue()/100.0f;
       g_nTerrainLOD = g_TerrainUI.GetSlider(IDC_NEWTERRAIN_LOD)->GetValue();
+      g_bTerrainLazy = g_TerrainUI.GetCheckBox(IDC_NEWTERRAIN_LAZY)->GetChecked();
+      g_bTerrainResidual =
+          g_TerrainUI.GetCheckBox(IDC_NEWTERRAIN_RESIDUAL)->GetChecked();
+      g_bTerrainQuantized =
+          g_TerrainUI.GetCheckBox(IDC_NEWTERRAIN_QUANTIZED)->GetChecked();
+      g_eTerrainTriangulation = static_cast<Terrain::Triangulation>(
+          g_TerrainUI.GetComboBox(IDC_NEWTERRAIN_TRIANGULATION)->
+              GetSelectedIndex());
       g_fTerrainScale =
           g_TerrainUI.GetSlider(IDC_NEWTERRAIN_SCALE)->GetValue() / 10.0f;
-
-      g_pScene->CreateTerrain(g_nTerrainN, g_fTerrainR, g_nTerrainLOD, g_fTerrainScale);
+      // Neuer Startwert; wird in den Einstellungen angezeigt, damit sich das
+      // Terrain reproduzieren lsst
+      g_uiTerrainSeed = GetTickCount();
+
+      g_pScene->CreateTerrain(g_nTerrainN, g_fTerrainR, g_nTerrainLOD, g_fTerrainScale,
+                              g_uiTerrainSeed,
+                              g_bTerrainLazy ? g_uiMaxCachedTiles : 0,
+                              g_bTerrainResidual, g_bTerrainQuantized,
+                              g_eTerrainTriangulation);
       Terrain *terrain = g_pScene->GetTerrain();
+      terrain->SetStitching(g_bStitching);
+      terrain->SetSimplification(g_bSimplify ? g_fSimplifyError : -1.0f);
+      UpdateVertexCacheStats();
       g_pfMinHeight->SetFloat(terrain->GetMinHeight());
       g_pfMaxHeight->SetFloat(terrain->GetMaxHeight());
 
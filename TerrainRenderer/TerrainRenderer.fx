@@ -74,7 +74,7 @@ Texture2D g_tDepth;
 
 Texture2D g_tWaves;
 Texture2D g_tGround;
-Texture2D g_tTerrain; // Terrain heights
+Texture2D<uint2> g_tTerrain; // Terrain heights and packed normals (Tile::Texel)
 Texture3D g_tGround3D;
 Texture2D g_tMesh; // Tree texture
 TextureCube g_tCubeMap;
@@ -161,7 +161,7 @@ const int g_nSpots = NUM_SPOTS;
 const float g_Spots[NUM_SPOTS] = {
   -1.0,      // Tiefes Wasser
   -0.25,     // Seichtes Wasser
-   0.0,      // Kste
+   0.0,      // Küste
    0.0625,   // Strand
    0.125,    // Gras
    0.375,    // Wald
@@ -524,9 +524,36 @@ float3 FullLighting(float3 vColor,
       phong.SpecularLight;
 }
 
+// Decodes a normal packed by PackedNormal::Encode (octahedral, 2x16 bit snorm)
+float3 DecodeNormal(uint uiPacked)
+{
+  int2 vPacked = int2(asint(uiPacked << 16), asint(uiPacked)) >> 16;
+  float2 vOct = max(vPacked / 32767.0, -1);
+  float3 vNormal = float3(vOct.x, 1 - abs(vOct.x) - abs(vOct.y), vOct.y);
+  float fFold = saturate(-vNormal.y);
+  vNormal.xz -= (vNormal.xz >= 0 ? fFold : -fFold);
+  return normalize(vNormal);
+}
+
+// Returns normal (xyz) and height (w) of the tile vertex at vPosition
 float4 GetTileData(float2 vPosition)
 {
-  return g_tTerrain.Load(float3(vPosition.xy, 0) * (g_uiTerrainSize - 1));
+  uint2 vTexel = g_tTerrain.Load(int3(vPosition.xy * (g_uiTerrainSize - 1), 0));
+  return float4(DecodeNormal(vTexel.y), asfloat(vTexel.x));
+}
+
+// Returns the bilinearly interpolated tile height at vTexCoord (0..1), the
+// packed texture cannot be filtered by the sampler
+float GetTileHeight(float2 vTexCoord)
+{
+  float2 vTexel = vTexCoord * (g_uiTerrainSize - 1);
+  int2 vBase = min(int2(vTexel), int(g_uiTerrainSize) - 2);
+  float2 vFactor = vTexel - vBase;
+  float fNW = asfloat(g_tTerrain.Load(int3(vBase, 0)).x);
+  float fNE = asfloat(g_tTerrain.Load(int3(vBase + int2(1, 0), 0)).x);
+  float fSW = asfloat(g_tTerrain.Load(int3(vBase + int2(0, 1), 0)).x);
+  float fSE = asfloat(g_tTerrain.Load(int3(vBase + int2(1, 1), 0)).x);
+  return lerp(lerp(fNW, fNE, vFactor.x), lerp(fSW, fSE, vFactor.x), vFactor.y);
 }
 
 float4 GetTileVertex(float2 vPosition)
@@ -1331,7 +1358,7 @@ technique10 PointShadowMap
   }
 }
 
-// Nur fr Debug-Zwecke gebraucht
+// Nur für Debug-Zwecke gebraucht
 technique10 RenderToScreen
 {
   pass P0
@@ -1775,8 +1802,7 @@ bool CollisionDetect(PARTICLE In)
 {
   float2 vTexCoord = (In.Position.xz - g_vTileTranslate) / g_fTileScale;
   if (all(vTexCoord >= float2(0, 0) && vTexCoord <= float2(1, 1))) {
-    float4 vHeightMap = g_tTerrain.SampleLevel(g_ssLinear, vTexCoord, 0);
-    return vHeightMap.w >= In.Position.y;
+    return GetTileHeight(vTexCoord) >= In.Position.y;
   } else return false;
 }
 
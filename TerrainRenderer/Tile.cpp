@@ -1,12 +1,16 @@
-#include <ctime>
+#include <algorithm>
 #include <cmath>
 #include <limits>
+#include <vector>
 #include "Tile.h"
-#include "LODSelector.h"
+#include "Frustum.h"
 #include "Terrain.h"
+#include "TileGenerator.h"
+#include "PackedNormal.h"
 #include "Vegetation.h"
 #include "Gras.h"
 
+#include <emmintrin.h>
 #include <D3DX10Math.h>
 
 // Die Makros min und max aus windef.h vertragen sich nicht mit std::min,
@@ -14,6 +18,14 @@
 #undef min
 #undef max
 
+// Grte Ausdehnung der Vegetation ber ihren Samen hinaus, fr das Culling
+// (Grser sind hchstens 0,25 hoch, siehe Gras::PlaceSeed und Grass_GS)
+const float VEGETATION_MARGIN = 0.5f;
+
+// Kantenlnge der kleinsten Blcke der Zellblock-Pyramide fr Raycast (in
+// Zellen)
+const int RAY_BLOCK_CELLS = 8;
+
 // Makro, um die Indexberechnungen fr das "flachgeklopfte" 2D-Array von
 // Vertices zu vereinfachen
 #define I(x,y) (static_cast<unsigned int>(y)*size_+static_cast<unsigned int>(x))
@@ -21,39 +33,199 @@
 namespace {
 
 /**
- * Generiert zufllige Fliekommazahl zwischen -1 und 1
+ * Anzahl der Vertex-Zeilen, die CalculateNormals am Stck bearbeitet
+ */
+const int NORMAL_BLOCK_ROWS = 32;
+/**
+ * Werte je Zelle in einer Zeile von Face-Normalen (siehe ComputeFaceRow)
+ */
+const int FACE_ROW_FLOATS = 6;
+
+/**
+ * Berechnet die Face-Normalen einer Zeile von num_cells Zellen zwischen den
+ * Hhenzeilen north und south (je num_cells + 1 Werte). Jede Zelle ist
+ * entlang der Diagonale SW-NE geteilt (wie bei Terrain::TriangulateLines und
+ * Terrain::TriangulateZOrder), mit den Hhen nw, ne, sw, se und dem
+ * Vertex-Abstand d ist die Normale von
+ *   Dreieck NW-SW-NE: (nw - ne, d, nw - sw)
+ *   Dreieck NE-SW-SE: (sw - se, d, ne - se)
+ * jeweils normiert. faces enthlt nacheinander die x-, y- und z-Komponenten
+ * des ersten und dann des zweiten Dreiecks (je num_cells Werte).
+ * Bearbeitet mit SSE vier Zellen gleichzeitig, num_cells muss daher ein
+ * Vielfaches von 4 sein. Da alle Zellen denselben Weg nehmen, hngt das
+ * Ergebnis einer Zelle nicht von ihrer Position in der Zeile ab.
+ */
+void ComputeFaceRow(const float *north, const float *south, int num_cells,
+                    float d, float *faces) {
+  assert(num_cells % 4 == 0);
+  float *upper_x = faces, *upper_y = upper_x + num_cells;
+  float *upper_z = upper_y + num_cells, *lower_x = upper_z + num_cells;
+  float *lower_y = lower_x + num_cells, *lower_z = lower_y + num_cells;
+  const __m128 d4 = _mm_set1_ps(d);
+  const __m128 d2 = _mm_set1_ps(d * d);
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (int x = 0; x < num_cells; x += 4) {
+    const __m128 nw = _mm_loadu_ps(north + x);
+    const __m128 ne = _mm_loadu_ps(north + x + 1);
+    const __m128 sw = _mm_loadu_ps(south + x);
+    const __m128 se = _mm_loadu_ps(south + x + 1);
+    __m128 nx = _mm_sub_ps(nw, ne);
+    __m128 nz = _mm_sub_ps(nw, sw);
+    __m128 inv = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(nz, nz)), d2)));
+    _mm_storeu_ps(upper_x + x, _mm_mul_ps(nx, inv));
+    _mm_storeu_ps(upper_y + x, _mm_mul_ps(d4, inv));
+    _mm_storeu_ps(upper_z + x, _mm_mul_ps(nz, inv));
+    nx = _mm_sub_ps(sw, se);
+    nz = _mm_sub_ps(ne, se);
+    inv = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(nz, nz)), d2)));
+    _mm_storeu_ps(lower_x + x, _mm_mul_ps(nx, inv));
+    _mm_storeu_ps(lower_y + x, _mm_mul_ps(d4, inv));
+    _mm_storeu_ps(lower_z + x, _mm_mul_ps(nz, inv));
+  }
+}
+
+/**
+ * Berechnet fr eine Zeile von num_vertices Vertices die Summe der
+ * Face-Normalen der angrenzenden Dreiecke. above und below sind die
+ * Face-Normalen (siehe ComputeFaceRow, Abstand der Komponenten stride) der
+ * Zellzeilen ber bzw. unter den Vertices, NULL wenn es diese nicht gibt.
+ * Zelle i liegt links, Zelle i + 1 rechts von Vertex i; has_west bzw.
+ * has_east gibt an, ob die Zelle links vom ersten bzw. rechts vom letzten
+ * Vertex existiert. Jeder Vertex gehrt zu sechs Dreiecken: NW-SW-NE der
+ * Zellen rechts unten, links unten und rechts oben, NE-SW-SE der Zellen
+ * links oben, links unten und rechts oben. Die Summationsreihenfolge hngt
+ * nur von der Lage der Dreiecke zum Vertex ab, gemeinsame Rand-Vertices
+ * benachbarter Tiles erhalten dadurch bitgenau dieselbe Summe.
+ */
+void SumFaceRow(const float *above, const float *below, int stride,
+                int num_vertices, bool has_west, bool has_east,
+                D3DXVECTOR3 *sums) {
+  const int n = stride;
+  for (int x = 0; x < num_vertices; ++x) {
+    const int left = x, right = x + 1;
+    const bool use_left = x > 0 || has_west;
+    const bool use_right = x < num_vertices - 1 || has_east;
+    D3DXVECTOR3 sum(0.0f, 0.0f, 0.0f);
+    if (below) {
+      if (use_right) {
+        sum += D3DXVECTOR3(below[right], below[n + right],
+                           below[2*n + right]);
+      }
+      if (use_left) {
+        sum += D3DXVECTOR3(below[left] + below[3*n + left],
+                           below[n + left] + below[4*n + left],
+                           below[2*n + left] + below[5*n + left]);
+      }
+    }
+    if (above) {
+      if (use_right) {
+        sum += D3DXVECTOR3(above[right] + above[3*n + right],
+                           above[n + right] + above[4*n + right],
+                           above[2*n + right] + above[5*n + right]);
+      }
+      if (use_left) {
+        sum += D3DXVECTOR3(above[3*n + left], above[4*n + left],
+                           above[5*n + left]);
+      }
+    }
+    sums[x] = sum;
+  }
+}
+
+/**
+ * Schneidet den Strahl mit der achsenparallelen Box [lo, hi] und beschrnkt
+ * [t_min, t_max] auf den Bereich innerhalb der Box (Slab-Test). Die Box wird
+ * leicht vergrert, damit Schnittpunkte genau auf ihrem Rand (z.B. auf
+ * ebenen Wasserflchen) nicht durch Rundungsfehler verloren gehen.
+ * @return Ob der Bereich nicht leer ist
+ */
+bool IntersectBox(const Tile::Ray &ray, const D3DXVECTOR3 &lo,
+                  const D3DXVECTOR3 &hi, float *t_min, float *t_max) {
+  const float *origin = ray.origin;
+  const float *inv_dir = ray.inv_dir;
+  const float *box_lo = lo, *box_hi = hi;
+  const float padding = 1e-4f * (hi.x - lo.x);
+  float t0 = *t_min, t1 = *t_max;
+  for (int axis = 0; axis < 3; ++axis) {
+    float near_t = (box_lo[axis] - padding - origin[axis]) * inv_dir[axis];
+    float far_t = (box_hi[axis] + padding - origin[axis]) * inv_dir[axis];
+    if (near_t > far_t) std::swap(near_t, far_t);
+    // NaN (Strahl parallel in der Ebene der Box) lsst den Bereich offen
+    if (near_t > t0) t0 = near_t;
+    if (far_t < t1) t1 = far_t;
+  }
+  *t_min = t0;
+  *t_max = t1;
+  return t0 <= t1;
+}
+
+/**
+ * Schneidet den Strahl mit dem Dreieck (a, b, c) (Mller-Trumbore, beide
+ * Seiten). Die Toleranz bei den baryzentrischen Koordinaten schliet Lcken
+ * auf gemeinsamen Kanten.
  */
-inline float randf(void) {
-  return rand() / (RAND_MAX * 0.5f) - 1.0f;
+bool IntersectTriangle(const Tile::Ray &ray, const D3DXVECTOR3 &a,
+                       const D3DXVECTOR3 &b, const D3DXVECTOR3 &c,
+                       float *t_hit) {
+  const float EPSILON = 1e-4f;
+  const D3DXVECTOR3 edge1 = b - a, edge2 = c - a;
+  D3DXVECTOR3 p, q;
+  D3DXVec3Cross(&p, &ray.dir, &edge2);
+  const float det = D3DXVec3Dot(&edge1, &p);
+  if (det == 0.0f) return false;
+  const float inv_det = 1.0f / det;
+  const D3DXVECTOR3 s = ray.origin - a;
+  const float u = D3DXVec3Dot(&s, &p) * inv_det;
+  if (u < -EPSILON || u > 1.0f + EPSILON) return false;
+  D3DXVec3Cross(&q, &s, &edge1);
+  const float v = D3DXVec3Dot(&ray.dir, &q) * inv_det;
+  if (v < -EPSILON || u + v > 1.0f + EPSILON) return false;
+  const float t = D3DXVec3Dot(&edge2, &q) * inv_det;
+  if (t < ray.t_min || t > ray.t_max) return false;
+  *t_hit = t;
+  return true;
 }
 
 }
 
-Tile::Tile(Terrain *terrain, int n, float roughness, int num_lod, float scale,
-           bool water)
+Tile::Tile(Terrain *terrain, int n, int num_lod, float scale, bool water)
     : lod_(0),
       size_((1 << n) + 1),
       num_lod_(num_lod),
       vertex_normals_(NULL),
       terrain_(terrain),
       parent_(NULL),
+      tile_x_(0),
+      tile_y_(0),
+      height_offset_(0),
+      height_step_(0),
       min_height_(0),
       max_height_(0),
+      deviation_(0),
+      geometric_error_(0),
+      block_cells_(0),
       scale_(scale),
       translation_(D3DXVECTOR2(-.5f*scale_, -.5f*scale)),
       height_map_(NULL),
       shader_resource_view_(NULL),
+      simplified_error_(-1.0f),
+      simplified_triangles_(-1),
       vegetation_(NULL),
-      should_cull_(false) {
-  heights_ = new float[size_*size_];
-  Init(roughness);
-  InitChildren(roughness, NULL, NULL);
-  if (water) CreateWater();
-  CalculateHeights();
+      water_(water),
+      residual_(false),
+      last_used_(0) {
+  for (int dir = 0; dir < 4; ++dir) children_[dir] = NULL;
+  const TileArena::Block block = terrain_->arena_->GetRootBlock();
+  heights_ = block.heights;
+  quantized_heights_ = block.quantized_heights;
+  vertex_normals_ = block.normals;
+  Init();
 }
 
 Tile::Tile(Tile *parent, Tile::Direction direction,
-           float roughness, Tile *north, Tile *west)
+           const TileArena::Block &block)
     : lod_(parent->lod_ + 1),
       size_(parent->size_),
       num_lod_(parent->num_lod_ - 1),
@@ -61,193 +233,199 @@ Tile::Tile(Tile *parent, Tile::Direction direction,
       direction_(direction),
       terrain_(parent->terrain_),
       parent_(parent),
+      tile_x_(2 * parent->tile_x_ + (direction & 1)),
+      tile_y_(2 * parent->tile_y_ + (direction >> 1)),
+      height_offset_(0),
+      height_step_(0),
       min_height_(0),
       max_height_(0),
+      deviation_(0),
+      geometric_error_(0),
+      block_cells_(0),
       scale_(parent->scale_*0.5f),
       translation_(parent->translation_),
       height_map_(NULL),
       shader_resource_view_(NULL),
+      simplified_error_(-1.0f),
+      simplified_triangles_(-1),
       vegetation_(NULL),
-      should_cull_(false) {
+      water_(parent->water_),
+      residual_(parent->terrain_->residual_heights_),
+      last_used_(0) {
   switch (direction) {
     case NW: translation_ += D3DXVECTOR2(     0,      0); break;
     case NE: translation_ += D3DXVECTOR2(scale_,      0); break;
     case SE: translation_ += D3DXVECTOR2(scale_, scale_); break;
     case SW: translation_ += D3DXVECTOR2(     0, scale_); break;
   }
-  heights_ = new float[size_*size_];
-  InitFromParent();
-  Refine(2, roughness);
-  FixEdges(north, west);
-  InitChildren(roughness, north, west);  
+  for (int dir = 0; dir < 4; ++dir) children_[dir] = NULL;
+  heights_ = block.heights;
+  quantized_heights_ = block.quantized_heights;
+  vertex_normals_ = block.normals;
 }
 
 Tile::~Tile(void) {
-  SAFE_DELETE_ARRAY(heights_);
-  SAFE_DELETE_ARRAY(vertex_normals_);
   SAFE_DELETE(vegetation_);
-  if (num_lod_ > 0) {
-    for (int dir = 0; dir < 4; ++dir) {
-      delete children_[dir];
-    }
+  for (int dir = 0; dir < 4; ++dir) {
+    delete children_[dir];
   }
   ReleaseBuffers();
 }
 
-void Tile::Init(float roughness) {
-  // Zufallsgenerator initialisieren
-  srand(static_cast<unsigned int>(time(0)));
-
-  // Ecken mit Zufallshhenwerten initialisieren
-  int block_size = size_ - 1;
-  heights_[I(0, 0)] = randf();
-  heights_[I(0, block_size)]= randf();
-  heights_[I(block_size, 0)] = randf();
-  heights_[I(block_size, block_size)] = randf();
+void Tile::Init(void) {
+  if (!IsQuantized()) {
+    terrain_->generator_->Generate(0, 0, 0, heights_);
+    return;
+  }
+  std::vector<float> heights(GetResolution());
+  terrain_->generator_->Generate(0, 0, 0, &heights[0]);
+  StoreHeights(&heights[0]);
+}
 
-  // Verfeinerungsschritte durchfhren bis smtliche Werte berechnet sind
-  while (block_size > 1) {
-    Refine(block_size, roughness);
-    block_size = block_size / 2;
+void Tile::CreateChildren(void) {
+  if (num_lod_ <= 0) return;
+  TileArena::Block blocks[4];
+  terrain_->arena_->GetChildBlocks(lod_, tile_x_, tile_y_, blocks);
+  for (int dir = 0; dir < 4; ++dir) {
+    children_[dir] = new Tile(this, static_cast<Direction>(dir), blocks[dir]);
   }
 }
 
-void Tile::InitFromParent(void) {
-  int x1 = 0, y1 = 0;
-  switch (direction_) {
-    case NW: x1 = 0;         y1 = 0;         break;
-    case NE: x1 = size_ / 2; y1 = 0;         break;
-    case SW: x1 = 0;         y1 = size_ / 2; break;
-    case SE: x1 = size_ / 2; y1 = size_ / 2; break;
+void Tile::Generate(void) {
+  const TileGenerator *generator = terrain_->generator_;
+  if (!residual_ && !parent_->residual_ && !IsQuantized()) {
+    generator->GenerateFromParent(lod_, tile_x_, tile_y_, parent_->heights_,
+                                  heights_);
+    return;
   }
 
-  // y-Werte aus dem entsprechenden Quadranten des Eltern-Tiles bernehmen
-  for (int y = 0; y < size_; y += 2) {
-    for (int x = 0; x < size_; x += 2) {
-      heights_[I(x,y)] = parent_->heights_[I(x/2+x1,y/2+y1)];
-    }
+  // ber vollstndige Zwischenspeicher gehen
+  const int resolution = GetResolution();
+  std::vector<float> heights(resolution);
+  if (IsQuantized()) {
+    // Die dekodierten Werte des Eltern-Tiles sind nicht exakt (und an den
+    // Rndern benachbarter Eltern-Tiles verschieden), daher direkt aus dem
+    // Startwert berechnen
+    generator->Generate(lod_, tile_x_, tile_y_, &heights[0]);
+  } else {
+    std::vector<float> parent_heights(resolution);
+    parent_->GetRawHeights(&parent_heights[0]);
+    generator->GenerateFromParent(lod_, tile_x_, tile_y_, &parent_heights[0],
+                                  &heights[0]);
   }
+  StoreHeights(&heights[0]);
 }
 
-void Tile::Refine(int block_size, float roughness) {
-  int block_size_h = block_size/2;
-  float offset_factor = (0.2f * scale_) * roughness * block_size / (size_ - 1);
-
-  for (int y = block_size_h; y < size_; y += block_size) {
-    for (int x = block_size_h; x < size_; x += block_size) {
-      // Lookup der umliegenden Hhenwerte (-); o ist Position (x, y)
-      // -   -
-      //   o
-      // -   -
-      float nw = heights_[I(x - block_size_h, y - block_size_h)];
-      float ne = heights_[I(x + block_size_h, y - block_size_h)];
-      float sw = heights_[I(x - block_size_h, y + block_size_h)];
-      float se = heights_[I(x + block_size_h, y + block_size_h)];
-
-      // Berechnung der neuen Hhenwerte (+)
-      // - + -
-      // + +
-      // -   -
-      float center = (nw + ne + sw + se) / 4 + offset_factor * randf();
-      heights_[I(x, y)] = center;
-
-      float n = nw + ne + center;
-      if (y > block_size_h) {
-        n += heights_[I(x, y - block_size)];
-        n /= 4;
-      } else {
-        n /= 3;
+void Tile::StoreHeights(const float *heights) {
+  const int num_stored = GetNumStoredHeights();
+  std::vector<float> residuals;
+  if (residual_) {
+    // Nur die neu berechneten Werte speichern (x oder y ungerade)
+    residuals.reserve(num_stored);
+    for (int y = 0; y < size_; ++y) {
+      for (int x = (y & 1) ? 0 : 1; x < size_; x += (y & 1) ? 1 : 2) {
+        residuals.push_back(heights[I(x, y)]);
       }
-      heights_[I(x, y - block_size_h)] = n + offset_factor * randf();
+    }
+    heights = &residuals[0];
+  }
+  if (!IsQuantized()) {
+    std::copy(heights, heights + num_stored, heights_);
+    return;
+  }
 
-      float w = nw + sw + center;
-      if (x > block_size_h) {
-        w += heights_[I(x - block_size, y)];
-        w /= 4;
-      } else {
-        w /= 3;
-      }
-      heights_[I(x - block_size_h, y)] = w + offset_factor * randf();
-
-      // Edge cases: Berechnung neuer Hhenwerte am rechten bzw. unteren Rand
-      // -   -
-      //     +
-      // - + -
-      if (x == size_ - 1 - block_size_h) {
-        heights_[I(x + block_size_h, y)] =
-            (ne + se + center) / 3 + offset_factor * randf();
-      }
-      if (y == size_ - 1 - block_size_h) {
-        heights_[I(x, y + block_size_h)] =
-            (sw + se + center) / 3 + offset_factor * randf();
-      }
+  // Bei Wasser die begrenzten Werte quantisieren, sonst wre die
+  // Schrittweite grer als ntig. Die unbegrenzten Werte werden im
+  // 16-Bit-Modus nicht verfeinert (siehe Generate), alle Leser begrenzen
+  // ohnehin wie GetHeight.
+  std::vector<float> clamped;
+  if (water_) {
+    clamped.assign(heights, heights + num_stored);
+    for (int i = 0; i < num_stored; ++i) {
+      if (clamped[i] < 0.0f) clamped[i] = 0.0f;
     }
+    heights = &clamped[0];
+  }
+
+  // Auf 16 Bit zwischen minimalem und maximalem Wert quantisieren, der
+  // maximale Fehler ist also height_step_ / 2
+  const float min = *std::min_element(heights, heights + num_stored);
+  const float max = *std::max_element(heights, heights + num_stored);
+  height_offset_ = min;
+  height_step_ = (max - min) / 65535.0f;
+  const float inv_step = height_step_ > 0.0f ? 1.0f / height_step_ : 0.0f;
+  for (int i = 0; i < num_stored; ++i) {
+    const float q = (heights[i] - min) * inv_step + 0.5f;
+    quantized_heights_[i] =
+        static_cast<unsigned short>(q < 65535.0f ? q : 65535.0f);
   }
 }
 
-void Tile::InitChildren(float roughness, Tile *north, Tile *west) {
-  if (num_lod_ <= 0) return;
+int Tile::GetNumStoredHeights(int size, bool residual) {
+  if (!residual) return size * size;
+  const int num_even = (size + 1) / 2;
+  return size * size - num_even * num_even;
+}
 
-  // Holen benachbarter Kind-Tiles:
-  //     +---+---+
-  //     |NNW|NNE|
-  // +---+---+---+
-  // |NWW|       |
-  // +---+ this  +
-  // |SWW|       |
-  // +---+---+---+
-  Tile *child_NNW, *child_NNE, *child_NWW, *child_SWW;
-  if (north) {
-    child_NNW = north->children_[SW];
-    child_NNE = north->children_[SE];
-  } else {
-    child_NNW = child_NNE = NULL;
+float Tile::GetResidualHeight(int index) const {
+  const int x = index % size_;
+  const int y = index / size_;
+  if ((x & 1) || (y & 1)) {
+    // Zeilen mit geradem y speichern nur die ungeraden x
+    const int m = (size_ - 1) / 2;
+    const int row = ((y + 1) / 2) * m + (y / 2) * size_;
+    return GetStoredHeight(row + ((y & 1) ? x : x / 2));
   }
-  if (west) {
-    child_NWW = west->children_[NE];
-    child_SWW = west->children_[SE];
-  } else {
-    child_NWW = child_SWW = NULL;
-  }
-
-  // Erzeugen der Kind-Tiles mit bergabe der Nachbarschaftsinformationen
-  //roughness /= 2; // Halbiere Rauheits-Faktor, um die genderten
-                  // Grenverhltnisse zu transportieren
-  children_[NW] = new Tile(this, NW, roughness, child_NNW, child_NWW);
-  children_[NE] = new Tile(this, NE, roughness, child_NNE, children_[NW]);
-  children_[SW] = new Tile(this, SW, roughness, children_[NW], child_SWW);
-  children_[SE] = new Tile(this, SE, roughness, children_[NE], children_[SW]);
+  // Gerade Werte stammen unverndert aus dem Quadranten des Eltern-Tiles
+  const int x1 = (tile_x_ & 1) * (size_ / 2);
+  const int y1 = (tile_y_ & 1) * (size_ / 2);
+  return parent_->GetRawHeight(I(x/2 + x1, y/2 + y1));
 }
 
-void Tile::FixEdges(Tile *north, Tile *west) {
-  if (north) {
-    for (int x = 1; x < size_; x += 2) {
-      heights_[I(x,0)] = north->heights_[I(x,size_-1)];
-    }
+void Tile::GetRawHeights(float *out) const {
+  if (!residual_) {
+    for (int i = 0; i < GetResolution(); ++i) out[i] = GetStoredHeight(i);
+    return;
   }
-  if (west) {
-    for (int y = 1; y < size_; y += 2) {
-      heights_[I(0,y)] = west->heights_[I(size_-1,y)];
+  const int x1 = (tile_x_ & 1) * (size_ / 2);
+  const int y1 = (tile_y_ & 1) * (size_ / 2);
+  int i = 0;
+  for (int y = 0; y < size_; ++y) {
+    for (int x = 0; x < size_; ++x) {
+      if ((x & 1) || (y & 1)) {
+        out[I(x, y)] = GetStoredHeight(i++);
+      } else {
+        out[I(x, y)] = parent_->GetRawHeight(I(x/2 + x1, y/2 + y1));
+      }
     }
   }
 }
 
-void Tile::CreateWater(void) {
-  const int res = GetResolution();
-  for (int i = 0; i < res; ++i)
-    heights_[i] = std::max(heights_[i], 0.0f);
-  if (num_lod_ > 0) {
+void Tile::GetHeightMemory(std::vector<size_t> *stored,
+                           std::vector<size_t> *full) const {
+  if (stored->size() <= static_cast<size_t>(lod_)) {
+    stored->resize(lod_ + 1, 0);
+    full->resize(lod_ + 1, 0);
+  }
+  const size_t height_bytes =
+      IsQuantized() ? sizeof(unsigned short) : sizeof(float);
+  (*stored)[lod_] += height_bytes * GetNumStoredHeights();
+  (*full)[lod_] += sizeof(float) * GetResolution();
+  if (HasChildren()) {
     for (int dir = 0; dir < 4; ++dir) {
-      children_[dir]->CreateWater();
+      children_[dir]->GetHeightMemory(stored, full);
     }
   }
 }
 
 void Tile::CalculateHeights() {
-  assert(heights_ != NULL);
+  assert(heights_ != NULL || quantized_heights_ != NULL);
   float min = std::numeric_limits<float>::max();
-  float max = std::numeric_limits<float>::min();
-  if (num_lod_ > 0) {
+  // min() ist die kleinste positive Zahl: Tiles ganz unter Wasser bekmen
+  // sonst diese als Maximum, und die Tests gegen ihre Bounding-Box rechnen
+  // mit denormalisierten Zahlen (sehr langsam)
+  float max = -std::numeric_limits<float>::max();
+  if (HasChildren()) {
     for (int dir = 0; dir < 4; ++dir) {
       children_[dir]->CalculateHeights();
       min = std::min(min, children_[dir]->min_height_);
@@ -256,15 +434,74 @@ void Tile::CalculateHeights() {
   } else {
     const int res = GetResolution();
     for (int i = 0; i < res; ++i) {
-      min = std::min(min, heights_[i]);
-      max = std::max(max, heights_[i]);
+      min = std::min(min, GetHeight(i));
+      max = std::max(max, GetHeight(i));
     }
   }
 
   min_height_ = min;
   max_height_ = max;
+  if (lod_ == terrain_->resident_lod_) CalculateBlockBounds();
+
+  if (parent_ != NULL) CalculateDeviation();
+  UpdateGeometricError();
 }
 
+void Tile::CalculateDeviation(void) {
+  float deviation = 0;
+  for (int y = 0; y < size_; ++y) {
+    for (int x = (y & 1) ? 0 : 1; x < size_; x += (y & 1) ? 1 : 2) {
+      // Hhe des Eltern-Tiles an (x, y): Mitte einer waagrechten bzw.
+      // senkrechten Kante oder der Diagonale SW-NE der Zelle
+      float a, b;
+      if ((y & 1) == 0) {
+        a = GetHeight(I(x - 1, y));
+        b = GetHeight(I(x + 1, y));
+      } else if ((x & 1) == 0) {
+        a = GetHeight(I(x, y - 1));
+        b = GetHeight(I(x, y + 1));
+      } else {
+        a = GetHeight(I(x + 1, y - 1));
+        b = GetHeight(I(x - 1, y + 1));
+      }
+      const float parent_height = 0.5f * (a + b);
+      deviation = std::max(deviation,
+                           std::abs(GetHeight(I(x, y)) - parent_height));
+    }
+  }
+  deviation_ = deviation;
+}
+
+bool Tile::UpdateGeometricError(void) {
+  float error = 0;
+  if (HasChildren()) {
+    for (int dir = 0; dir < 4; ++dir) {
+      error = std::max(error, std::max(children_[dir]->deviation_,
+                                       children_[dir]->geometric_error_));
+    }
+  } else if (num_lod_ > 0) {
+    error = 0.5f * deviation_;
+  }
+  if (error == geometric_error_) return false;
+  geometric_error_ = error;
+  return true;
+}
+
+bool Tile::UpdateHeightBounds(void) {
+  assert(HasChildren());
+  bool changed = false;
+  for (int dir = 0; dir < 4; ++dir) {
+    if (children_[dir]->min_height_ < min_height_) {
+      min_height_ = children_[dir]->min_height_;
+      changed = true;
+    }
+    if (children_[dir]->max_height_ > max_height_) {
+      max_height_ = children_[dir]->max_height_;
+      changed = true;
+    }
+  }
+  return changed;
+}
 
 float Tile::GetMinHeight(void) const {
   return min_height_;
@@ -275,14 +512,14 @@ float Tile::GetMaxHeight(void) const {
 }
 
 D3DXVECTOR3 Tile::GetHighestPoint(void) const {
-  assert(heights_ != NULL);
+  assert(heights_ != NULL || quantized_heights_ != NULL);
   float max = std::numeric_limits<float>::min();
   const int res = GetResolution();
   int idx = -1;
   for (int i = 0; i < res; ++i) {
-    if (heights_[i] > max) {
+    if (GetHeight(i) > max) {
       idx = i;
-      max = heights_[i];
+      max = GetHeight(i);
     }
   }
   if (idx == -1) return D3DXVECTOR3(0, 0, 0);
@@ -291,7 +528,9 @@ D3DXVECTOR3 Tile::GetHighestPoint(void) const {
 
 float Tile::GetHeightAt(const D3DXVECTOR3 &pos) const {
   D3DXVECTOR2 pos2d = D3DXVECTOR2(pos.x, pos.z);
-  if (num_lod_ > 0) {
+  // Nur bis zur residenten Stufe absteigen, bei Bedarf geladene Kinder
+  // bleiben unbercksichtigt (siehe Tile.h)
+  if (lod_ < terrain_->resident_lod_) {
     D3DXVECTOR2 mid = D3DXVECTOR2(0.5f*scale_, 0.5f*scale_) + translation_;
     if (pos2d.x < mid.x) {
       if (pos2d.y < mid.y) return children_[NW]->GetHeightAt(pos);
@@ -330,14 +569,14 @@ float Tile::GetHeightAt(const D3DXVECTOR3 &pos) const {
 
     if (xfactor == 0.0f) {
       // NW-SW-Linie
-      float height_nw = heights_[I(texel_coords.x, texel_coords.y)];
+      float height_nw = GetHeight(I(texel_coords.x, texel_coords.y));
       if (yfactor == 0.0f) return height_nw;
-      float height_sw = heights_[I(texel_coords.x, texel_coords.y + 1)];
+      float height_sw = GetHeight(I(texel_coords.x, texel_coords.y + 1));
       return yfactor*height_sw + (1-yfactor)*height_nw;
     } else if (yfactor == 0.0f) {
       // NW-NE-Linie
-      float height_nw = heights_[I(texel_coords.x, texel_coords.y)];
-      float height_ne = heights_[I(texel_coords.x + 1, texel_coords.y)];
+      float height_nw = GetHeight(I(texel_coords.x, texel_coords.y));
+      float height_ne = GetHeight(I(texel_coords.x + 1, texel_coords.y));
       return xfactor*height_ne + (1-xfactor)*height_nw;
     }
 
@@ -346,17 +585,17 @@ float Tile::GetHeightAt(const D3DXVECTOR3 &pos) const {
     //
     if (xfactor + yfactor <= 1.0f) {
       // SW-NE-NW-Dreieck
-      float height_nw = heights_[I(texel_coords.x, texel_coords.y)];
-      float height_sw = heights_[I(texel_coords.x, texel_coords.y + 1)];
-      float height_ne = heights_[I(texel_coords.x + 1, texel_coords.y)];
+      float height_nw = GetHeight(I(texel_coords.x, texel_coords.y));
+      float height_sw = GetHeight(I(texel_coords.x, texel_coords.y + 1));
+      float height_ne = GetHeight(I(texel_coords.x + 1, texel_coords.y));
       float height_w = yfactor*height_sw + (1-yfactor)*height_nw;
       float height_e = yfactor*height_sw + (1-yfactor)*height_ne;
       return (xfactor*height_e + (1-yfactor-xfactor)*height_w)/(1-yfactor);
     } else {
       // SW-SE-NE-Dreieck
-      float height_sw = heights_[I(texel_coords.x, texel_coords.y + 1)];
-      float height_ne = heights_[I(texel_coords.x + 1, texel_coords.y)];
-      float height_se = heights_[I(texel_coords.x + 1, texel_coords.y + 1)];
+      float height_sw = GetHeight(I(texel_coords.x, texel_coords.y + 1));
+      float height_ne = GetHeight(I(texel_coords.x + 1, texel_coords.y));
+      float height_se = GetHeight(I(texel_coords.x + 1, texel_coords.y + 1));
       float height_w = yfactor*height_sw + (1-yfactor)*height_ne;
       float height_e = yfactor*height_se + (1-yfactor)*height_ne;
       return ((1-xfactor)*height_w + (yfactor-(1-xfactor))*height_e)/yfactor;
@@ -365,10 +604,10 @@ float Tile::GetHeightAt(const D3DXVECTOR3 &pos) const {
     //
     // Bilineare Interpolation im Quadrat
     //
-    //float height_nw = heights_[I(texel_coords.x, texel_coords.y)];
-    //float height_sw = heights_[I(texel_coords.x, texel_coords.y + 1)];
-    //float height_ne = heights_[I(texel_coords.x + 1, texel_coords.y)];
-    //float height_se = heights_[I(texel_coords.x + 1, texel_coords.y + 1)];
+    //float height_nw = GetHeight(I(texel_coords.x, texel_coords.y));
+    //float height_sw = GetHeight(I(texel_coords.x, texel_coords.y + 1));
+    //float height_ne = GetHeight(I(texel_coords.x + 1, texel_coords.y));
+    //float height_se = GetHeight(I(texel_coords.x + 1, texel_coords.y + 1));
     //float height_w = yfactor*height_sw + (1-yfactor)*height_nw;
     //float height_e = yfactor*height_se + (1-yfactor)*height_ne;
     //return xfactor*height_e + (1-xfactor)*height_w;
@@ -378,7 +617,7 @@ float Tile::GetHeightAt(const D3DXVECTOR3 &pos) const {
 // TODO: Duplizierten Code in GetNormalAt und GetHeightAt reduzieren
 D3DXVECTOR3 Tile::GetNormalAt(const D3DXVECTOR3 &pos) const {
   D3DXVECTOR2 pos2d = D3DXVECTOR2(pos.x, pos.z);
-  if (num_lod_ > 0) {
+  if (lod_ < terrain_->resident_lod_) {
     D3DXVECTOR2 mid = D3DXVECTOR2(0.5f*scale_, 0.5f*scale_) + translation_;
     if (pos2d.x < mid.x) {
       if (pos2d.y < mid.y) return children_[NW]->GetNormalAt(pos);
@@ -415,16 +654,29 @@ D3DXVECTOR3 Tile::GetNormalAt(const D3DXVECTOR3 &pos) const {
     float xfactor = std::modf(texel_coords.x, &texel_coords.x);
     float yfactor = std::modf(texel_coords.y, &texel_coords.y);
 
+    // Die vier umliegenden Normalen auf einmal dekodieren (Reihenfolge wie
+    // Tile::Direction)
+    const int x0 = static_cast<int>(texel_coords.x);
+    const int y0 = static_cast<int>(texel_coords.y);
+    const int x1 = x0 + 1 < size_ ? x0 + 1 : x0;
+    const int y1 = y0 + 1 < size_ ? y0 + 1 : y0;
+    const unsigned int packed[4] = {
+      vertex_normals_[I(x0, y0)], vertex_normals_[I(x1, y0)],
+      vertex_normals_[I(x0, y1)], vertex_normals_[I(x1, y1)]
+    };
+    D3DXVECTOR3 normals[4];
+    PackedNormal::Decode4(packed, normals);
+    const D3DXVECTOR3 &normal_nw = normals[NW];
+    const D3DXVECTOR3 &normal_ne = normals[NE];
+    const D3DXVECTOR3 &normal_sw = normals[SW];
+    const D3DXVECTOR3 &normal_se = normals[SE];
+
     if (xfactor == 0.0f) {
       // NW-SW-Linie
-      D3DXVECTOR3 normal_nw = vertex_normals_[I(texel_coords.x, texel_coords.y)];
       if (yfactor == 0.0f) return normal_nw;
-      D3DXVECTOR3 normal_sw = vertex_normals_[I(texel_coords.x, texel_coords.y + 1)];
       return yfactor*normal_sw + (1-yfactor)*normal_nw;
     } else if (yfactor == 0.0f) {
       // NW-NE-Linie
-      D3DXVECTOR3 normal_nw = vertex_normals_[I(texel_coords.x, texel_coords.y)];
-      D3DXVECTOR3 normal_ne = vertex_normals_[I(texel_coords.x + 1, texel_coords.y)];
       return xfactor*normal_ne + (1-xfactor)*normal_nw;
     }
 
@@ -433,17 +685,11 @@ D3DXVECTOR3 Tile::GetNormalAt(const D3DXVECTOR3 &pos) const {
     //
     if (xfactor + yfactor <= 1.0f) {
       // SW-NE-NW-Dreieck
-      D3DXVECTOR3 normal_nw = vertex_normals_[I(texel_coords.x, texel_coords.y)];
-      D3DXVECTOR3 normal_sw = vertex_normals_[I(texel_coords.x, texel_coords.y + 1)];
-      D3DXVECTOR3 normal_ne = vertex_normals_[I(texel_coords.x + 1, texel_coords.y)];
       D3DXVECTOR3 normal_w = yfactor*normal_sw + (1-yfactor)*normal_nw;
       D3DXVECTOR3 normal_e = yfactor*normal_sw + (1-yfactor)*normal_ne;
       return (xfactor*normal_e + (1-yfactor-xfactor)*normal_w)/(1-yfactor);
     } else {
       // SW-SE-NE-Dreieck
-      D3DXVECTOR3 normal_sw = vertex_normals_[I(texel_coords.x, texel_coords.y + 1)];
-      D3DXVECTOR3 normal_ne = vertex_normals_[I(texel_coords.x + 1, texel_coords.y)];
-      D3DXVECTOR3 normal_se = vertex_normals_[I(texel_coords.x + 1, texel_coords.y + 1)];
       D3DXVECTOR3 normal_w = yfactor*normal_sw + (1-yfactor)*normal_ne;
       D3DXVECTOR3 normal_e = yfactor*normal_se + (1-yfactor)*normal_ne;
       return ((1-xfactor)*normal_w + (yfactor-(1-xfactor))*normal_e)/yfactor;
@@ -452,18 +698,144 @@ D3DXVECTOR3 Tile::GetNormalAt(const D3DXVECTOR3 &pos) const {
     //
     // Bilineare Interpolation im Quadrat
     //
-    //D3DXVECTOR3 normal_nw = vertex_normals_[I(texel_coords.x, texel_coords.y)];
-    //D3DXVECTOR3 normal_sw = vertex_normals_[I(texel_coords.x, texel_coords.y + 1)];
-    //D3DXVECTOR3 normal_ne = vertex_normals_[I(texel_coords.x + 1, texel_coords.y)];
-    //D3DXVECTOR3 normal_se = vertex_normals_[I(texel_coords.x + 1, texel_coords.y + 1)];
     //D3DXVECTOR3 normal_w = yfactor*normal_sw + (1-yfactor)*normal_nw;
     //D3DXVECTOR3 normal_e = yfactor*normal_se + (1-yfactor)*normal_ne;
     //return xfactor*normal_e + (1-xfactor)*normal_w;
   }
 }
 
+void Tile::QueryAt(const Query *queries, size_t n, float *heights,
+                   D3DXVECTOR3 *normals) const {
+  if (n == 0) return;
+  // Terrain::QueryAt verteilt die Abfragen schon auf die residenten Tiles
+  assert(lod_ == terrain_->resident_lod_);
+
+  // Wie in GetHeightAt im jeweiligen Dreieck interpolieren, hier als
+  // Gewichte der vier umliegenden Vertices:
+  //   NW-SW-NE: nw = 1 - xfactor - yfactor, ne = xfactor, sw = yfactor
+  //   NE-SW-SE: ne = 1 - yfactor, sw = 1 - xfactor,
+  //             se = xfactor + yfactor - 1
+  const __m128 max_coord = _mm_set1_ps(static_cast<float>(size_ - 1));
+  const __m128 translation_x = _mm_set1_ps(translation_.x);
+  const __m128 translation_y = _mm_set1_ps(translation_.y);
+  const __m128 factor = _mm_set1_ps((size_ - 1) / scale_);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128i max_index = _mm_set1_epi32(size_ - 1);
+  // Hhen direkt aus heights_ lesen, wenn vollstndig als float gespeichert
+  const bool plain_heights = !residual_ && !IsQuantized();
+  for (size_t i = 0; i < n; i += 4) {
+    const int count = n - i < 4 ? static_cast<int>(n - i) : 4;
+    float px[4], pz[4];
+    for (int k = 0; k < 4; ++k) {
+      const Query &query = queries[i + (k < count ? k : count - 1)];
+      px[k] = query.x;
+      pz[k] = query.z;
+    }
+    // Texel-Koordinaten, auf das Tile begrenzt
+    __m128 tx = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(px), translation_x),
+                           factor);
+    __m128 ty = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pz), translation_y),
+                           factor);
+    tx = _mm_min_ps(_mm_max_ps(tx, zero), max_coord);
+    ty = _mm_min_ps(_mm_max_ps(ty, zero), max_coord);
+    const __m128i x0 = _mm_cvttps_epi32(tx);
+    const __m128i y0 = _mm_cvttps_epi32(ty);
+    const __m128 xfactor = _mm_sub_ps(tx, _mm_cvtepi32_ps(x0));
+    const __m128 yfactor = _mm_sub_ps(ty, _mm_cvtepi32_ps(y0));
+    // Benachbarte Vertices, am Rand auf das Tile begrenzt (Gewicht dann 0)
+    const __m128i one_i = _mm_set1_epi32(1);
+    const __m128i x1 = _mm_add_epi32(x0, _mm_andnot_si128(
+        _mm_cmpeq_epi32(x0, max_index), one_i));
+    const __m128i y1 = _mm_add_epi32(y0, _mm_andnot_si128(
+        _mm_cmpeq_epi32(y0, max_index), one_i));
+    const __m128 sum = _mm_add_ps(xfactor, yfactor);
+    const __m128 upper = _mm_cmple_ps(sum, one);
+    const __m128 w_nw = _mm_and_ps(upper, _mm_sub_ps(one, sum));
+    const __m128 w_ne = _mm_or_ps(_mm_and_ps(upper, xfactor),
+                                  _mm_andnot_ps(upper,
+                                                _mm_sub_ps(one, yfactor)));
+    const __m128 w_sw = _mm_or_ps(_mm_and_ps(upper, yfactor),
+                                  _mm_andnot_ps(upper,
+                                                _mm_sub_ps(one, xfactor)));
+    const __m128 w_se = _mm_andnot_ps(upper, _mm_sub_ps(sum, one));
+
+    // Indizes der Vertices (Reihenfolge wie Tile::Direction)
+    int corners[4][4];
+    int x0s[4], y0s[4], x1s[4], y1s[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(x0s), x0);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(y0s), y0);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(x1s), x1);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(y1s), y1);
+    for (int k = 0; k < 4; ++k) {
+      corners[k][NW] = I(x0s[k], y0s[k]);
+      corners[k][NE] = I(x1s[k], y0s[k]);
+      corners[k][SW] = I(x0s[k], y1s[k]);
+      corners[k][SE] = I(x1s[k], y1s[k]);
+    }
+
+    if (heights) {
+      // Unbegrenzte Werte holen, Wasser (wie GetHeight) dann mit SSE
+      float values[4][4];
+      if (plain_heights) {
+        for (int k = 0; k < 4; ++k) {
+          for (int dir = 0; dir < 4; ++dir) {
+            values[dir][k] = heights_[corners[k][dir]];
+          }
+        }
+      } else {
+        for (int k = 0; k < 4; ++k) {
+          for (int dir = 0; dir < 4; ++dir) {
+            values[dir][k] = GetRawHeight(corners[k][dir]);
+          }
+        }
+      }
+      __m128 nw = _mm_loadu_ps(values[NW]), ne = _mm_loadu_ps(values[NE]);
+      __m128 sw = _mm_loadu_ps(values[SW]), se = _mm_loadu_ps(values[SE]);
+      if (water_) {
+        nw = _mm_max_ps(nw, zero);
+        ne = _mm_max_ps(ne, zero);
+        sw = _mm_max_ps(sw, zero);
+        se = _mm_max_ps(se, zero);
+      }
+      float result[4];
+      _mm_storeu_ps(result, _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(w_nw, nw), _mm_mul_ps(w_ne, ne)),
+          _mm_add_ps(_mm_mul_ps(w_sw, sw), _mm_mul_ps(w_se, se))));
+      for (int k = 0; k < count; ++k) heights[queries[i + k].index] = result[k];
+    }
+    if (normals) {
+      float weights[4][4];
+      _mm_storeu_ps(weights[NW], w_nw);
+      _mm_storeu_ps(weights[NE], w_ne);
+      _mm_storeu_ps(weights[SW], w_sw);
+      _mm_storeu_ps(weights[SE], w_se);
+      for (int k = 0; k < count; ++k) {
+        const unsigned int packed[4] = {
+          vertex_normals_[corners[k][NW]], vertex_normals_[corners[k][NE]],
+          vertex_normals_[corners[k][SW]], vertex_normals_[corners[k][SE]]
+        };
+        D3DXVECTOR3 corner_normals[4];
+        PackedNormal::Decode4(packed, corner_normals);
+        normals[queries[i + k].index] =
+            weights[NW][k] * corner_normals[NW] +
+            weights[NE][k] * corner_normals[NE] +
+            weights[SW][k] * corner_normals[SW] +
+            weights[SE][k] * corner_normals[SE];
+      }
+    }
+  }
+}
+
+void Tile::GetTexels(Texel *out) const {
+  for (int i = 0; i < GetResolution(); ++i) {
+    out[i].height = GetHeight(i);
+    out[i].normal = vertex_normals_[i];
+  }
+}
+
 HRESULT Tile::CreateBuffers(ID3D10Device *device) {
-  assert(heights_ != NULL);
+  assert(heights_ != NULL || quantized_heights_ != NULL);
   assert(vertex_normals_ != NULL);
   HRESULT hr;
   device_ = device;
@@ -471,11 +843,8 @@ HRESULT Tile::CreateBuffers(ID3D10Device *device) {
   // Evtl. bereits vorhandene Buffer freigeben
   ReleaseBuffers();
 
-  const int resolution = GetResolution();
-  D3DXVECTOR4 *normals_heights = new D3DXVECTOR4[resolution];
-  for (int i = 0; i < resolution; ++i) {
-    normals_heights[i] = D3DXVECTOR4(vertex_normals_[i], heights_[i]);
-  }
+  std::vector<Texel> texels(GetResolution());
+  GetTexels(&texels[0]);
 
   // Textur anlegen
   D3D10_TEXTURE2D_DESC tex2d_desc;
@@ -483,7 +852,7 @@ HRESULT Tile::CreateBuffers(ID3D10Device *device) {
   tex2d_desc.Height = size_;
   tex2d_desc.MipLevels = 1;
   tex2d_desc.ArraySize = 1;
-  tex2d_desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+  tex2d_desc.Format = DXGI_FORMAT_R32G32_UINT;
   tex2d_desc.SampleDesc.Count = 1;
   tex2d_desc.SampleDesc.Quality = 0;
   tex2d_desc.Usage = D3D10_USAGE_IMMUTABLE;
@@ -491,16 +860,14 @@ HRESULT Tile::CreateBuffers(ID3D10Device *device) {
   tex2d_desc.CPUAccessFlags = 0;
   tex2d_desc.MiscFlags = 0;
   D3D10_SUBRESOURCE_DATA init_data;
-  init_data.pSysMem = normals_heights;
-  init_data.SysMemPitch = sizeof(normals_heights[0]) * size_;
+  init_data.pSysMem = &texels[0];
+  init_data.SysMemPitch = sizeof(texels[0]) * size_;
   init_data.SysMemSlicePitch = 0;
   V_RETURN(device->CreateTexture2D(&tex2d_desc, &init_data, &height_map_));
 
-  delete[] normals_heights;
-
   // Shader Resource View anlegen
   D3D10_SHADER_RESOURCE_VIEW_DESC srv_desc;
-  srv_desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+  srv_desc.Format = DXGI_FORMAT_R32G32_UINT;
   srv_desc.ViewDimension = D3D10_SRV_DIMENSION_TEXTURE2D;
   srv_desc.Texture2D.MipLevels = 1;
   srv_desc.Texture2D.MostDetailedMip = 0;
@@ -508,7 +875,7 @@ HRESULT Tile::CreateBuffers(ID3D10Device *device) {
                                             &shader_resource_view_));
 
   // Rekursiver Aufruf ber alle Kinder
-  if (num_lod_ > 0) {
+  if (HasChildren()) {
     for (int dir = 0; dir < 4; ++dir) {
       V_RETURN(children_[dir]->CreateBuffers(device));
     }
@@ -520,157 +887,328 @@ HRESULT Tile::CreateBuffers(ID3D10Device *device) {
 void Tile::ReleaseBuffers(void) {
   SAFE_RELEASE(height_map_);
   SAFE_RELEASE(shader_resource_view_);
+  ReleaseSimplifiedMeshes();
 }
 
-void Tile::FreeMemory(void) {
-  SAFE_DELETE_ARRAY(heights_);
-  SAFE_DELETE_ARRAY(vertex_normals_);
-  if (num_lod_ > 0) {
-    for (int dir = 0; dir < 4; ++dir) {
-      children_[dir]->FreeMemory();
-    }
+void Tile::ReleaseSimplifiedMeshes(void) {
+  for (size_t i = 0; i < simplified_meshes_.size(); ++i) {
+    SAFE_RELEASE(simplified_meshes_[i].index_buffer);
   }
+  simplified_meshes_.clear();
+  simplified_triangles_ = -1;
 }
 
-void Tile::Draw(LODSelector *lod_selector, const CBaseCamera *camera, bool culling) {
-  assert(terrain_ != NULL);
-  assert(shader_resource_view_ != NULL);
+void Tile::SetSimplifiedError(float max_error) {
+  if (simplified_error_ != max_error) {
+    ReleaseSimplifiedMeshes();
+    simplified_error_ = max_error;
+  }
+}
 
-  if (culling) {
-    D3DXVECTOR3 bbox[8];
-    GetBoundingBox(bbox, NULL);
-    D3DXVec3TransformCoordArray(bbox, sizeof(D3DXVECTOR3),
-                                bbox, sizeof(D3DXVECTOR3),
-                                camera->GetViewMatrix(), 8);
-    should_cull_ = true;
-    for (UINT i = 0; i < 8; ++i) {
-      if (bbox[i].z >= 0) {
-        should_cull_ = false;
-        break;
+void Tile::Simplify(float max_error,
+                    std::vector<unsigned int> *indices) const {
+  const int res = GetResolution();
+  std::vector<float> heights(res);
+  for (int i = 0; i < res; ++i) heights[i] = GetHeight(i);
+
+  // Fehler der Vertices von den kleinsten Dreiecken zu den grten: je
+  // Schrittweite s erst die Kantenmitten des Rasters (Dreiecke mit
+  // waagrechter bzw. senkrechter Hypotenuse), dann die Mittelpunkte seiner
+  // Quadrate (Hypotenuse diagonal). Die Kinder eines Dreiecks liegen so
+  // immer auf der Stufe davor.
+  const int cells = size_ - 1;
+  std::vector<float> errors(res, 0.0f);
+  std::vector<float> bounds(2 * res, 0.0f);
+  for (int s = 2; s <= cells; s *= 2) {
+    const int h = s / 2;
+    const bool leaf_children = h == 1;
+    for (int y = 0; y <= cells; y += h) {
+      const bool row = y % s == 0;
+      for (int x = row ? h : 0; x <= cells; x += s) {
+        if (row) {
+          if (y > 0) {
+            UpdateSimplificationError(heights, x - h, y, x + h, y, x, y - h,
+                                      leaf_children, &errors, &bounds);
+          }
+          if (y < cells) {
+            UpdateSimplificationError(heights, x + h, y, x - h, y, x, y + h,
+                                      leaf_children, &errors, &bounds);
+          }
+        } else {
+          if (x > 0) {
+            UpdateSimplificationError(heights, x, y + h, x, y - h, x - h, y,
+                                      leaf_children, &errors, &bounds);
+          }
+          if (x < cells) {
+            UpdateSimplificationError(heights, x, y - h, x, y + h, x + h, y,
+                                      leaf_children, &errors, &bounds);
+          }
+        }
       }
     }
-    if (should_cull_) return;
-  }
-
-  if (num_lod_ == 0 || lod_selector->IsLODSufficient(this, camera)) {
-    terrain_->DrawTile(scale_, translation_, lod_, shader_resource_view_);
-  } else {
-    for (int dir = 0; dir < 4; ++dir) {
-      children_[dir]->Draw(lod_selector, camera);
+    for (int y = h; y < cells; y += s) {
+      for (int x = h; x < cells; x += s) {
+        // Die Diagonale geht durch die Ecke, die Mittelpunkt des
+        // bergeordneten Quadrats ist, bei der Wurzel SW-NE
+        if (s < cells && (x / s + y / s) % 2 == 0) {
+          UpdateSimplificationError(heights, x - h, y - h, x + h, y + h,
+                                    x + h, y - h, false, &errors, &bounds);
+          UpdateSimplificationError(heights, x + h, y + h, x - h, y - h,
+                                    x - h, y + h, false, &errors, &bounds);
+        } else {
+          UpdateSimplificationError(heights, x - h, y + h, x + h, y - h,
+                                    x - h, y - h, false, &errors, &bounds);
+          UpdateSimplificationError(heights, x + h, y - h, x - h, y + h,
+                                    x + h, y + h, false, &errors, &bounds);
+        }
+      }
     }
   }
+
+  indices->clear();
+  SimplifyTriangle(errors, max_error, 0, cells, cells, 0, 0, 0, indices);
+  SimplifyTriangle(errors, max_error, cells, 0, 0, cells, cells, cells,
+                   indices);
 }
 
-void Tile::DrawVegetation(void){
-  if (should_cull_) return;
-  if (num_lod_ > 0) {
-    for (int dir = 0; dir < 4; ++dir) {
-      children_[dir]->DrawVegetation();
-    }
+void Tile::UpdateSimplificationError(const std::vector<float> &heights,
+                                     int ax, int ay, int bx, int by, int cx,
+                                     int cy, bool leaf_children,
+                                     std::vector<float> *errors,
+                                     std::vector<float> *bounds) const {
+  // In jeder Hlfte weicht die Ebene des Dreiecks von der der Hlfte
+  // hchstens um den Abstand des neuen Vertex m von der Hypotenuse ab, die
+  // Schranke ist also die grere der Hlften plus dieser Abstand
+  const int mx = (ax + bx) / 2;
+  const int my = (ay + by) / 2;
+  const unsigned int m = I(mx, my);
+  float bound = std::abs(heights[m] - 0.5f * (heights[I(ax, ay)] +
+                                              heights[I(bx, by)]));
+  float error;
+  if (leaf_children) {
+    // Die Ebenen der Zellhlften weichen nur an der Mitte ihrer Hypotenuse
+    // vom Gitter ab, wenn diese NW-SE verluft (siehe GetDiagonalError)
+    bound += std::max(GetDiagonalError(heights, cx, cy, ax, ay, mx, my),
+                      GetDiagonalError(heights, bx, by, cx, cy, mx, my));
+    error = bound;
+  } else {
+    const int lx = (cx + ax) / 2, ly = (cy + ay) / 2;
+    const int rx = (bx + cx) / 2, ry = (by + cy) / 2;
+    bound += std::max(
+        (*bounds)[2 * I(lx, ly) + GetTriangleSide(mx, my, lx, ly)],
+        (*bounds)[2 * I(rx, ry) + GetTriangleSide(mx, my, rx, ry)]);
+    error = std::max(bound, std::max((*errors)[I(lx, ly)],
+                                     (*errors)[I(rx, ry)]));
   }
-  else if (vegetation_ != NULL) vegetation_->Draw();
+  (*bounds)[2 * m + GetTriangleSide(cx, cy, mx, my)] = bound;
+  // Die Vertices auf dem Rand bleiben immer erhalten
+  if (mx == 0 || my == 0 || mx == size_ - 1 || my == size_ - 1) {
+    error = std::numeric_limits<float>::max();
+  }
+  (*errors)[m] = std::max((*errors)[m], error);
 }
 
-void Tile::CalculateNormals(unsigned int *indices) {
-  CalculateNormals0(NULL, NULL, indices);
-  NormalizeNormals();
+float Tile::GetDiagonalError(const std::vector<float> &heights, int ax,
+                             int ay, int bx, int by, int cx,
+                             int cy) const {
+  if ((ax - bx) * (ay - by) <= 0) return 0.0f;
+  const int dx = ax + bx - cx, dy = ay + by - cy;
+  return 0.5f * std::abs(heights[I(ax, ay)] + heights[I(bx, by)] -
+                         heights[I(cx, cy)] - heights[I(dx, dy)]);
 }
 
-D3DXVECTOR3 Tile::GetVectorFromIndex(int index) const {
-  assert(heights_ != NULL);
-  float x = (float)(index % size_) / (size_ - 1) * scale_ + translation_.x;
-  float z = (float)(index / size_) / (size_ - 1) * scale_ + translation_.y;
-  return D3DXVECTOR3(x, heights_[index], z);
+void Tile::SimplifyTriangle(const std::vector<float> &errors,
+                            float max_error, int ax, int ay, int bx, int by,
+                            int cx, int cy,
+                            std::vector<unsigned int> *indices) const {
+  const int mx = (ax + bx) / 2;
+  const int my = (ay + by) / 2;
+  // Die Zellhlften (Katheten der Lnge 1) haben keinen Vertex auf der
+  // Hypotenuse
+  const bool cell_half = std::abs(ax - cx) + std::abs(ay - cy) == 1;
+  const int dx = ax + bx - cx, dy = ay + by - cy;
+  if (!cell_half && errors[I(mx, my)] > max_error) {
+    SimplifyTriangle(errors, max_error, cx, cy, ax, ay, mx, my, indices);
+    SimplifyTriangle(errors, max_error, bx, by, cx, cy, mx, my, indices);
+  } else if (cell_half && (ax - bx) * (ay - by) > 0 &&
+             errors[I(dx, dy)] > max_error) {
+    // Die andere Hlfte der Zelle (rechter Winkel in d) wird ebenfalls
+    // ausgegeben, beide werden wie im Gitter an der Diagonale SW-NE
+    // geteilt; diese Hlfte erhlt die Ecken a, d und c
+    indices->push_back(I(ax, ay));
+    indices->push_back(I(dx, dy));
+    indices->push_back(I(cx, cy));
+  } else {
+    indices->push_back(I(ax, ay));
+    indices->push_back(I(bx, by));
+    indices->push_back(I(cx, cy));
+  }
 }
 
-void Tile::CalculateNormals0(Tile *north, Tile *west, unsigned int *indices) {
-  assert(heights_ != NULL);
-  SAFE_DELETE_ARRAY(vertex_normals_);
-  const int num_vertices = GetResolution();
-  vertex_normals_ = new D3DXVECTOR3[num_vertices];
-  // Normalen auf 0 initialisieren
-  for (int i = 0; i < num_vertices; ++i) {
-    vertex_normals_[i] = D3DXVECTOR3(0.f, 0.f, 0.f);
-  }
-  // Normalen-Zwischenwerte ggf. von Nachbarn holen
-  if (north) {
-    for (int x = 0; x < size_; ++x) {
-      vertex_normals_[I(x, 0)] = north->vertex_normals_[I(x, size_ - 1)];
+void Tile::DrawVegetation(const Frustum *frustum, unsigned int plane_mask) {
+  if (frustum != NULL) {
+    Terrain::CullingStats &stats = terrain_->culling_stats_;
+    ++stats.vegetation_visited;
+    if (plane_mask != 0) {
+      // Die Pflanzen ragen ber die Hhenwerte hinaus
+      D3DXVECTOR3 box_min, box_max;
+      GetBounds(&box_min, &box_max);
+      const D3DXVECTOR3 margin(VEGETATION_MARGIN, VEGETATION_MARGIN,
+                               VEGETATION_MARGIN);
+      if (frustum->Test(box_min - margin, box_max + margin, &plane_mask) ==
+          Frustum::OUTSIDE) {
+        ++stats.vegetation_culled;
+        return;
+      }
     }
   }
-  if (west) {
-    for (int y = 0; y < size_; ++y) {
-      vertex_normals_[I(0, y)] = west->vertex_normals_[I(size_ - 1, y)];
-    }
-  }
-  // Face-Normalen berechnen und auf die Normalen der beteiligten Vertices
-  // aufaddieren
-  int num_triangles = (size_-1)*(size_-1) * 2;
-  for (int i = 0; i < num_triangles; ++i) {
-    D3DXVECTOR3 v1 = GetVectorFromIndex(indices[3*i]);
-    D3DXVECTOR3 v2 = GetVectorFromIndex(indices[3*i+1]);
-    D3DXVECTOR3 v3 = GetVectorFromIndex(indices[3*i+2]);
-    D3DXVECTOR3 e1 = v2 - v1;
-    D3DXVECTOR3 e2 = v3 - v1;
-    D3DXVECTOR3 face_normal;
-    D3DXVec3Cross(&face_normal, &e1, &e2);
-    D3DXVec3Normalize(&face_normal, &face_normal);
-    vertex_normals_[indices[3*i]] += face_normal;
-    vertex_normals_[indices[3*i+1]] += face_normal;
-    vertex_normals_[indices[3*i+2]] += face_normal;
-  }
-  // Normalen ggf. an Nachbarn zurckgeben
-  if (north) {
-    for (int x = 0; x < size_; ++x) {
-      north->vertex_normals_[I(x, size_ - 1)] = vertex_normals_[I(x, 0)];
+  if (lod_ < terrain_->resident_lod_) {
+    for (int dir = 0; dir < 4; ++dir) {
+      children_[dir]->DrawVegetation(frustum, plane_mask);
     }
+  } else if (vegetation_ != NULL) {
+    vegetation_->Draw();
+    if (frustum != NULL) ++terrain_->culling_stats_.vegetation_drawn;
   }
-  if (west) {
-    for (int y = 0; y < size_; ++y) {
-      west->vertex_normals_[I(size_ - 1, y)] = vertex_normals_[I(0, y)];
+}
+
+void Tile::CalculateNormals(void) {
+  assert(heights_ != NULL || quantized_heights_ != NULL);
+  Halo halo;
+  GetHalo(&halo);
+  const bool has_north = !halo.north.empty(), has_south = !halo.south.empty();
+  const bool has_west = !halo.west.empty(), has_east = !halo.east.empty();
+  // Abstand benachbarter Vertices
+  const float d = scale_ / (size_ - 1);
+  // Zellen einer Zeile einschlielich des Rands (size_ + 1), auf ein
+  // Vielfaches von 4 aufgerundet
+  const int num_cells = (size_ + 4) & ~3;
+  const int num_vertices = (size_ + 3) & ~3;
+  const int num_blocks = (size_ + NORMAL_BLOCK_ROWS - 1) / NORMAL_BLOCK_ROWS;
+
+  // Blcke von Vertex-Zeilen unabhngig voneinander; jeder Block berechnet
+  // die Zellzeile ber sich selbst noch einmal
+#pragma omp parallel for
+  for (int block = 0; block < num_blocks; ++block) {
+    const int y0 = block * NORMAL_BLOCK_ROWS;
+    const int y1 = y0 + NORMAL_BLOCK_ROWS < size_ ?
+                   y0 + NORMAL_BLOCK_ROWS : size_;
+    std::vector<float> rows(2 * (num_cells + 1));
+    std::vector<float> faces(2 * FACE_ROW_FLOATS * num_cells);
+    std::vector<D3DXVECTOR3> sums(num_vertices, D3DXVECTOR3(0, 1, 0));
+    std::vector<unsigned int> packed(num_vertices);
+    float *north = &rows[0], *south = north + num_cells + 1;
+    // Face-Normalen der Zellzeile ber bzw. unter der aktuellen Vertex-Zeile
+    float *above = &faces[0], *below = above + FACE_ROW_FLOATS * num_cells;
+
+    bool has_above = y0 > 0 || has_north;
+    if (has_above) {
+      GetHeightRow(halo, y0 - 1, num_cells + 1, north);
+      GetHeightRow(halo, y0, num_cells + 1, south);
+      ComputeFaceRow(north, south, num_cells, d, above);
+    } else {
+      GetHeightRow(halo, y0, num_cells + 1, south);
+    }
+    for (int y = y0; y < y1; ++y) {
+      const bool has_below = y < size_ - 1 || has_south;
+      if (has_below) {
+        std::swap(north, south);
+        GetHeightRow(halo, y + 1, num_cells + 1, south);
+        ComputeFaceRow(north, south, num_cells, d, below);
+      }
+      SumFaceRow(has_above ? above : NULL, has_below ? below : NULL,
+                 num_cells, size_, has_west, has_east, &sums[0]);
+      // Die Kodierung normiert selbst, die Summen werden direkt kodiert
+      for (int x = 0; x < num_vertices; x += 4) {
+        PackedNormal::Encode4(&sums[x], &packed[x]);
+      }
+      std::copy(packed.begin(), packed.begin() + size_,
+                vertex_normals_ + I(0, y));
+      std::swap(above, below);
+      has_above = has_below;
     }
   }
+}
 
-  if (num_lod_ <= 0) return;
-
-  // Holen benachbarter Kind-Tiles:
-  //     +---+---+
-  //     |NNW|NNE|
-  // +---+---+---+
-  // |NWW|       |
-  // +---+ this  +
-  // |SWW|       |
-  // +---+---+---+
-  Tile *child_NNW, *child_NNE, *child_NWW, *child_SWW;
-  if (north) {
-    child_NNW = north->children_[SW];
-    child_NNE = north->children_[SE];
-  } else {
-    child_NNW = child_NNE = NULL;
+void Tile::GetHalo(Halo *halo) const {
+  const int n = size_ - 1;
+  const int last = n << lod_;
+  const int x0 = tile_x_ * n, y0 = tile_y_ * n;
+  const int x1 = x0 + n, y1 = y0 + n;
+  const TileGenerator *generator = terrain_->generator_;
+  // Die Nachbarn werden nicht gelesen, sondern ihr Rand aus dem Startwert
+  // berechnet. Das ergibt bitgenau deren Werte, auch wenn sie (im
+  // Lazy-Modus) gerade nicht existieren.
+  const int hx0 = x0 > 0 ? x0 - 1 : x0;
+  const int hx1 = x1 < last ? x1 + 1 : x1;
+  if (y0 > 0) {
+    halo->north.assign(size_ + 2, 0.0f);
+    generator->GenerateRegion(lod_, hx0, y0 - 1, hx1, y0 - 1,
+                              &halo->north[x0 > 0 ? 0 : 1]);
   }
-  if (west) {
-    child_NWW = west->children_[NE];
-    child_SWW = west->children_[SE];
-  } else {
-    child_NWW = child_SWW = NULL;
+  if (y1 < last) {
+    halo->south.assign(size_ + 2, 0.0f);
+    generator->GenerateRegion(lod_, hx0, y1 + 1, hx1, y1 + 1,
+                              &halo->south[x0 > 0 ? 0 : 1]);
+  }
+  if (x0 > 0) {
+    halo->west.resize(size_);
+    generator->GenerateRegion(lod_, x0 - 1, y0, x0 - 1, y1, &halo->west[0]);
+  }
+  if (x1 < last) {
+    halo->east.resize(size_);
+    generator->GenerateRegion(lod_, x1 + 1, y0, x1 + 1, y1, &halo->east[0]);
+  }
+  if (IsQuantized()) {
+    // Die dekodierten Werte sind an den Rndern benachbarter Tiles nicht
+    // gleich, daher die Normalen aus den exakten Hhen berechnen
+    halo->heights.resize(GetResolution());
+    generator->Generate(lod_, tile_x_, tile_y_, &halo->heights[0]);
+  }
+  if (water_) {
+    std::vector<float> *sides[] = {
+      &halo->north, &halo->south, &halo->west, &halo->east, &halo->heights
+    };
+    for (int i = 0; i < 5; ++i) {
+      for (size_t j = 0; j < sides[i]->size(); ++j) {
+        if ((*sides[i])[j] < 0.0f) (*sides[i])[j] = 0.0f;
+      }
+    }
   }
-  children_[NW]->CalculateNormals0(child_NNW, child_NWW, indices);
-  children_[NE]->CalculateNormals0(child_NNE, children_[NW], indices);
-  children_[SW]->CalculateNormals0(children_[NW], child_SWW, indices);
-  children_[SE]->CalculateNormals0(children_[NE], children_[SW], indices);
 }
 
-void Tile::NormalizeNormals(void) {
-  assert(vertex_normals_ != NULL);
-  const int num_vertices = GetResolution();
-  for (int i = 0; i < num_vertices; ++i) {
-    D3DXVec3Normalize(&vertex_normals_[i], &vertex_normals_[i]);
-  }
-  if (num_lod_ > 0) {
-    for (int dir = 0; dir < 4; ++dir) {
-      children_[dir]->NormalizeNormals();
+void Tile::GetHeightRow(const Halo &halo, int y, int width,
+                        float *out) const {
+  if (y < 0 || y >= size_) {
+    const std::vector<float> &row = y < 0 ? halo.north : halo.south;
+    std::copy(row.begin(), row.end(), out);
+  } else {
+    out[0] = halo.west.empty() ? 0.0f : halo.west[y];
+    if (!halo.heights.empty()) {
+      std::copy(&halo.heights[I(0, y)], &halo.heights[I(0, y)] + size_,
+                out + 1);
+    } else if (!residual_ && !water_) {
+      std::copy(heights_ + I(0, y), heights_ + I(0, y) + size_, out + 1);
+    } else {
+      for (int x = 0; x < size_; ++x) out[x + 1] = GetHeight(I(x, y));
     }
+    out[size_ + 1] = halo.east.empty() ? 0.0f : halo.east[y];
   }
+  // Auffllen auf die SSE-Breite, die Werte werden nicht verwendet
+  std::fill(out + size_ + 2, out + width, out[size_ + 1]);
+}
+
+D3DXVECTOR3 Tile::GetVectorFromIndex(int index) const {
+  assert(heights_ != NULL || quantized_heights_ != NULL);
+  float x = (float)(index % size_) / (size_ - 1) * scale_ + translation_.x;
+  float z = (float)(index / size_) / (size_ - 1) * scale_ + translation_.y;
+  return D3DXVECTOR3(x, GetHeight(index), z);
+}
+
+void Tile::GetBounds(D3DXVECTOR3 *box_min, D3DXVECTOR3 *box_max) const {
+  *box_min = D3DXVECTOR3(translation_.x, min_height_, translation_.y);
+  *box_max = D3DXVECTOR3(translation_.x + scale_, max_height_,
+                         translation_.y + scale_);
 }
 
 void Tile::GetBoundingBox(D3DXVECTOR3 *box, D3DXVECTOR3 *mid) const {
@@ -689,36 +1227,210 @@ void Tile::GetBoundingBox(D3DXVECTOR3 *box, D3DXVECTOR3 *mid) const {
   if (mid != NULL) *mid = 0.5f * (box[0] + box[7]);
 }
 
-float Tile::GetWorldError(void) const {
-  return scale_ / (size_ - 1);
+Tile::Ray::Ray(const D3DXVECTOR3 &origin, const D3DXVECTOR3 &dir,
+               float t_min, float t_max)
+    : origin(origin),
+      dir(dir),
+      inv_dir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z),
+      t_min(t_min),
+      t_max(t_max) {
 }
 
-void Tile::PlaceVegetation(const D3DXVECTOR3 &position) {
-  D3DXVECTOR2 pos2d = D3DXVECTOR2(position.x, position.z);
-  if (num_lod_ > 0) {
-    D3DXVECTOR2 mid = D3DXVECTOR2(0.5f*scale_, 0.5f*scale_) + translation_;
-    if (pos2d.x < mid.x) {
-      if (pos2d.y < mid.y) return children_[NW]->PlaceVegetation(position);
-      else return children_[SW]->PlaceVegetation(position);
+bool Tile::Raycast(const Ray &ray, float *t_hit) const {
+  return Raycast(ray, ray.t_min, ray.t_max, t_hit);
+}
+
+bool Tile::Raycast(const Ray &ray, float t_min, float t_max,
+                   float *t_hit) const {
+  const D3DXVECTOR3 lo(translation_.x, min_height_, translation_.y);
+  const D3DXVECTOR3 hi(translation_.x + scale_, max_height_,
+                       translation_.y + scale_);
+  if (!IntersectBox(ray, lo, hi, &t_min, &t_max)) return false;
+  if (lod_ < terrain_->resident_lod_) {
+    // Kinder von vorne nach hinten: zuerst das in Strahlrichtung erste,
+    // zuletzt das gegenberliegende. Die beiden anderen knnen nicht beide
+    // getroffen werden.
+    const int first = (ray.dir.x < 0.0f ? 1 : 0) | (ray.dir.z < 0.0f ? 2 : 0);
+    for (int i = 0; i < 4; ++i) {
+      if (children_[first ^ i]->Raycast(ray, t_min, t_max, t_hit)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  const int top = static_cast<int>(block_level_offsets_.size()) - 1;
+  return RaycastBlock(ray, top, 0, 0, t_min, t_max, t_hit);
+}
+
+bool Tile::RaycastBlock(const Ray &ray, int level, int block_x, int block_y,
+                        float t_min, float t_max, float *t_hit) const {
+  const int num_cells = block_cells_ << level;
+  const int num_blocks_1d = (size_ - 1) / num_cells;
+  const float *bounds = &block_bounds_[block_level_offsets_[level] +
+                                       2 * (block_y * num_blocks_1d + block_x)];
+  const float block_scale = scale_ / num_blocks_1d;
+  const D3DXVECTOR3 lo(translation_.x + block_x * block_scale, bounds[0],
+                       translation_.y + block_y * block_scale);
+  const D3DXVECTOR3 hi(lo.x + block_scale, bounds[1], lo.z + block_scale);
+  if (!IntersectBox(ray, lo, hi, &t_min, &t_max)) return false;
+  if (level == 0) {
+    return RaycastCells(ray, block_x * num_cells, block_y * num_cells,
+                        num_cells, t_min, t_max, t_hit);
+  }
+  // Reihenfolge wie in Raycast
+  const int first = (ray.dir.x < 0.0f ? 1 : 0) | (ray.dir.z < 0.0f ? 2 : 0);
+  for (int i = 0; i < 4; ++i) {
+    const int dir = first ^ i;
+    if (RaycastBlock(ray, level - 1, 2 * block_x + (dir & 1),
+                     2 * block_y + (dir >> 1), t_min, t_max, t_hit)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Tile::RaycastCells(const Ray &ray, int cell_x, int cell_y,
+                        int num_cells, float t_min, float t_max,
+                        float *t_hit) const {
+  const float cell_size = scale_ / (size_ - 1);
+  const float no_step = std::numeric_limits<float>::max();
+  // Startzelle am Eintrittspunkt, auf den Block begrenzt
+  const D3DXVECTOR3 entry = ray.origin + t_min * ray.dir;
+  int x = static_cast<int>(floorf((entry.x - translation_.x) / cell_size));
+  int y = static_cast<int>(floorf((entry.z - translation_.y) / cell_size));
+  x = std::max(cell_x, std::min(x, cell_x + num_cells - 1));
+  y = std::max(cell_y, std::min(y, cell_y + num_cells - 1));
+  // Schrittrichtung, Strahlparameter der nchsten Zellgrenze und Abstand
+  // der Zellgrenzen je Achse
+  const int step_x = ray.dir.x > 0.0f ? 1 : -1;
+  const int step_y = ray.dir.z > 0.0f ? 1 : -1;
+  float next_x = ray.dir.x == 0.0f ? no_step :
+      (translation_.x + (x + (step_x > 0)) * cell_size - ray.origin.x) *
+      ray.inv_dir.x;
+  float next_y = ray.dir.z == 0.0f ? no_step :
+      (translation_.y + (y + (step_y > 0)) * cell_size - ray.origin.z) *
+      ray.inv_dir.z;
+  const float delta_x = ray.dir.x == 0.0f ? 0.0f :
+                        cell_size * fabsf(ray.inv_dir.x);
+  const float delta_y = ray.dir.z == 0.0f ? 0.0f :
+                        cell_size * fabsf(ray.inv_dir.z);
+
+  float t_enter = t_min;
+  for (;;) {
+    const float t_exit = std::min(std::min(next_x, next_y), t_max);
+    if (IntersectCell(ray, x, y, t_enter, t_exit, t_hit)) return true;
+    if (t_exit >= t_max) return false;
+    if (next_x < next_y) {
+      x += step_x;
+      next_x += delta_x;
     } else {
-      if (pos2d.y < mid.y) return children_[NE]->PlaceVegetation(position);
-      else return children_[SE]->PlaceVegetation(position);
+      y += step_y;
+      next_y += delta_y;
     }
-  } else {
-    float height = GetHeightAt(position);
-    D3DXVECTOR3 pos = position;
-    pos.y = height;
-    D3DXVECTOR3 normal = GetNormalAt(position);
-    float normalized_height =
-        (height - terrain_->GetMinHeight()) /
-        (terrain_->GetMaxHeight() - terrain_->GetMinHeight());
-    if (vegetation_ == NULL) vegetation_ = new Gras();
-    vegetation_->PlaceSeed(pos, normalized_height, normal);
+    if (x < cell_x || x >= cell_x + num_cells ||
+        y < cell_y || y >= cell_y + num_cells) {
+      return false;
+    }
+    t_enter = t_exit;
+  }
+}
+
+bool Tile::IntersectCell(const Ray &ray, int cell_x, int cell_y,
+                         float t_enter, float t_exit, float *t_hit) const {
+  const float height_nw = GetHeight(I(cell_x, cell_y));
+  const float height_ne = GetHeight(I(cell_x + 1, cell_y));
+  const float height_sw = GetHeight(I(cell_x, cell_y + 1));
+  const float height_se = GetHeight(I(cell_x + 1, cell_y + 1));
+  // Hhenbereich des Strahls in der Zelle gegen den der Zelle
+  const float y_enter = ray.origin.y + t_enter * ray.dir.y;
+  const float y_exit = ray.origin.y + t_exit * ray.dir.y;
+  const float cell_min = std::min(std::min(height_nw, height_ne),
+                                  std::min(height_sw, height_se));
+  const float cell_max = std::max(std::max(height_nw, height_ne),
+                                  std::max(height_sw, height_se));
+  if (std::min(y_enter, y_exit) > cell_max ||
+      std::max(y_enter, y_exit) < cell_min) {
+    return false;
   }
+
+  const float cell_size = scale_ / (size_ - 1);
+  const float x0 = translation_.x + cell_x * cell_size;
+  const float z0 = translation_.y + cell_y * cell_size;
+  const D3DXVECTOR3 nw(x0, height_nw, z0);
+  const D3DXVECTOR3 ne(x0 + cell_size, height_ne, z0);
+  const D3DXVECTOR3 sw(x0, height_sw, z0 + cell_size);
+  const D3DXVECTOR3 se(x0 + cell_size, height_se, z0 + cell_size);
+  // Dreiecke NW-SW-NE und NE-SW-SE, den nheren Schnittpunkt nehmen
+  float t_upper, t_lower;
+  const bool upper = IntersectTriangle(ray, nw, sw, ne, &t_upper);
+  const bool lower = IntersectTriangle(ray, ne, sw, se, &t_lower);
+  if (!upper && !lower) return false;
+  // IntersectTriangle begrenzt t auf den Bereich des Strahls. Wegen der
+  // Toleranz an den Kanten kann der Treffer knapp auerhalb der Zelle und
+  // damit ihres Abschnitts liegen; da die Zellen in Strahlrichtung getestet
+  // werden, wird er darauf begrenzt.
+  const float t = !lower || (upper && t_upper < t_lower) ? t_upper : t_lower;
+  *t_hit = std::max(t_enter, std::min(t, t_exit));
+  return true;
+}
+
+void Tile::CalculateBlockBounds(void) {
+  // Kleinste Blcke, hchstens so gro wie das Tile
+  block_cells_ = std::min(RAY_BLOCK_CELLS, size_ - 1);
+  block_bounds_.clear();
+  block_level_offsets_.clear();
+  for (int num_cells = block_cells_; num_cells <= size_ - 1;
+       num_cells *= 2) {
+    const int num_blocks_1d = (size_ - 1) / num_cells;
+    const size_t offset = block_bounds_.size();
+    block_level_offsets_.push_back(offset);
+    block_bounds_.resize(offset + 2 * num_blocks_1d * num_blocks_1d);
+    for (int by = 0; by < num_blocks_1d; ++by) {
+      for (int bx = 0; bx < num_blocks_1d; ++bx) {
+        float min = std::numeric_limits<float>::max();
+        float max = -std::numeric_limits<float>::max();
+        if (num_cells == block_cells_) {
+          // Aus den Hhenwerten (einschlielich der Rnder)
+          for (int y = by * num_cells; y <= (by + 1) * num_cells; ++y) {
+            for (int x = bx * num_cells; x <= (bx + 1) * num_cells; ++x) {
+              min = std::min(min, GetHeight(I(x, y)));
+              max = std::max(max, GetHeight(I(x, y)));
+            }
+          }
+        } else {
+          // Aus den 2 x 2 Blcken der Stufe darunter
+          const size_t below = block_level_offsets_.size() - 2;
+          const int num_below_1d = 2 * num_blocks_1d;
+          for (int dir = 0; dir < 4; ++dir) {
+            const float *b = &block_bounds_[block_level_offsets_[below] +
+                2 * ((2 * by + (dir >> 1)) * num_below_1d + 2 * bx + (dir & 1))];
+            min = std::min(min, b[0]);
+            max = std::max(max, b[1]);
+          }
+        }
+        block_bounds_[offset + 2 * (by * num_blocks_1d + bx)] = min;
+        block_bounds_[offset + 2 * (by * num_blocks_1d + bx) + 1] = max;
+      }
+    }
+  }
+}
+
+float Tile::GetWorldError(void) const {
+  return scale_ / (size_ - 1);
+}
+
+void Tile::PlaceVegetation(const D3DXVECTOR3 &position,
+                           const D3DXVECTOR3 &normal, const Random &random) {
+  assert(lod_ == terrain_->resident_lod_);
+  float normalized_height =
+      (position.y - terrain_->GetMinHeight()) /
+      (terrain_->GetMaxHeight() - terrain_->GetMinHeight());
+  if (vegetation_ == NULL) vegetation_ = new Gras();
+  vegetation_->PlaceSeed(position, normalized_height, normal, random);
 }
 
 void Tile::GrowVegetation(void) {
-  if (num_lod_ > 0) {
+  if (lod_ < terrain_->resident_lod_) {
     for (int dir = 0; dir < 4; ++dir) {
       children_[dir]->GrowVegetation();
     }
@@ -1,9 +1,12 @@
 #pragma once
 #include <string>
+#include <vector>
 #include "DXUT.h"
+#include "TileArena.h"
 #include "DXUTCamera.h"
 
-class LODSelector;
+class Frustum;
+class Random;
 class Terrain;
 class Vegetation;
 
@@ -12,18 +15,20 @@ class Vegetation;
  */
 class Tile {
  friend class Terrain;
+ friend class TerrainTest;
+ friend class TerrainBench;
 
  public:
   /**
    * Konstruktor.
    * @param terrain Das Terrain, zu dem das Tile gehrt
    * @param n Detaillevel, legt die Gre des Tiles (2^n - 1) fest
-   * @param roughness Rauheits-Faktor (je hher desto grer die
-   *                  Hhenunterschiede)
    * @param num_lod Anzahl zustzlicher LOD-Ebenen
+   * @param water Ob Hhen unter 0 als Wasseroberflche (0) gelesen werden
+   * @note Die Kind-Tiles werden nicht hier, sondern von Terrain::InitTiles
+   *       bzw. Terrain::LoadChildren erzeugt.
    */
-  Tile(Terrain *terrain, int n, float roughness, int num_lod, float scale,
-       bool water);
+  Tile(Terrain *terrain, int n, int num_lod, float scale, bool water);
   ~Tile(void);
 
   /**
@@ -46,9 +51,37 @@ class Tile {
    */
   float GetMaxHeight(void) const;
 
+  /**
+   * Interpoliert Hhe bzw. Normale an pos (x/z) im Tile der residenten
+   * LOD-Stufe, das pos enthlt. Im Lazy-Modus geladene Kinder werden nicht
+   * benutzt: Das Ergebnis hngt so nicht vom Cache ab, und TrimCache kann
+   * sie verwerfen, whrend abgefragt wird.
+   */
   float GetHeightAt(const D3DXVECTOR3 &pos) const;
   D3DXVECTOR3 GetNormalAt(const D3DXVECTOR3 &pos) const;
 
+  /**
+   * Abfrage fr QueryAt
+   */
+  struct Query {
+    float x, z;
+    /**
+     * Index des Ergebnisses
+     */
+    unsigned int index;
+  };
+
+  /**
+   * Batch-Variante von GetHeightAt und GetNormalAt fr n Abfragen in
+   * diesem Tile, das zur residenten LOD-Stufe gehren muss (siehe
+   * Terrain::GetResidentTileIndex). Jeweils vier Abfragen werden mit SSE
+   * gleichzeitig interpoliert.
+   * @param heights Feld fr die Hhen (an Query::index) oder NULL
+   * @param normals Feld fr die Normalen (an Query::index) oder NULL
+   */
+  void QueryAt(const Query *queries, size_t n, float *heights,
+               D3DXVECTOR3 *normals) const;
+
   /**
    * Erzeugt Vertex-, Normalen- und Index-Buffer ldt das Dreieckgitter des
    * Tiles in diese hoch. Wird ggf. rekursiv fr alle Kinder des Tiles
@@ -60,36 +93,94 @@ class Tile {
   HRESULT CreateBuffers(ID3D10Device *device);
 
   /**
-   * Rendert das Tile.
-   * @param lod_selector Ein LODSelector, der bestimmt, ob die LOD-Stufe des
-   *                     Tiles ausreicht. Wenn nicht, werden rekursiv die
-   *                     Kinder des Tiles gezeichnet.
-   * @param cam_pos Die Position der Kamera, zur bergabe an den LODSelector.
-   * @warning Vor dem Aufruf mssen die D3D10-Buffer mit Tile::CreateBuffers
-   *          erzeugt werden.
+   * Rendert die Vegetation der Tiles der untersten residenten LOD-Stufe
+   * unter diesem Tile. Teilbume auerhalb der Sichtpyramide werden
+   * verworfen.
+   * @param frustum Sichtpyramide fr das Culling (NULL: kein Culling und
+   *                keine Statistik, z.B. im Schattenpass)
+   * @param plane_mask Noch zu testende Ebenen von frustum (siehe
+   *                   Frustum::Test), fr die Wurzel Frustum::ALL_PLANES
    */
-  void Draw(LODSelector *lod_selector, const CBaseCamera *camera, bool culling=true);
-  void DrawVegetation(void);
+  void DrawVegetation(const Frustum *frustum, unsigned int plane_mask);
+
   /**
-   * Gibt den fr die interne Darstellung reservierten Speicher frei (auch
-   * rekursiv fr alle Kind-Tiles).
-   * @warning Die Methoden Tile::GetMinHeight, Tile::GetMaxHeight,
-   *          Tile::SaveObjs, Tile::CreateBuffers werden danach _nicht_ mehr
-   *          funktionieren. Tile::Draw wird unabhngig vom Aufruf dieser
-   *          Methode weiterarbeiten, sofern vorher Tile::CreateBuffers
-   *          aufgerufen wurde.
+   * Berechnet die Normalen dieses Tiles (nicht rekursiv). Schreibt nur in
+   * das eigene Tile und liest die Nachbarn nicht, kann also fr beliebige
+   * Tiles in beliebiger Reihenfolge oder parallel aufgerufen werden. Die
+   * Normalen auf gemeinsamen Rndern stimmen bitgenau berein.
    */
-  void FreeMemory(void);
+  void CalculateNormals(void);
+
+  void GetBoundingBox(D3DXVECTOR3 *out, D3DXVECTOR3 *mid) const;
 
   /**
-   * Berechnet die Normalen des Terrains.
+   * Gibt die achsenparallele Bounding-Box des Tiles als minimale und
+   * maximale Ecke zurck.
    */
-  void CalculateNormals(unsigned int *indices);
+  void GetBounds(D3DXVECTOR3 *box_min, D3DXVECTOR3 *box_max) const;
 
-  void GetBoundingBox(D3DXVECTOR3 *out, D3DXVECTOR3 *mid) const;
+  /**
+   * Strahl fr Raycast, mit vorberechnetem Kehrwert der Richtung
+   */
+  struct Ray {
+    Ray(const D3DXVECTOR3 &origin, const D3DXVECTOR3 &dir, float t_min,
+        float t_max);
+
+    D3DXVECTOR3 origin, dir, inv_dir;
+    /**
+     * Gesuchter Bereich des Strahlparameters t
+     */
+    float t_min, t_max;
+  };
+
+  /**
+   * Sucht den ersten Schnittpunkt des Strahls mit dem Terrain unter diesem
+   * Tile, bis hinunter zur untersten residenten LOD-Stufe. Steigt mit
+   * Schnitttests gegen die Bounding-Boxen (min_height_, max_height_) durch
+   * den Baum ab, in den Tiles der untersten Stufe weiter durch die
+   * Minimum-/Maximum-Pyramide der Zellblcke (block_bounds_), und
+   * schneidet zuletzt mit den Dreiecken der Zellen (wie bei
+   * Terrain::TriangulateZOrder).
+   * @param t_hit Strahlparameter des Schnittpunkts, falls einer gefunden
+   *              wurde
+   */
+  bool Raycast(const Ray &ray, float *t_hit) const;
 
   float GetWorldError(void) const;
 
+  /**
+   * Gibt den geometrischen Fehler des Tiles zurck: die grte senkrechte
+   * Abweichung zwischen der Oberflche eines Tiles und der seiner Kinder,
+   * ber alle Stufen unter diesem Tile. Ist nie kleiner als der
+   * geometrische Fehler der Kinder. Im Lazy-Modus ist er fr Tiles, deren
+   * Kinder noch nicht erzeugt wurden, geschtzt (siehe
+   * UpdateGeometricError).
+   */
+  float GetGeometricError(void) const { return geometric_error_; }
+
+  /**
+   * Vereinfacht das Dreiecksgitter des Tiles adaptiv zu einem Right-
+   * Triangulated Irregular Network (RTIN): Zwei Wurzeldreiecke entlang der
+   * Diagonale SW-NE werden rekursiv an der Mitte ihrer Hypotenuse halbiert.
+   * Die Vertices kommen dabei in derselben Reihenfolge hinzu wie bei der
+   * Diamond-Square-Verfeinerung der Hhen (erst Mittelpunkte, dann
+   * Kantenmitten). Geteilt wird ein Dreieck nur, wenn die Samples darin oder
+   * im Nachbardreieck an der Hypotenuse weiter als max_error von dessen
+   * Ebene abweichen knnten (nach einer Schranke, die sich in linearer Zeit
+   * von unten nach oben berechnen lsst), oder wenn unter den Teildreiecken
+   * eines geteilt wird; so entstehen keine T-Kreuzungen. Die Vertices auf
+   * dem Rand des Tiles bleiben immer erhalten, damit benachbarte Tiles (und
+   * deren Vernhen, siehe Terrain::SetStitching) zusammenpassen. Zellen,
+   * die in zwei Hlften ausgegeben werden, sind wie im Gitter an der
+   * Diagonale SW-NE geteilt.
+   * @param max_error Grte erlaubte senkrechte Abweichung von der
+   *                  Oberflche des Gitters (wie GetHeightAt) an den
+   *                  Samples und Zellmitten des Tiles
+   * @param indices Erhlt die Dreiecksliste (Indizes in das Gitter des
+   *                Tiles, Umlaufrichtung wie bei Terrain::TriangulateLines)
+   */
+  void Simplify(float max_error, std::vector<unsigned int> *indices) const;
+
   D3DXVECTOR3 GetHighestPoint(void) const;
 
  private:
@@ -98,72 +189,291 @@ class Tile {
    */
   enum Direction { NW = 0, NE, SW, SE };
 
+  /**
+   * Texel der Hhenkarte (DXGI_FORMAT_R32G32_UINT, 8 Bytes): Hhe als float
+   * und Normale kodiert mit PackedNormal (siehe GetTileData in
+   * TerrainRenderer.fx)
+   */
+  struct Texel {
+    float height;
+    unsigned int normal;
+  };
+
   // Kopierkonstruktor und Zuweisungsoperator verbieten.
   Tile(const Tile &t);
   void operator=(const Tile &t);
 
   /**
-   * Konstruktor fr Kind-Tiles.
+   * Konstruktor fr Kind-Tiles. Die Hhenwerte werden erst durch
+   * Tile::Generate berechnet.
    * @param parent Eltern-Tile
    * @param direction Quadrant des Eltern-Tiles, in dem dieses Tile liegt
-   * @param roughness Rauheits-Faktor fr die weitere Verfeinerung
-   * @param north Zeiger auf nrdlichen Nachbarn (oder NULL)
-   * @param west Zeiger auf westlichen Nachbarn (oder NULL)
+   * @param block Speicher des Tiles aus der TileArena des Terrains
    */
-  Tile(Tile *parent, Direction direction, float roughness,
-       Tile *north, Tile *west);
+  Tile(Tile *parent, Direction direction, const TileArena::Block &block);
 
   /**
-   * Initialisierungsfunktion fr das Wurzel-Tile. Setzt die anfnglichen
-   * Zufallswerte und berechnet x- und z-Koordinaten aller Vertices vor.
+   * Initialisierungsfunktion fr das Wurzel-Tile. bernimmt die Hhenwerte
+   * vom TileGenerator des Terrains.
+   */
+  void Init(void);
+  /**
+   * Legt die (noch leeren) Kind-Tiles an, falls ntig.
    */
-  void Init(float roughness);
+  void CreateChildren(void);
   /**
-   * Initialisierungsfunktion fr ein Kind-Tile. bernimmt die Werte aus dem
-   * entsprechenden Quadranten des Eltern-Tiles und berechnet x- und z-
-   * Koordinaten aller Vertices vor.
+   * Berechnet die Hhenwerte eines Kind-Tiles aus dem Eltern-Tile (mit
+   * TileGenerator::GenerateFromParent). Hngt nur vom Eltern-Tile ab (auch
+   * die bergnge zu den Nachbarn), kann also fr beliebige Tiles einer
+   * LOD-Stufe in beliebiger Reihenfolge oder parallel ausgefhrt werden.
    */
-  void InitFromParent(void);
+  void Generate(void);
+
   /**
-   * Fhrt die Verfeinerung der Hheninformationen nach dem
-   * Diamond-Square-Algorithmus zur Blockgre block_size durch.
+   * Gibt an, ob die Kind-Tiles erzeugt wurden. Im Lazy-Modus des Terrains
+   * ist das unterhalb der residenten LOD-Stufen nicht immer der Fall.
    */
-  void Refine(int block_size, float roughness);
+  bool HasChildren(void) const { return children_[0] != NULL; }
+
   /**
-   * Initialisiert die Kind-Tiles, falls ntig.
-   * @param roughness Rauheits-Faktor fr die Verfeinerung der Kind-Tiles
-   * @param north Nrdlicher Nachbar dieses Tiles
-   * @param west Westlicher Nachbar dieses Tiles
+   * Gibt den Hhenwert am Index index zurck. Bei Terrains mit Wasser wird
+   * auf die Wasseroberflche (0) begrenzt. heights_ selbst behlt die
+   * unbegrenzten Werte, da die Kind-Tiles daraus verfeinert werden (nicht
+   * aber quantized_heights_, siehe StoreHeights).
+   * Alle lesenden Zugriffe auf die Hhenwerte sollten hierber laufen.
    */
-  void InitChildren(float roughness, Tile *north, Tile *west);
+  float GetHeight(int index) const {
+    const float height = GetRawHeight(index);
+    return (water_ && height < 0.0f) ? 0.0f : height;
+  }
 
   /**
-   * "Repariert" die bergnge des Tiles. bernimmt die sdlichste Zeile des
-   * nrdlichen Nachbarn und stlichste Spalte des westlichen Nachbarn.
+   * Gibt den unbegrenzten Hhenwert am Index index zurck, auch wenn das
+   * Tile nur die Residuen speichert. Bei 16-Bit-Speicherung sind die Werte
+   * schon auf die Wasseroberflche begrenzt.
    */
-  void FixEdges(Tile *north, Tile *west);
+  float GetRawHeight(int index) const {
+    return residual_ ? GetResidualHeight(index) : GetStoredHeight(index);
+  }
 
-  void CreateWater(void);
+  /**
+   * Gibt den index-ten gespeicherten Wert zurck, bei 16-Bit-Speicherung
+   * dekodiert.
+   */
+  float GetStoredHeight(int index) const {
+    if (quantized_heights_) {
+      return height_offset_ + quantized_heights_[index] * height_step_;
+    }
+    return heights_[index];
+  }
+
+  /**
+   * Gibt an, ob die Hhenwerte mit 16 Bit gespeichert werden.
+   */
+  bool IsQuantized(void) const { return quantized_heights_ != NULL; }
+
+  /**
+   * Speichert die berechneten Hhenwerte heights (size_ x size_) je nach
+   * Speicherart des Tiles (vollstndig oder nur Residuen, float oder
+   * 16 Bit).
+   */
+  void StoreHeights(const float *heights);
+
+  /**
+   * Implementierung von GetRawHeight fr Tiles, die nur die Residuen
+   * speichern. Gerade Positionen werden beim Eltern-Tile nachgeschlagen.
+   */
+  float GetResidualHeight(int index) const;
+
+  /**
+   * Schreibt alle unbegrenzten Hhenwerte des Tiles nach out.
+   * @param out Feld fr GetResolution() Werte
+   */
+  void GetRawHeights(float *out) const;
+
+  /**
+   * Schreibt die Texel der Hhenkarte, die CreateBuffers hochldt, nach out.
+   * @param out Feld fr GetResolution() Texel
+   */
+  void GetTexels(Texel *out) const;
+
+  /**
+   * Gibt die Anzahl der in heights_ gespeicherten Werte zurck.
+   */
+  int GetNumStoredHeights(void) const {
+    return GetNumStoredHeights(size_, residual_);
+  }
+
+  /**
+   * Gibt die Anzahl der gespeicherten Hhenwerte eines Kind-Tiles mit
+   * Seitenlnge size zurck, mit oder ohne Residual-Speicherung.
+   */
+  static int GetNumStoredHeights(int size, bool residual);
+
+  /**
+   * Addiert den Speicherbedarf der Hhenwerte dieses Tiles und aller
+   * vorhandenen Kind-Tiles zu stored bzw. full (vollstndig als float),
+   * jeweils am Index der LOD-Stufe.
+   */
+  void GetHeightMemory(std::vector<size_t> *stored,
+                       std::vector<size_t> *full) const;
 
   inline D3DXVECTOR3 GetVectorFromIndex(int index) const;
+
+  /**
+   * Hhenwerte (begrenzt wie GetHeight) fr CalculateNormals: der Rand von
+   * einem Sample aus den Nachbar-Tiles derselben LOD-Stufe. north und south
+   * umfassen size_ + 2 Werte (einschlielich der Ecken), west und east
+   * size_ Werte; leer am Rand des Terrains.
+   */
+  struct Halo {
+    std::vector<float> north, south, west, east;
+    /**
+     * Exakte Hhenwerte des Tiles selbst, nur bei 16-Bit-Speicherung
+     */
+    std::vector<float> heights;
+  };
+
   /**
-   * Rekursive Implementierung von CalculateNormals
+   * Berechnet den Rand fr CalculateNormals mit dem TileGenerator.
    */
-  void CalculateNormals0(Tile *north, Tile *west, unsigned int *indices);
+  void GetHalo(Halo *halo) const;
 
   /**
-   * Normalisiert alle Vertex-Normalen.
+   * Schreibt die Hhenwerte der Zeile y (-1 bis size_) einschlielich des
+   * Rands nach out (x = -1 bis size_) und fllt bis width auf.
    */
-  void NormalizeNormals(void);
+  void GetHeightRow(const Halo &halo, int y, int width, float *out) const;
 
   /**
    * Gibt die von CreateBuffers erzeugten Buffer wieder frei (nicht rekursiv).
    */
   void ReleaseBuffers(void);
 
+  /**
+   * Gibt die Index-Buffer in simplified_meshes_ frei.
+   */
+  void ReleaseSimplifiedMeshes(void);
+
+  /**
+   * Verwirft die vereinfachten Meshes, falls sie fr eine andere
+   * Fehlerschranke als max_error erzeugt wurden.
+   */
+  void SetSimplifiedError(float max_error);
+
   void CalculateHeights(void);
 
-  void PlaceVegetation(const D3DXVECTOR3 &position);
+  /**
+   * Berechnet deviation_ aus den Hhenwerten des Tiles. Die geraden
+   * Samples stimmen mit dem Eltern-Tile berein, die ungeraden liegen auf
+   * Kanten bzw. der Diagonale SW-NE (siehe Terrain::TriangulateZOrder)
+   * seiner Dreiecke. Beide Oberflchen sind ber den Dreiecken des Tiles
+   * linear, der Abstand ist also an dessen Samples am grten.
+   */
+  void CalculateDeviation(void);
+
+  /**
+   * Bestimmt geometric_error_ aus den Kind-Tiles bzw. schtzt ihn, falls
+   * sie (im Lazy-Modus) noch nicht erzeugt wurden: Die Zufallsverschiebung
+   * halbiert sich von Stufe zu Stufe (TileGenerator::GetOffsetFactor),
+   * geschtzt wird also die Hlfte von deviation_. Die Vorfahren werden
+   * nicht angepasst (siehe Terrain::LoadChildren).
+   * @return Ob sich der Wert gendert hat
+   */
+  bool UpdateGeometricError(void);
+
+  /**
+   * Erweitert min_height_ und max_height_ um die Hhen der Kind-Tiles (im
+   * Lazy-Modus nach dem Erzeugen der Kinder, siehe Terrain::LoadChildren).
+   * Die Vorfahren werden nicht angepasst.
+   * @return Ob sich einer der Werte gendert hat
+   */
+  bool UpdateHeightBounds(void);
+
+  /**
+   * Berechnet die Minimum-/Maximum-Pyramide der Zellblcke fr Raycast.
+   */
+  void CalculateBlockBounds(void);
+
+  /**
+   * Raycast im Bereich [t_min, t_max] des Strahls, der bereits auf dieses
+   * Tile beschrnkt ist
+   */
+  bool Raycast(const Ray &ray, float t_min, float t_max, float *t_hit) const;
+
+  /**
+   * Raycast im Block (block_x, block_y) der Stufe level der Zellblock-
+   * Pyramide
+   */
+  bool RaycastBlock(const Ray &ray, int level, int block_x, int block_y,
+                    float t_min, float t_max, float *t_hit) const;
+
+  /**
+   * Raycast in den num_cells x num_cells Zellen ab (cell_x, cell_y), mit
+   * einer 2D-DDA entlang des Strahls
+   */
+  bool RaycastCells(const Ray &ray, int cell_x, int cell_y, int num_cells,
+                    float t_min, float t_max, float *t_hit) const;
+
+  /**
+   * Schneidet den Strahl mit den beiden Dreiecken der Zelle (cell_x,
+   * cell_y), die er zwischen t_enter und t_exit durchquert.
+   */
+  bool IntersectCell(const Ray &ray, int cell_x, int cell_y, float t_enter,
+                     float t_exit, float *t_hit) const;
+
+  /**
+   * Unterscheidet die beiden Dreiecke, deren Hypotenuse den Mittelpunkt m
+   * hat, nach der Lage ihres rechten Winkels c (fr Simplify).
+   * @return 0 oder 1
+   */
+  static int GetTriangleSide(int cx, int cy, int mx, int my) {
+    return (cy > my || (cy == my && cx > mx)) ? 1 : 0;
+  }
+
+  /**
+   * Bestimmt fr Simplify die Schranke der Abweichung der Samples im
+   * Dreieck (a, b, c) mit der Hypotenuse a-b von seiner Ebene (in bounds,
+   * je Vertex fr beide Seiten der Hypotenuse, siehe GetTriangleSide) und
+   * erhht damit und mit den Fehlern der Kinder den Fehler des Vertex auf
+   * der Hypotenuse. Die Kinder mssen schon bearbeitet sein.
+   * @param leaf_children Ob die Kinder Zellhlften sind
+   */
+  void UpdateSimplificationError(const std::vector<float> &heights, int ax,
+                                 int ay, int bx, int by, int cx, int cy,
+                                 bool leaf_children,
+                                 std::vector<float> *errors,
+                                 std::vector<float> *bounds) const;
+
+  /**
+   * Gibt die Abweichung der Zellhlfte (a, b, c) mit der Hypotenuse a-b
+   * vom Gitter an deren Mitte zurck (fr Simplify): 0, falls a-b wie die
+   * Triangulierung des Gitters SW-NE verluft, sonst die halbe Differenz
+   * der Summen der Hhen an den Enden beider Diagonalen.
+   */
+  float GetDiagonalError(const std::vector<float> &heights, int ax, int ay,
+                         int bx, int by, int cx, int cy) const;
+
+  /**
+   * Gibt das Dreieck (a, b, c) mit der Hypotenuse a-b aus oder teilt es
+   * an deren Mitte (fr Simplify). Eine Zellhlfte mit der Hypotenuse
+   * NW-SE wird an der Diagonale SW-NE gespiegelt ausgegeben, wenn auch die
+   * andere Hlfte der Zelle einzeln ausgegeben wird.
+   * @param errors Fehler der Vertices, mindestens so gro wie die aller
+   *               Vertices, die beim Teilen darunter hinzukommen
+   */
+  void SimplifyTriangle(const std::vector<float> &errors, float max_error,
+                        int ax, int ay, int bx, int by, int cx, int cy,
+                        std::vector<unsigned int> *indices) const;
+
+  /**
+   * Setzt einen Vegetations-Keim an position (mit Hhe) in dieses Tile,
+   * das zur untersten residenten LOD-Stufe gehren muss (siehe
+   * Terrain::GetResidentTileIndex).
+   * @param normal Terrain-Normale an position
+   */
+  void PlaceVegetation(const D3DXVECTOR3 &position, const D3DXVECTOR3 &normal,
+                       const Random &random);
 
   void GrowVegetation(void);
 
@@ -185,14 +495,22 @@ class Tile {
   const int num_lod_;
 
   /**
-   * Feld der Hhen dieses Tiles
+   * Feld der Hhen dieses Tiles. Bei Residual-Speicherung (residual_) nur
+   * die Werte mit ungeradem x oder y, zeilenweise. Der Speicher gehrt der
+   * TileArena des Terrains.
    */
   float *heights_;
+  /**
+   * Mit 16 Bit quantisierte Hhenwerte (siehe height_offset_, height_step_),
+   * wenn das Terrain so erzeugt wurde. Dann ist heights_ NULL und umgekehrt.
+   */
+  unsigned short *quantized_heights_;
 
   /**
-   * Feld der Per-Vertex-Normalen dieses Tiles
+   * Feld der Per-Vertex-Normalen dieses Tiles, kodiert mit PackedNormal
+   * (ebenfalls in der TileArena)
    */
-  D3DXVECTOR3 *vertex_normals_;
+  unsigned int *vertex_normals_;
   /**
    * bergeordnetes Eltern-Tile
    */
@@ -201,22 +519,91 @@ class Tile {
    * Quadrant des Eltern-Tiles, in dem dieses Tile liegt
    */
   Direction direction_;
+  /**
+   * Position des Tiles im Tile-Raster seiner LOD-Stufe
+   */
+  int tile_x_, tile_y_;
   /**
    * Feld der Kind-Tiles (falls vorhanden)
    */
   Tile *children_[4];
 
+  /**
+   * Dekodierung der 16-Bit-Hhenwerte: Hhe = height_offset_ + Wert *
+   * height_step_ (minimaler Wert bzw. Schrittweite der unbegrenzten Hhen)
+   */
+  float height_offset_;
+  float height_step_;
+
   float max_height_;
   float min_height_;
+
+  /**
+   * Grte senkrechte Abweichung der Samples dieses Tiles von der
+   * Oberflche des Eltern-Tiles (0 fr die Wurzel)
+   */
+  float deviation_;
+  /**
+   * Siehe GetGeometricError
+   */
+  float geometric_error_;
+
+  /**
+   * Minimum-/Maximum-Pyramide ber Blcke von block_cells_ x block_cells_
+   * Zellen, nur in den Tiles der untersten residenten LOD-Stufe. Stufe 0
+   * sind die kleinsten Blcke, jede weitere fasst 2 x 2 Blcke zusammen bis
+   * zu einem einzigen. Je Block zwei Werte (Minimum, Maximum), zeilenweise;
+   * die Stufe k beginnt bei block_level_offsets_[k].
+   */
+  std::vector<float> block_bounds_;
+  std::vector<size_t> block_level_offsets_;
+  int block_cells_;
   float scale_;
   D3DXVECTOR2 translation_;
 
   ID3D10Texture2D *height_map_;
   ID3D10ShaderResourceView *shader_resource_view_;
 
+  /**
+   * Index-Buffer einer vereinfachten Triangulierung des Tiles (siehe
+   * Simplify) fr die Variante stitch_mask (siehe Terrain::StitchEdge),
+   * erzeugt von Terrain::GetSimplifiedMesh
+   */
+  struct SimplifiedMesh {
+    int stitch_mask;
+    ID3D10Buffer *index_buffer;
+    UINT num_indices;
+  };
+  /**
+   * Die bisher bentigten Varianten (meist nur eine), alle fr die
+   * Fehlerschranke simplified_error_
+   */
+  std::vector<SimplifiedMesh> simplified_meshes_;
+  float simplified_error_;
+  /**
+   * Anzahl der Dreiecke von Simplify fr simplified_error_ (ohne
+   * Stitching), -1 falls noch nicht bestimmt (siehe
+   * Terrain::GetNumTriangles)
+   */
+  int simplified_triangles_;
+
   Vegetation *vegetation_;
   ID3D10Device *device_;
 
-  bool should_cull_;
+  /**
+   * Ob Hhen unter 0 als Wasseroberflche gelesen werden (siehe GetHeight)
+   */
+  bool water_;
+  /**
+   * Ob nur die Residuen gespeichert werden, also die Werte, die nicht schon
+   * im Eltern-Tile vorhanden sind (nie beim Wurzel-Tile)
+   */
+  bool residual_;
+  /**
+   * Zhler des letzten Terrain::BuildRenderList, das die Kinder dieses
+   * Tiles verwendet hat (fr die Verdrngung im Lazy-Modus)
+   */
+  unsigned int last_used_;
+
 };
 
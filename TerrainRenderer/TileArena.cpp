@@ -0,0 +1,115 @@
+#include <malloc.h>
+#include "TileArena.h"
+
+namespace {
+
+/**
+ * Ausrichtung aller Blöcke und Tiles (eine Cache-Line)
+ */
+const size_t ALIGNMENT = 64;
+/**
+ * Anzahl der Gruppen (zu je vier Tiles), um die der Pool wächst
+ */
+const size_t POOL_GROUPS = 16;
+
+/**
+ * Gibt die Größe eines gespeicherten Höhenwerts zurück.
+ */
+size_t GetHeightSize(bool quantized) {
+  return quantized ? sizeof(unsigned short) : sizeof(float);
+}
+
+size_t Align(size_t bytes) {
+  return (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+/**
+ * Verschränkt die Bits von x und y (x in den geraden Bits) und gibt so den
+ * Index der Position (x, y) in Morton-Reihenfolge zurück.
+ */
+size_t MortonIndex(unsigned int x, unsigned int y) {
+  size_t index = 0;
+  for (int bit = 0; bit < 16; ++bit) {
+    index |= static_cast<size_t>((x >> bit) & 1) << (2 * bit);
+    index |= static_cast<size_t>((y >> bit) & 1) << (2 * bit + 1);
+  }
+  return index;
+}
+
+}
+
+TileArena::TileArena(int size, int num_child_heights, int resident_lod,
+                     bool quantized)
+    : root_heights_bytes_(Align(GetHeightSize(quantized) * size * size)),
+      child_heights_bytes_(Align(GetHeightSize(quantized) *
+                                 num_child_heights)),
+      normals_bytes_(Align(sizeof(unsigned int) * size * size)),
+      num_bytes_(0),
+      quantized_(quantized) {
+  levels_.push_back(Allocate(1, root_heights_bytes_ + normals_bytes_));
+  for (int lod = 1; lod <= resident_lod; ++lod) {
+    const size_t num_tiles = static_cast<size_t>(1) << (2 * lod);
+    levels_.push_back(Allocate(num_tiles,
+                               child_heights_bytes_ + normals_bytes_));
+  }
+}
+
+TileArena::~TileArena(void) {
+  for (size_t i = 0; i < levels_.size(); ++i) _aligned_free(levels_[i]);
+  for (size_t i = 0; i < pool_.size(); ++i) _aligned_free(pool_[i]);
+}
+
+char *TileArena::Allocate(size_t num_tiles, size_t stride) {
+  const size_t bytes = num_tiles * stride;
+  num_bytes_ += bytes;
+  return static_cast<char *>(_aligned_malloc(bytes, ALIGNMENT));
+}
+
+TileArena::Block TileArena::GetBlock(char *memory,
+                                     size_t heights_bytes) const {
+  Block block;
+  block.heights = quantized_ ? NULL : reinterpret_cast<float *>(memory);
+  block.quantized_heights =
+      quantized_ ? reinterpret_cast<unsigned short *>(memory) : NULL;
+  block.normals = reinterpret_cast<unsigned int *>(memory + heights_bytes);
+  return block;
+}
+
+TileArena::Block TileArena::GetRootBlock(void) const {
+  return GetBlock(levels_[0], root_heights_bytes_);
+}
+
+void TileArena::GetChildBlocks(int lod, int tile_x, int tile_y,
+                               Block out[4]) {
+  const size_t stride = child_heights_bytes_ + normals_bytes_;
+  char *memory;
+  if (static_cast<size_t>(lod + 1) < levels_.size()) {
+    // Die Kinder von (x, y) haben die Morton-Indizes 4 * m(x, y) + dir
+    memory = levels_[lod + 1] + 4 * MortonIndex(tile_x, tile_y) * stride;
+  } else {
+    if (free_groups_.empty()) {
+      char *chunk = Allocate(4 * POOL_GROUPS, stride);
+      pool_.push_back(chunk);
+      for (size_t i = POOL_GROUPS; i-- > 0;) {
+        free_groups_.push_back(chunk + 4 * i * stride);
+      }
+    }
+    memory = free_groups_.back();
+    free_groups_.pop_back();
+  }
+  for (int dir = 0; dir < 4; ++dir) {
+    out[dir] = GetBlock(memory + dir * stride, child_heights_bytes_);
+  }
+}
+
+void TileArena::ReleaseChildBlocks(const Block blocks[4]) {
+  // Die Gruppe beginnt mit den Höhenwerten des ersten Kind-Tiles
+  void *memory = quantized_ ?
+      static_cast<void *>(blocks[0].quantized_heights) :
+      static_cast<void *>(blocks[0].heights);
+  free_groups_.push_back(static_cast<char *>(memory));
+}
+
+size_t TileArena::GetNumBytes(void) const {
+  return num_bytes_;
+}
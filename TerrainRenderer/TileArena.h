@@ -0,0 +1,116 @@
+#pragma once
+#include <vector>
+#include "DXUT.h"
+
+/**
+ * Verwaltet den Speicher für Höhenwerte und Normalen aller Tiles eines
+ * Terrains.
+ *
+ * Die residenten LOD-Stufen liegen jeweils in einem einzigen, ausgerichteten
+ * Block, in dem die Tiles in Morton-Reihenfolge (Z-Order) angeordnet sind.
+ * Benachbarte Tiles liegen dadurch auch im Speicher nahe beieinander, und
+ * das Freigeben einer Stufe kostet unabhängig von der Anzahl der Tiles nur
+ * einen Aufruf.
+ *
+ * Tiles unterhalb der residenten Stufen (Lazy-Modus) werden jeweils als
+ * Gruppe der vier Geschwister aus einem Pool vergeben, der in Blöcken zu
+ * mehreren Gruppen wächst und freigegebene Gruppen wiederverwendet.
+ */
+class TileArena {
+ public:
+  /**
+   * Speicher eines Tiles
+   */
+  struct Block {
+    /**
+     * Höhenwerte, je nach Speicherart float oder 16 Bit (das jeweils andere
+     * Feld ist NULL)
+     */
+    float *heights;
+    unsigned short *quantized_heights;
+    unsigned int *normals;
+  };
+
+  /**
+   * Konstruktor. Reserviert den Speicher der residenten LOD-Stufen.
+   * @param size Seitenlänge eines Tiles
+   * @param num_child_heights Anzahl der Höhenwerte je Kind-Tile (siehe
+   *                          Tile::GetNumStoredHeights); das Wurzel-Tile hat
+   *                          immer size x size Höhenwerte
+   * @param resident_lod Anzahl der residenten LOD-Stufen unter dem
+   *                     Wurzel-Tile
+   * @param quantized Ob die Höhenwerte mit 16 Bit gespeichert werden
+   */
+  TileArena(int size, int num_child_heights, int resident_lod,
+            bool quantized);
+  ~TileArena(void);
+
+  /**
+   * Gibt den Speicher des Wurzel-Tiles zurück.
+   */
+  Block GetRootBlock(void) const;
+
+  /**
+   * Gibt den Speicher der vier Kind-Tiles des Tiles an Position
+   * (tile_x, tile_y) der Stufe lod zurück, geordnet nach Tile::Direction.
+   * Liegen die Kind-Tiles unterhalb der residenten Stufen, wird der Speicher
+   * aus dem Pool vergeben und muss mit ReleaseChildBlocks zurückgegeben
+   * werden.
+   */
+  void GetChildBlocks(int lod, int tile_x, int tile_y, Block out[4]);
+
+  /**
+   * Gibt den mit GetChildBlocks aus dem Pool vergebenen Speicher von vier
+   * Kind-Tiles zurück.
+   */
+  void ReleaseChildBlocks(const Block blocks[4]);
+
+  /**
+   * Gibt den insgesamt reservierten Speicher in Bytes zurück.
+   */
+  size_t GetNumBytes(void) const;
+
+ private:
+  // Kopierkonstruktor und Zuweisungsoperator verbieten.
+  TileArena(const TileArena &a);
+  void operator=(const TileArena &a);
+
+  /**
+   * Reserviert einen ausgerichteten Block für num_tiles Tiles mit je
+   * stride Bytes.
+   */
+  char *Allocate(size_t num_tiles, size_t stride);
+
+  /**
+   * Teilt den Speicher ab memory in Höhenwerte und Normalen auf.
+   */
+  Block GetBlock(char *memory, size_t heights_bytes) const;
+
+  /**
+   * Bytes für Höhenwerte je Tile (Wurzel-Tile bzw. Kind-Tiles), jeweils auf
+   * ALIGNMENT aufgerundet
+   */
+  const size_t root_heights_bytes_;
+  const size_t child_heights_bytes_;
+  /**
+   * Bytes für (kodierte) Normalen je Tile, auf ALIGNMENT aufgerundet
+   */
+  const size_t normals_bytes_;
+  /**
+   * Speicher je residenter LOD-Stufe
+   */
+  std::vector<char *> levels_;
+  /**
+   * Blöcke des Pools für Tiles unterhalb der residenten Stufen
+   */
+  std::vector<char *> pool_;
+  /**
+   * Freie Gruppen im Pool
+   */
+  std::vector<char *> free_groups_;
+  size_t num_bytes_;
+  /**
+   * Ob die Höhenwerte mit 16 Bit gespeichert werden
+   */
+  const bool quantized_;
+};
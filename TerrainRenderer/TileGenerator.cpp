@@ -0,0 +1,432 @@
+#include <algorithm>
+#include <cassert>
+#include <vector>
+#include <intrin.h>
+#include <smmintrin.h>
+#include "TileGenerator.h"
+#include "Random.h"
+
+// Makro, um die Indexberechnungen für das "flachgeklopfte" 2D-Array von
+// Vertices zu vereinfachen
+#define I(x,y) (static_cast<unsigned int>(y)*size_+static_cast<unsigned int>(x))
+
+namespace {
+
+/**
+ * Prüft, ob die CPU SSE4.1 unterstützt.
+ */
+bool HasSSE41(void) {
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 19)) != 0;
+}
+
+/**
+ * Vektorisierte Variante von Random::GetSignedFloat für die vier Indizes
+ * index, index + 2, index + 4 und index + 6.
+ */
+inline __m128 RandomSignedFloat4(__m128i key, int index) {
+  __m128i h = _mm_add_epi32(_mm_set1_epi32(index), _mm_setr_epi32(0, 2, 4, 6));
+  h = _mm_xor_si128(key, _mm_mullo_epi32(h, _mm_set1_epi32(0x9e3779b9)));
+  h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+  h = _mm_mullo_epi32(h, _mm_set1_epi32(0x85ebca6b));
+  h = _mm_xor_si128(h, _mm_srli_epi32(h, 13));
+  h = _mm_mullo_epi32(h, _mm_set1_epi32(0xc2b2ae35));
+  h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+  __m128 f = _mm_cvtepi32_ps(_mm_srli_epi32(h, 8));
+  return _mm_sub_ps(_mm_mul_ps(f, _mm_set1_ps(2.0f / (1 << 24))),
+                    _mm_set1_ps(1.0f));
+}
+
+}
+
+bool TileGenerator::use_sse_ = HasSSE41();
+
+/**
+ * Rechteckiger Ausschnitt einer LOD-Stufe in deren globalen
+ * Sample-Koordinaten (x0 bis x1 und y0 bis y1, jeweils einschließlich).
+ */
+struct TileGenerator::Window {
+  int x0, y0, x1, y1;
+  std::vector<float> heights;
+
+  void Resize(void) { heights.resize((x1 - x0 + 1) * (y1 - y0 + 1)); }
+  float &At(int x, int y) { return heights[(y - y0) * (x1 - x0 + 1) + x - x0]; }
+  float At(int x, int y) const {
+    return heights[(y - y0) * (x1 - x0 + 1) + x - x0];
+  }
+};
+
+TileGenerator::TileGenerator(unsigned int seed, int n, float roughness,
+                             float scale)
+    : seed_(seed),
+      size_((1 << n) + 1),
+      roughness_(roughness),
+      scale_(scale) {
+  root_ = new float[size_*size_];
+  const Random random(seed_, RANDOM_STREAM_HEIGHTS);
+
+  // Ecken mit Zufallshöhenwerten initialisieren
+  int block_size = size_ - 1;
+  const Random random_n(random, 0, 0);
+  const Random random_s(random, 0, block_size);
+  root_[I(0, 0)] = random_n.GetSignedFloat(0);
+  root_[I(0, block_size)]= random_s.GetSignedFloat(0);
+  root_[I(block_size, 0)] = random_n.GetSignedFloat(block_size);
+  root_[I(block_size, block_size)] = random_s.GetSignedFloat(block_size);
+
+  // Verfeinerungsschritte durchführen bis sämtliche Werte berechnet sind
+  while (block_size > 1) {
+    Refine(root_, 0, 0, 0, block_size);
+    block_size = block_size / 2;
+  }
+}
+
+TileGenerator::~TileGenerator(void) {
+  delete[] root_;
+}
+
+float TileGenerator::GetOffsetFactor(int lod, int block_size) const {
+  // Seitenlänge der Tiles wie bei Tile::scale_ durch fortgesetztes Halbieren
+  float scale = scale_;
+  for (int l = 0; l < lod; ++l) scale *= 0.5f;
+  return (0.2f * scale) * roughness_ * block_size / (size_ - 1);
+}
+
+void TileGenerator::GenerateFromParent(int lod, int tile_x, int tile_y,
+                                       const float *parent, float *out) const {
+  // Werte aus dem entsprechenden Quadranten des Eltern-Tiles übernehmen
+  const int x1 = (tile_x & 1) * (size_ / 2);
+  const int y1 = (tile_y & 1) * (size_ / 2);
+  for (int y = 0; y < size_; y += 2) {
+    for (int x = 0; x < size_; x += 2) {
+      out[I(x, y)] = parent[I(x/2 + x1, y/2 + y1)];
+    }
+  }
+  Refine(out, lod, tile_x, tile_y, 2);
+}
+
+void TileGenerator::Generate(int lod, int tile_x, int tile_y,
+                             float *out) const {
+  assert(tile_x >= 0 && tile_x < (1 << lod));
+  assert(tile_y >= 0 && tile_y < (1 << lod));
+  const int n = size_ - 1;
+  GenerateRegion(lod, tile_x * n, tile_y * n, tile_x * n + n, tile_y * n + n,
+                 out);
+}
+
+void TileGenerator::GenerateRegion(int lod, int x0, int y0, int x1, int y1,
+                                   float *out) const {
+  const int n = size_ - 1;
+  assert(0 <= x0 && x0 <= x1 && x1 <= (n << lod));
+  assert(0 <= y0 && y0 <= y1 && y1 <= (n << lod));
+
+  // Benötigte Ausschnitte aller Stufen bestimmen, von unten nach oben. Ein
+  // Ausschnitt braucht auch die Blockmittelpunkte direkt daneben, also in der
+  // Stufe darüber einen Rand von einem Sample.
+  std::vector<Window> windows(lod + 1);
+  windows[lod].x0 = x0;
+  windows[lod].y0 = y0;
+  windows[lod].x1 = x1;
+  windows[lod].y1 = y1;
+  for (int l = lod; l > 0; --l) {
+    const Window &window = windows[l];
+    Window &parent = windows[l - 1];
+    const int last = n << (l - 1);
+    parent.x0 = window.x0 > 0 ? (window.x0 - 1) / 2 : 0;
+    parent.y0 = window.y0 > 0 ? (window.y0 - 1) / 2 : 0;
+    parent.x1 = std::min((window.x1 + 2) / 2, last);
+    parent.y1 = std::min((window.y1 + 2) / 2, last);
+  }
+
+  // Stufe 0 aus dem Wurzel-Tile übernehmen, danach Stufe für Stufe
+  // verfeinern
+  Window &root = windows[0];
+  root.Resize();
+  for (int y = root.y0; y <= root.y1; ++y) {
+    for (int x = root.x0; x <= root.x1; ++x) {
+      root.At(x, y) = root_[I(x, y)];
+    }
+  }
+  for (int l = 1; l <= lod; ++l) {
+    RefineWindow(windows[l - 1], l, &windows[l]);
+  }
+
+  std::copy(windows[lod].heights.begin(), windows[lod].heights.end(), out);
+}
+
+void TileGenerator::RefineWindow(const Window &parent, int lod,
+                                 Window *window) const {
+  // Entspricht Refine mit Blockgröße 2, nur in globalen Koordinaten und auf
+  // einen Ausschnitt beschränkt. Die Reihenfolge der Rechenoperationen muss
+  // gleich bleiben, damit die Ergebnisse bitgenau übereinstimmen.
+  const int block = size_ - 1;
+  const int last = block << lod;
+  const float offset_factor = GetOffsetFactor(lod, 2);
+  const Random random(seed_, RANDOM_STREAM_HEIGHTS);
+  Window &w = *window;
+  w.Resize();
+
+  // Blockmittelpunkte, auch die direkt neben dem Ausschnitt
+  Window centers;
+  centers.x0 = std::max(w.x0 - 1, 0);
+  centers.y0 = std::max(w.y0 - 1, 0);
+  centers.x1 = std::min(w.x1 + 1, last);
+  centers.y1 = std::min(w.y1 + 1, last);
+  centers.Resize();
+  for (int y = centers.y0 | 1; y <= centers.y1; y += 2) {
+    const Random random_c(random, lod, y);
+    for (int x = centers.x0 | 1; x <= centers.x1; x += 2) {
+      float nw = parent.At((x - 1) / 2, (y - 1) / 2);
+      float ne = parent.At((x + 1) / 2, (y - 1) / 2);
+      float sw = parent.At((x - 1) / 2, (y + 1) / 2);
+      float se = parent.At((x + 1) / 2, (y + 1) / 2);
+      centers.At(x, y) = (nw + ne + sw + se) / 4 +
+                         offset_factor * random_c.GetSignedFloat(x);
+    }
+  }
+
+  for (int y = w.y0; y <= w.y1; ++y) {
+    const Random random_row(random, lod, y);
+    for (int x = w.x0; x <= w.x1; ++x) {
+      float height;
+      if ((x & 1) && (y & 1)) {
+        height = centers.At(x, y);
+      } else if (y & 1) {
+        // Zwischen zwei Ecken übereinander
+        float north = parent.At(x / 2, (y - 1) / 2);
+        float south = parent.At(x / 2, (y + 1) / 2);
+        if (x % block != 0) {
+          height = north + south + centers.At(x + 1, y);
+          height += centers.At(x - 1, y);
+          height /= 4;
+        } else {
+          // Auf dem Rand eines Tiles
+          height = (north + south) / 2;
+        }
+        height = height + offset_factor * random_row.GetSignedFloat(x);
+      } else if (x & 1) {
+        // Zwischen zwei Ecken nebeneinander
+        float west = parent.At((x - 1) / 2, y / 2);
+        float east = parent.At((x + 1) / 2, y / 2);
+        if (y % block != 0) {
+          height = west + east + centers.At(x, y + 1);
+          height += centers.At(x, y - 1);
+          height /= 4;
+        } else {
+          height = (west + east) / 2;
+        }
+        height = height + offset_factor * random_row.GetSignedFloat(x);
+      } else {
+        height = parent.At(x / 2, y / 2);
+      }
+      w.At(x, y) = height;
+    }
+  }
+}
+
+void TileGenerator::Refine(float *heights, int lod, int tile_x, int tile_y,
+                           int block_size) const {
+  if (block_size == 2 && use_sse_) {
+    RefineSSE(heights, lod, tile_x, tile_y);
+    return;
+  }
+
+  int block_size_h = block_size/2;
+  const float offset_factor = GetOffsetFactor(lod, block_size);
+
+  // Die Zufallswerte werden über die globale Position des Samples in der
+  // LOD-Stufe adressiert, hängen also nicht von der Reihenfolge ab.
+  const Random random(seed_, RANDOM_STREAM_HEIGHTS);
+  const int x0 = tile_x * (size_ - 1);
+  const int y0 = tile_y * (size_ - 1);
+
+  for (int y = block_size_h; y < size_; y += block_size) {
+    const Random random_n(random, lod, y0 + y - block_size_h);
+    const Random random_c(random, lod, y0 + y);
+    const Random random_s(random, lod, y0 + y + block_size_h);
+    for (int x = block_size_h; x < size_; x += block_size) {
+      // Lookup der umliegenden Höhenwerte (-); o ist Position (x, y)
+      // -   -
+      //   o
+      // -   -
+      float nw = heights[I(x - block_size_h, y - block_size_h)];
+      float ne = heights[I(x + block_size_h, y - block_size_h)];
+      float sw = heights[I(x - block_size_h, y + block_size_h)];
+      float se = heights[I(x + block_size_h, y + block_size_h)];
+
+      // Berechnung der neuen Höhenwerte (+)
+      // - + -
+      // + +
+      // -   -
+      float center = (nw + ne + sw + se) / 4 +
+                     offset_factor * random_c.GetSignedFloat(x0 + x);
+      heights[I(x, y)] = center;
+
+      // Werte auf dem Rand des Tiles hängen nur von den beiden Nachbarn auf
+      // dem Rand ab. Das benachbarte Tile berechnet dadurch exakt dieselben
+      // Werte, ohne dass die Tiles voneinander wissen müssen.
+      float n;
+      if (y > block_size_h) {
+        n = nw + ne + center;
+        n += heights[I(x, y - block_size)];
+        n /= 4;
+      } else {
+        n = (nw + ne) / 2;
+      }
+      heights[I(x, y - block_size_h)] =
+          n + offset_factor * random_n.GetSignedFloat(x0 + x);
+
+      float w;
+      if (x > block_size_h) {
+        w = nw + sw + center;
+        w += heights[I(x - block_size, y)];
+        w /= 4;
+      } else {
+        w = (nw + sw) / 2;
+      }
+      heights[I(x - block_size_h, y)] =
+          w + offset_factor * random_c.GetSignedFloat(x0 + x - block_size_h);
+
+      // Edge cases: Berechnung neuer Höhenwerte am rechten bzw. unteren Rand
+      // -   -
+      //     +
+      // - + -
+      if (x == size_ - 1 - block_size_h) {
+        heights[I(x + block_size_h, y)] =
+            (ne + se) / 2 +
+            offset_factor * random_c.GetSignedFloat(x0 + x + block_size_h);
+      }
+      if (y == size_ - 1 - block_size_h) {
+        heights[I(x, y + block_size_h)] =
+            (sw + se) / 2 +
+            offset_factor * random_s.GetSignedFloat(x0 + x);
+      }
+    }
+  }
+}
+
+void TileGenerator::RefineSSE(float *heights, int lod, int tile_x,
+                              int tile_y) const {
+  // Anzahl Blockmittelpunkte pro Zeile
+  const int m = (size_ - 1) / 2;
+  const float offset_factor = GetOffsetFactor(lod, 2);
+  const Random random(seed_, RANDOM_STREAM_HEIGHTS);
+  const int x0 = tile_x * (size_ - 1);
+  const int y0 = tile_y * (size_ - 1);
+  const __m128 offset4 = _mm_set1_ps(offset_factor);
+  const __m128 quarter4 = _mm_set1_ps(0.25f);
+  const __m128 half4 = _mm_set1_ps(0.5f);
+
+  // Zeilenweise zusammenhängende Kopien der beteiligten Werte:
+  // north/south: Eckwerte (gerade x) der Zeilen y-1 und y+1,
+  // centers/north_centers: Blockmittelpunkte der Zeilen y und y-2.
+  // Dadurch sind alle Zugriffe im Kernel sequentiell.
+  std::vector<float> north(m + 1), south(m + 1);
+  std::vector<float> centers(m), north_centers(m);
+  std::vector<float> edges(m + 1);
+  for (int k = 0; k <= m; ++k) north[k] = heights[I(2*k, 0)];
+
+  for (int y = 1; y < size_; y += 2) {
+    float *row_n = &heights[I(0, y - 1)];
+    float *row_c = &heights[I(0, y)];
+    float *row_s = &heights[I(0, y + 1)];
+    const Random random_n(random, lod, y0 + y - 1);
+    const Random random_c(random, lod, y0 + y);
+    const Random random_s(random, lod, y0 + y + 1);
+    const __m128i key_n = _mm_set1_epi32(random_n.GetKey());
+    const __m128i key_c = _mm_set1_epi32(random_c.GetKey());
+    const __m128i key_s = _mm_set1_epi32(random_s.GetKey());
+    for (int k = 0; k <= m; ++k) south[k] = row_s[2*k];
+
+    // Square-Schritt: Blockmittelpunkte (x = 2k+1)
+    int k = 0;
+    for (; k + 4 <= m; k += 4) {
+      __m128 sum = _mm_add_ps(_mm_loadu_ps(&north[k]), _mm_loadu_ps(&north[k+1]));
+      sum = _mm_add_ps(sum, _mm_loadu_ps(&south[k]));
+      sum = _mm_add_ps(sum, _mm_loadu_ps(&south[k+1]));
+      __m128 rnd = RandomSignedFloat4(key_c, x0 + 2*k + 1);
+      _mm_storeu_ps(&centers[k], _mm_add_ps(_mm_mul_ps(sum, quarter4),
+                                            _mm_mul_ps(offset4, rnd)));
+    }
+    for (; k < m; ++k) {
+      centers[k] = (north[k] + north[k+1] + south[k] + south[k+1]) / 4 +
+                   offset_factor * random_c.GetSignedFloat(x0 + 2*k + 1);
+    }
+
+    // Diamond-Schritt in Zeile y (x = 2k). Westlicher und östlicher Rand
+    // hängen nur von den beiden Nachbarn auf dem Rand ab.
+    edges[0] = (north[0] + south[0]) / 2 +
+               offset_factor * random_c.GetSignedFloat(x0);
+    k = 1;
+    for (; k + 4 <= m; k += 4) {
+      __m128 sum = _mm_add_ps(_mm_loadu_ps(&north[k]), _mm_loadu_ps(&south[k]));
+      sum = _mm_add_ps(sum, _mm_loadu_ps(&centers[k]));
+      sum = _mm_add_ps(sum, _mm_loadu_ps(&centers[k-1]));
+      __m128 rnd = RandomSignedFloat4(key_c, x0 + 2*k);
+      _mm_storeu_ps(&edges[k], _mm_add_ps(_mm_mul_ps(sum, quarter4),
+                                          _mm_mul_ps(offset4, rnd)));
+    }
+    for (; k < m; ++k) {
+      edges[k] = (north[k] + south[k] + centers[k] + centers[k-1]) / 4 +
+                 offset_factor * random_c.GetSignedFloat(x0 + 2*k);
+    }
+    edges[m] = (north[m] + south[m]) / 2 +
+               offset_factor * random_c.GetSignedFloat(x0 + 2*m);
+    for (k = 0; k < m; ++k) {
+      row_c[2*k] = edges[k];
+      row_c[2*k+1] = centers[k];
+    }
+    row_c[2*m] = edges[m];
+
+    // Diamond-Schritt in Zeile y-1 (x = 2k+1), am nördlichen Rand wieder nur
+    // aus den beiden Nachbarn auf dem Rand.
+    k = 0;
+    if (y > 1) {
+      for (; k + 4 <= m; k += 4) {
+        __m128 sum = _mm_add_ps(_mm_loadu_ps(&north[k]), _mm_loadu_ps(&north[k+1]));
+        sum = _mm_add_ps(sum, _mm_loadu_ps(&centers[k]));
+        sum = _mm_add_ps(sum, _mm_loadu_ps(&north_centers[k]));
+        __m128 rnd = RandomSignedFloat4(key_n, x0 + 2*k + 1);
+        _mm_storeu_ps(&edges[k], _mm_add_ps(_mm_mul_ps(sum, quarter4),
+                                            _mm_mul_ps(offset4, rnd)));
+      }
+      for (; k < m; ++k) {
+        edges[k] = (north[k] + north[k+1] + centers[k] + north_centers[k]) / 4 +
+                   offset_factor * random_n.GetSignedFloat(x0 + 2*k + 1);
+      }
+    } else {
+      for (; k + 4 <= m; k += 4) {
+        __m128 sum = _mm_add_ps(_mm_loadu_ps(&north[k]), _mm_loadu_ps(&north[k+1]));
+        __m128 rnd = RandomSignedFloat4(key_n, x0 + 2*k + 1);
+        _mm_storeu_ps(&edges[k], _mm_add_ps(_mm_mul_ps(sum, half4),
+                                            _mm_mul_ps(offset4, rnd)));
+      }
+      for (; k < m; ++k) {
+        edges[k] = (north[k] + north[k+1]) / 2 +
+                   offset_factor * random_n.GetSignedFloat(x0 + 2*k + 1);
+      }
+    }
+    for (k = 0; k < m; ++k) row_n[2*k+1] = edges[k];
+
+    // Südlicher Rand (x = 2k+1)
+    if (y == size_ - 2) {
+      k = 0;
+      for (; k + 4 <= m; k += 4) {
+        __m128 sum = _mm_add_ps(_mm_loadu_ps(&south[k]), _mm_loadu_ps(&south[k+1]));
+        __m128 rnd = RandomSignedFloat4(key_s, x0 + 2*k + 1);
+        _mm_storeu_ps(&edges[k], _mm_add_ps(_mm_mul_ps(sum, half4),
+                                            _mm_mul_ps(offset4, rnd)));
+      }
+      for (; k < m; ++k) {
+        edges[k] = (south[k] + south[k+1]) / 2 +
+                   offset_factor * random_s.GetSignedFloat(x0 + 2*k + 1);
+      }
+      for (k = 0; k < m; ++k) row_s[2*k+1] = edges[k];
+    }
+
+    north.swap(south);
+    north_centers.swap(centers);
+  }
+}
+
@@ -0,0 +1,132 @@
+#pragma once
+
+/**
+ * Berechnet die Höhenwerte der Tiles nach dem Diamond-Square-Algorithmus.
+ *
+ * Alle Zufallswerte hängen nur vom Startwert und von der globalen Position
+ * des Samples in seiner LOD-Stufe ab, und Werte auf dem Rand eines Tiles nur
+ * von den beiden benachbarten Randwerten. Ein Tile hängt dadurch nur von
+ * seinen Vorfahren ab, nicht von seinen Nachbarn. Das erlaubt neben dem
+ * üblichen Weg (Kind-Tile aus dem Eltern-Tile, siehe GenerateFromParent)
+ * auch die direkte Berechnung beliebiger Tiles (siehe Generate).
+ */
+class TileGenerator {
+ friend class TerrainTest;
+ friend class TerrainBench;
+
+ public:
+  /**
+   * Konstruktor. Berechnet das Wurzel-Tile.
+   * @param seed Startwert für die Zufallszahlen
+   * @param n Detaillevel, legt die Größe der Tiles (2^n + 1) fest
+   * @param roughness Rauheits-Faktor (je höher desto größer die
+   *                  Höhenunterschiede)
+   * @param scale Seitenlänge des Wurzel-Tiles
+   */
+  TileGenerator(unsigned int seed, int n, float roughness, float scale);
+  ~TileGenerator(void);
+
+  /**
+   * Gibt die Seitenlänge eines Tiles (in Samples) zurück.
+   */
+  int GetSize(void) const { return size_; }
+
+  /**
+   * Berechnet die Höhenwerte des Tiles an Position (tile_x, tile_y) im
+   * Tile-Raster der LOD-Stufe lod direkt aus dem Startwert. Dazu wird in
+   * jeder Stufe nur der Ausschnitt verfeinert, von dem das Tile abhängt, der
+   * Aufwand ist also O(Tile-Größe + lod). Das Ergebnis stimmt bitgenau mit
+   * dem über GenerateFromParent berechneten Tile überein.
+   * @param out Feld für GetSize() x GetSize() Höhenwerte
+   */
+  void Generate(int lod, int tile_x, int tile_y, float *out) const;
+
+  /**
+   * Berechnet wie Generate die Höhenwerte eines beliebigen Ausschnitts der
+   * LOD-Stufe lod, hier in globalen Sample-Koordinaten der Stufe (x0 bis x1
+   * und y0 bis y1, jeweils einschließlich). Der Aufwand hängt nur von der
+   * Größe des Ausschnitts und von lod ab, einzelne Zeilen oder Spalten (z.B.
+   * der Rand eines Nachbar-Tiles) sind also billig.
+   * @param out Feld für (x1 - x0 + 1) x (y1 - y0 + 1) Höhenwerte, zeilenweise
+   */
+  void GenerateRegion(int lod, int x0, int y0, int x1, int y1,
+                      float *out) const;
+
+  /**
+   * Berechnet die Höhenwerte eines Kind-Tiles aus den Höhenwerten seines
+   * Eltern-Tiles.
+   * @param lod LOD-Stufe des Kind-Tiles (mindestens 1)
+   * @param tile_x Position des Kind-Tiles im Tile-Raster seiner Stufe
+   * @param tile_y Position des Kind-Tiles im Tile-Raster seiner Stufe
+   * @param parent Höhenwerte des Eltern-Tiles
+   * @param out Feld für GetSize() x GetSize() Höhenwerte
+   */
+  void GenerateFromParent(int lod, int tile_x, int tile_y,
+                          const float *parent, float *out) const;
+
+ private:
+  // Kopierkonstruktor und Zuweisungsoperator verbieten.
+  TileGenerator(const TileGenerator &g);
+  void operator=(const TileGenerator &g);
+
+  /**
+   * Gibt den Faktor für die Zufallsverschiebung einer Verfeinerung mit
+   * Blockgröße block_size in der Stufe lod zurück.
+   */
+  float GetOffsetFactor(int lod, int block_size) const;
+
+  /**
+   * Führt die Verfeinerung der Höheninformationen eines Tiles nach dem
+   * Diamond-Square-Algorithmus zur Blockgröße block_size durch.
+   * Neue Werte auf dem Rand des Tiles werden nur aus den beiden benachbarten
+   * Randwerten berechnet, damit angrenzende Tiles übereinstimmen.
+   * Für block_size == 2 wird, falls möglich, RefineSSE verwendet.
+   */
+  void Refine(float *heights, int lod, int tile_x, int tile_y,
+              int block_size) const;
+  /**
+   * SSE4.1-Variante von Refine für Blockgröße 2 (den Verfeinerungsschritt
+   * jedes Kind-Tiles und den letzten Schritt des Wurzel-Tiles). Verarbeitet
+   * jeweils vier Blockmittelpunkte einer Zeile gleichzeitig, die Ränder
+   * werden außerhalb der Schleife behandelt. Liefert bitgenau dieselben
+   * Werte wie Refine.
+   */
+  void RefineSSE(float *heights, int lod, int tile_x, int tile_y) const;
+
+  /**
+   * Ausschnitt einer LOD-Stufe (siehe TileGenerator.cpp)
+   */
+  struct Window;
+
+  /**
+   * Berechnet den Ausschnitt window der Stufe lod aus dem Ausschnitt parent
+   * der Stufe darüber, mit denselben Regeln wie Refine mit Blockgröße 2.
+   * parent muss dazu einen Rand von einem Sample um window abdecken.
+   */
+  void RefineWindow(const Window &parent, int lod, Window *window) const;
+
+  /**
+   * Startwert für die Zufallszahlen
+   */
+  const unsigned int seed_;
+  /**
+   * Größe eines Tiles (Seitenlänge)
+   */
+  const int size_;
+  const float roughness_;
+  /**
+   * Seitenlänge des Wurzel-Tiles
+   */
+  const float scale_;
+  /**
+   * Höhenwerte des Wurzel-Tiles
+   */
+  float *root_;
+
+  /**
+   * Ob RefineSSE verwendet wird. Ist nur gesetzt, wenn die CPU SSE4.1
+   * unterstützt, und kann zum Vergleich mit der skalaren Variante
+   * abgeschaltet werden.
+   */
+  static bool use_sse_;
+};
@@ -1,14 +1,22 @@
 #pragma once
 #include "DXUT.h"
 
+class Random;
+
 class Vegetation {
  public:
   Vegetation(void);
   virtual ~Vegetation(void);
 
+  /**
+   * Entscheidet, ob an der Position eine Pflanze wachsen soll.
+   * @param random Zufallsschlüssel dieses Samens; liefert die Zufallszahlen
+   *               für die Entscheidung und die Eigenschaften der Pflanze
+   */
   virtual void PlaceSeed(const D3DXVECTOR3 &position,
                          float normalized_height,
-                         const D3DXVECTOR3 &normal) = 0;
+                         const D3DXVECTOR3 &normal,
+                         const Random &random) = 0;
   virtual HRESULT CreateBuffers(ID3D10Device *device) = 0;
   virtual void GetShaderHandles(ID3D10Effect *effect) = 0;
   virtual void Draw(void) = 0;
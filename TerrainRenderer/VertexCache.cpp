@@ -0,0 +1,206 @@
+#include <cassert>
+#include <cmath>
+#include <vector>
+#include "VertexCache.h"
+
+namespace {
+
+/**
+ * Parameter der Bewertung in VertexCache::Optimize (Werte von Forsyth):
+ * Größe des simulierten Caches, Bewertung der Vertices des zuletzt
+ * gezeichneten Dreiecks und Abfall der Bewertung zum Ende des Caches hin,
+ * Gewicht und Exponent des Bonus für Vertices mit wenigen verbliebenen
+ * Dreiecken
+ */
+const int OPTIMIZE_CACHE_SIZE = 32;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float CACHE_DECAY_POWER = 1.5f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+
+/**
+ * Bewertet einen Vertex an Position cache_position im simulierten Cache
+ * (-1: nicht im Cache), der noch von remaining Dreiecken benutzt wird.
+ */
+float GetVertexScore(int cache_position, int remaining) {
+  if (remaining == 0) return -1.0f;
+  float score = 0.0f;
+  if (cache_position >= 3) {
+    const float scale = 1.0f / (OPTIMIZE_CACHE_SIZE - 3);
+    score = powf(1.0f - (cache_position - 3) * scale, CACHE_DECAY_POWER);
+  } else if (cache_position >= 0) {
+    // Die Vertices des letzten Dreiecks bekommen einen festen Wert, sonst
+    // würde immer das Nachbardreieck über dieselbe Kante gewählt
+    score = LAST_TRIANGLE_SCORE;
+  }
+  score += VALENCE_BOOST_SCALE *
+           powf(static_cast<float>(remaining), -VALENCE_BOOST_POWER);
+  return score;
+}
+
+}
+
+VertexCache::VertexCache(int size, Policy policy, size_t num_vertices)
+    : size_(size),
+      policy_(policy),
+      num_misses_(0) {
+  if (policy_ == FIFO) {
+    inserted_.resize(num_vertices, -1);
+  } else {
+    entries_.reserve(size_);
+  }
+}
+
+bool VertexCache::Access(unsigned int vertex) {
+  if (policy_ == FIFO) {
+    if (inserted_[vertex] >= 0 && num_misses_ - inserted_[vertex] < size_) {
+      return true;
+    }
+    inserted_[vertex] = num_misses_++;
+    return false;
+  }
+
+  // LRU: vertex (bzw. bei einem Fehlzugriff den letzten Eintrag) suchen
+  // und die Einträge davor um eins nach hinten schieben
+  size_t i = 0;
+  while (i < entries_.size() && entries_[i] != vertex) ++i;
+  const bool hit = i < entries_.size();
+  if (!hit) {
+    ++num_misses_;
+    if (entries_.size() < static_cast<size_t>(size_)) {
+      entries_.push_back(vertex);
+    }
+    i = entries_.size() - 1;
+  }
+  for (; i > 0; --i) entries_[i] = entries_[i - 1];
+  entries_[0] = vertex;
+  return hit;
+}
+
+VertexCache::Stats VertexCache::Measure(const unsigned int *indices,
+                                        size_t num_indices,
+                                        size_t num_vertices, int size,
+                                        Policy policy, bool strips) {
+  VertexCache cache(size, policy, num_vertices);
+  std::vector<bool> used(num_vertices, false);
+  int num_used = 0;
+  // Ein Streifen mit k Indizes ergibt k-2 Dreiecke
+  size_t num_triangles = strips ? 0 : num_indices / 3;
+  size_t strip_length = 0;
+  for (size_t i = 0; i < num_indices; ++i) {
+    if (strips) {
+      if (indices[i] == STRIP_CUT) {
+        strip_length = 0;
+        continue;
+      }
+      if (++strip_length >= 3) ++num_triangles;
+    }
+    cache.Access(indices[i]);
+    if (!used[indices[i]]) {
+      used[indices[i]] = true;
+      ++num_used;
+    }
+  }
+  Stats stats = { 0.0f, 0.0f };
+  if (num_triangles > 0) {
+    stats.acmr = static_cast<float>(cache.GetNumMisses()) / num_triangles;
+    stats.atvr = static_cast<float>(cache.GetNumMisses()) / num_used;
+  }
+  return stats;
+}
+
+void VertexCache::Optimize(unsigned int *indices, size_t num_indices,
+                           size_t num_vertices) {
+  const int num_triangles = static_cast<int>(num_indices / 3);
+  if (num_triangles == 0) return;
+
+  // Dreiecke je Vertex. Die ersten remaining[v] Einträge ab
+  // first_triangle[v] sind die noch nicht gezeichneten.
+  std::vector<int> first_triangle(num_vertices + 1, 0);
+  std::vector<int> remaining(num_vertices, 0);
+  for (size_t i = 0; i < num_indices; ++i) ++remaining[indices[i]];
+  for (size_t v = 0; v < num_vertices; ++v) {
+    first_triangle[v + 1] = first_triangle[v] + remaining[v];
+  }
+  std::vector<int> vertex_triangles(num_indices);
+  std::vector<int> fill(first_triangle.begin(), first_triangle.end() - 1);
+  for (size_t i = 0; i < num_indices; ++i) {
+    vertex_triangles[fill[indices[i]]++] = static_cast<int>(i / 3);
+  }
+
+  std::vector<int> cache_position(num_vertices, -1);
+  std::vector<float> vertex_score(num_vertices);
+  for (size_t v = 0; v < num_vertices; ++v) {
+    vertex_score[v] = GetVertexScore(-1, remaining[v]);
+  }
+
+  std::vector<bool> drawn(num_triangles, false);
+  std::vector<unsigned int> output;
+  output.reserve(num_indices);
+  // Simulierter LRU-Cache, während eines Schritts um bis zu drei Einträge
+  // zu lang
+  unsigned int cache[OPTIMIZE_CACHE_SIZE + 3];
+  unsigned int new_cache[OPTIMIZE_CACHE_SIZE + 3];
+  int cache_size = 0;
+  int next_triangle = 0;
+  int best = -1;
+  for (int num_drawn = 0; num_drawn < num_triangles; ++num_drawn) {
+    if (best < 0) {
+      while (drawn[next_triangle]) ++next_triangle;
+      best = next_triangle;
+    }
+    drawn[best] = true;
+    const unsigned int *triangle = indices + 3 * best;
+    output.insert(output.end(), triangle, triangle + 3);
+
+    // Dreieck bei seinen Vertices austragen, die Vertices an den Anfang
+    // des Caches stellen
+    int new_size = 0;
+    for (int k = 0; k < 3; ++k) {
+      const unsigned int v = triangle[k];
+      int *list = &vertex_triangles[first_triangle[v]];
+      int j = 0;
+      while (list[j] != best) ++j;
+      list[j] = list[--remaining[v]];
+      list[remaining[v]] = best;
+      new_cache[new_size++] = v;
+    }
+    for (int i = 0; i < cache_size; ++i) {
+      const unsigned int v = cache[i];
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+        new_cache[new_size++] = v;
+      }
+    }
+
+    // Bewertungen der Vertices im Cache (und der herausgefallenen)
+    // aktualisieren. Das am besten bewertete ihrer Dreiecke ist das
+    // nächste; die übrigen Dreiecke sind nicht betroffen.
+    for (int i = 0; i < new_size; ++i) {
+      const unsigned int v = new_cache[i];
+      cache_position[v] = i < OPTIMIZE_CACHE_SIZE ? i : -1;
+      vertex_score[v] = GetVertexScore(cache_position[v], remaining[v]);
+    }
+    best = -1;
+    float best_score = -1.0f;
+    for (int i = 0; i < new_size; ++i) {
+      const unsigned int v = new_cache[i];
+      const int *list = &vertex_triangles[first_triangle[v]];
+      for (int j = 0; j < remaining[v]; ++j) {
+        const int t = list[j];
+        const float score = vertex_score[indices[3 * t]] +
+                            vertex_score[indices[3 * t + 1]] +
+                            vertex_score[indices[3 * t + 2]];
+        if (score > best_score) {
+          best_score = score;
+          best = t;
+        }
+      }
+    }
+    cache_size = new_size < OPTIMIZE_CACHE_SIZE ? new_size :
+                                                  OPTIMIZE_CACHE_SIZE;
+    for (int i = 0; i < cache_size; ++i) cache[i] = new_cache[i];
+  }
+
+  assert(output.size() == static_cast<size_t>(3 * num_triangles));
+  for (size_t i = 0; i < output.size(); ++i) indices[i] = output[i];
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <vector>
+
+/**
+ * Simulation des Post-Transform-Vertex-Caches der GPU: Bewertet die
+ * Reihenfolge einer Dreiecksliste (siehe Measure) und ordnet sie für den
+ * Cache um (siehe Optimize).
+ */
+class VertexCache {
+ public:
+  /**
+   * Ersetzungsstrategie des Caches. Bei FIFO ändert ein Treffer die
+   * Reihenfolge nicht (wie bei den meisten GPUs), bei LRU wird der Vertex
+   * wieder an den Anfang gestellt.
+   */
+  enum Policy { FIFO, LRU };
+
+  /**
+   * Index, mit dem in einer Folge von Dreiecksstreifen ein neuer Streifen
+   * beginnt (der Strip-Cut-Index von D3D10 für 32-Bit-Indizes)
+   */
+  static const unsigned int STRIP_CUT = 0xffffffff;
+
+  /**
+   * Kennzahlen einer Dreiecksliste für einen Cache
+   */
+  struct Stats {
+    /**
+     * Average Cache Miss Ratio: transformierte Vertices je Dreieck
+     * (höchstens 3, für große reguläre Gitter mindestens etwa 0,5)
+     */
+    float acmr;
+    /**
+     * Average Transform to Vertex Ratio: transformierte Vertices je
+     * benutztem Vertex (mindestens 1)
+     */
+    float atvr;
+  };
+
+  /**
+   * Konstruktor. Erzeugt einen leeren Cache.
+   * @param size Anzahl der Einträge
+   * @param num_vertices Anzahl der Vertices, auf die zugegriffen wird
+   */
+  VertexCache(int size, Policy policy, size_t num_vertices);
+
+  /**
+   * Greift auf vertex zu. Liegt er nicht im Cache, wird er aufgenommen
+   * (und zählt als transformiert).
+   * @return Ob vertex im Cache lag
+   */
+  bool Access(unsigned int vertex);
+
+  /**
+   * Gibt die Anzahl der Zugriffe zurück, die nicht im Cache lagen.
+   */
+  int GetNumMisses(void) const { return num_misses_; }
+
+  /**
+   * Bestimmt ACMR und ATVR der Dreiecksliste indices für einen anfangs
+   * leeren Cache mit size Einträgen.
+   * @param strips Ob indices statt einer Dreiecksliste Dreiecksstreifen
+   *               enthält, getrennt durch STRIP_CUT
+   */
+  static Stats Measure(const unsigned int *indices, size_t num_indices,
+                       size_t num_vertices, int size, Policy policy,
+                       bool strips = false);
+
+  /**
+   * Ordnet die Dreiecke von indices nach Forsyth ("Linear-Speed Vertex
+   * Cache Optimisation") für einen Vertex-Cache um: Es wird immer das
+   * Dreieck als nächstes gezeichnet, dessen Vertices am besten bewertet
+   * sind. Die Bewertung eines Vertex steigt, je weiter vorne er im
+   * simulierten LRU-Cache liegt und je weniger Dreiecke ihn noch
+   * benutzen, damit er bald ganz abgearbeitet ist. Liegt kein Dreieck mehr
+   * im Cache, geht es mit dem ersten noch fehlenden der alten Reihenfolge
+   * weiter. Der Aufwand ist linear in der Anzahl der Dreiecke, die
+   * Umlaufrichtung der Dreiecke bleibt erhalten.
+   */
+  static void Optimize(unsigned int *indices, size_t num_indices,
+                       size_t num_vertices);
+
+ private:
+  const int size_;
+  const Policy policy_;
+  int num_misses_;
+  /**
+   * FIFO: Wert von num_misses_, als der Vertex aufgenommen wurde (-1: nie).
+   * Er liegt im Cache, solange seitdem weniger als size_ Vertices
+   * aufgenommen wurden.
+   */
+  std::vector<int> inserted_;
+  /**
+   * LRU: Die Vertices im Cache, der zuletzt benutzte zuerst
+   */
+  std::vector<unsigned int> entries_;
+};
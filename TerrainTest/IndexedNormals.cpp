@@ -0,0 +1,34 @@
+#include "IndexedNormals.h"
+
+namespace {
+
+D3DXVECTOR3 GetVector(const float *heights, int width, float d, int index) {
+  return D3DXVECTOR3((index % width) * d, heights[index], (index / width) * d);
+}
+
+}
+
+void CalculateIndexedNormals(const float *heights, int width, int height,
+                             float d, const unsigned int *indices,
+                             int num_triangles, D3DXVECTOR3 *normals) {
+  const int num_vertices = width * height;
+  for (int i = 0; i < num_vertices; ++i) {
+    normals[i] = D3DXVECTOR3(0.0f, 0.0f, 0.0f);
+  }
+  for (int i = 0; i < num_triangles; ++i) {
+    D3DXVECTOR3 v1 = GetVector(heights, width, d, indices[3*i]);
+    D3DXVECTOR3 v2 = GetVector(heights, width, d, indices[3*i+1]);
+    D3DXVECTOR3 v3 = GetVector(heights, width, d, indices[3*i+2]);
+    D3DXVECTOR3 e1 = v2 - v1;
+    D3DXVECTOR3 e2 = v3 - v1;
+    D3DXVECTOR3 face_normal;
+    D3DXVec3Cross(&face_normal, &e1, &e2);
+    D3DXVec3Normalize(&face_normal, &face_normal);
+    normals[indices[3*i]] += face_normal;
+    normals[indices[3*i+1]] += face_normal;
+    normals[indices[3*i+2]] += face_normal;
+  }
+  for (int i = 0; i < num_vertices; ++i) {
+    D3DXVec3Normalize(&normals[i], &normals[i]);
+  }
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "DXUT.h"
+
+/**
+ * Vertex-Normalen eines Höhengitters wie früher Tile::CalculateNormals0:
+ * für jedes Dreieck der Indexliste die normierte Face-Normale berechnen, auf
+ * die Normalen seiner drei Vertices aufaddieren und diese am Ende normieren.
+ * Dient TerrainTest und TerrainBench als Referenz für Tile::CalculateNormals.
+ * @param heights Höhenwerte, zeilenweise mit width Werten je Zeile
+ * @param d Abstand benachbarter Vertices
+ * @param normals Feld für die Normalen, eine je Höhenwert
+ */
+void CalculateIndexedNormals(const float *heights, int width, int height,
+                             float d, const unsigned int *indices,
+                             int num_triangles, D3DXVECTOR3 *normals);
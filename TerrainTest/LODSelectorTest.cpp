@@ -0,0 +1,185 @@
+#include "stdafx.h"
+#include <cmath>
+#include <vector>
+#include "TerrainTest.h"
+#include "BudgetLODSelector.h"
+#include "DynamicLODSelector.h"
+#include "FixedLODSelector.h"
+#include "Frustum.h"
+#include "Terrain.h"
+#include "Tile.h"
+
+namespace {
+
+/**
+ * Zulässige Bildschirmfehler der geprüften DynamicLODSelector
+ */
+const float SELECT_MAX_ERRORS[] = { 0.5f, 2.0f, 8.0f };
+const int NUM_SELECT_MAX_ERRORS =
+    sizeof(SELECT_MAX_ERRORS) / sizeof(SELECT_MAX_ERRORS[0]);
+/**
+ * Anzahl der Kamerapositionen in TestSelectLODs
+ */
+const int SELECT_CAMERAS = 16;
+/**
+ * Fehlerschranken von Terrain::SetSimplification in TestTriangleBudget
+ * (negativ: aus)
+ */
+const float BUDGET_SIMPLIFICATIONS[] = { -1.0f, 0.0f, 0.05f, 0.5f };
+const int NUM_BUDGET_SIMPLIFICATIONS =
+    sizeof(BUDGET_SIMPLIFICATIONS) / sizeof(BUDGET_SIMPLIFICATIONS[0]);
+/**
+ * Dreiecks-Budgets in TestTriangleBudget
+ */
+const int TRIANGLE_BUDGETS[] = { 5000, 20000, 80000 };
+const int NUM_TRIANGLE_BUDGETS =
+    sizeof(TRIANGLE_BUDGETS) / sizeof(TRIANGLE_BUDGETS[0]);
+
+/**
+ * Setzt camera auf Position c von SELECT_CAMERAS: innerhalb und außerhalb
+ * des Terrains (Seitenlänge scale), tief und hoch, mit Tiles vor, neben und
+ * hinter der Kamera.
+ */
+void SetSelectCamera(const Terrain &terrain, float scale, int c,
+                     CFirstPersonCamera *camera) {
+  const float angle = 2.0f * D3DX_PI * c / SELECT_CAMERAS;
+  const float radius = (0.1f + 0.1f * (c % 8)) * scale;
+  D3DXVECTOR3 eye(radius * cosf(angle), 0.0f, radius * sinf(angle));
+  eye.y = terrain.GetHeightAt(eye) + (c % 3 == 0 ? 20.0f : 0.5f);
+  D3DXVECTOR3 at = eye + D3DXVECTOR3(-sinf(angle), -0.3f, cosf(angle));
+  camera->SetViewParams(&eye, &at);
+}
+
+/**
+ * Vergleicht die Bitmaske von selector.SelectLODs für alle Tiles von batch
+ * mit selector.IsLODSufficient je Tile, für alle Kamerapositionen.
+ * @param name Bezeichnung von selector für die Meldungen
+ * @return Anzahl der Kamerapositionen mit abweichenden Tiles
+ */
+int CheckSelector(const LODSelector &selector, const LODBatch &batch,
+                  const Terrain &terrain, float scale, const char *name) {
+  CFirstPersonCamera camera;
+  camera.SetProjParams(D3DX_PI / 4, 4.0f / 3.0f, 0.01f, 2.0f * scale);
+  std::vector<unsigned int> mask(batch.GetMaskSize());
+  int failures = 0;
+  for (int c = 0; c < SELECT_CAMERAS; ++c) {
+    SetSelectCamera(terrain, scale, c, &camera);
+    selector.SelectLODs(batch, &camera, &mask[0]);
+    int mismatches = 0;
+    for (int i = 0; i < batch.GetSize(); ++i) {
+      if (LODBatch::IsSet(&mask[0], i) !=
+          selector.IsLODSufficient(batch.tiles[i], &camera)) {
+        ++mismatches;
+      }
+    }
+    if (mismatches > 0) {
+      printf("  FAILED: SelectLODs differs from IsLODSufficient for %d of %d "
+             "tiles (%s, camera %d)\n", mismatches, batch.GetSize(), name, c);
+      ++failures;
+    }
+  }
+  return failures;
+}
+
+}
+
+int TerrainTest::TestSelectLODs(void) {
+  const float scale = 50.0f;
+  const int num_lod = 6;
+  const Terrain terrain(4, 1.0f, num_lod, scale, true, 3, 0, false, false);
+  // Alle Knoten des Baums in einem Batch
+  LODBatch batch;
+  for (int lod = 0; lod <= terrain.resident_lod_; ++lod) {
+    const std::vector<Tile *> &tiles = terrain.lod_tiles_[lod];
+    for (size_t t = 0; t < tiles.size(); ++t) {
+      D3DXVECTOR3 box_min, box_max;
+      tiles[t]->GetBounds(&box_min, &box_max);
+      batch.Add(tiles[t], box_min, box_max);
+    }
+  }
+
+  int failures = 0;
+  for (int e = 0; e < NUM_SELECT_MAX_ERRORS; ++e) {
+    const DynamicLODSelector grid_spacing(D3DX_PI / 4, 600,
+                                          SELECT_MAX_ERRORS[e]);
+    failures += CheckSelector(grid_spacing, batch, terrain, scale,
+                              "grid spacing");
+    const DynamicLODSelector geometric(D3DX_PI / 4, 600, SELECT_MAX_ERRORS[e],
+                                       DynamicLODSelector::GEOMETRIC_ERROR);
+    failures += CheckSelector(geometric, batch, terrain, scale,
+                              "geometric error");
+  }
+  for (int lod = 0; lod <= num_lod; ++lod) {
+    const FixedLODSelector fixed(lod);
+    failures += CheckSelector(fixed, batch, terrain, scale, "fixed");
+  }
+  return failures;
+}
+
+int TerrainTest::CountSelectedTriangles(Terrain *terrain, Tile *tile,
+                                        const LODSelector &selector,
+                                        const CBaseCamera *camera,
+                                        const Frustum &frustum,
+                                        unsigned int plane_mask) {
+  D3DXVECTOR3 box_min, box_max;
+  tile->GetBounds(&box_min, &box_max);
+  if (frustum.Test(box_min, box_max, &plane_mask) == Frustum::OUTSIDE) {
+    return 0;
+  }
+  if (!tile->HasChildren() || selector.IsLODSufficient(tile, camera)) {
+    return terrain->GetNumTriangles(tile);
+  }
+  int triangles = 0;
+  for (int dir = 0; dir < 4; ++dir) {
+    triangles += CountSelectedTriangles(terrain, tile->children_[dir],
+                                        selector, camera, frustum,
+                                        plane_mask);
+  }
+  return triangles;
+}
+
+int TerrainTest::TestTriangleBudget(void) {
+  const float scale = 50.0f;
+  Terrain terrain(5, 1.0f, 6, scale, true, 3, 0, false, false);
+  // Das Ausgleichen der LOD-Stufen beim Stitching kann Tiles hinzufügen
+  terrain.SetStitching(false);
+  CFirstPersonCamera camera;
+  camera.SetProjParams(D3DX_PI / 4, 4.0f / 3.0f, 0.01f, 2.0f * scale);
+  int failures = 0;
+  for (int s = 0; s < NUM_BUDGET_SIMPLIFICATIONS; ++s) {
+    terrain.SetSimplification(BUDGET_SIMPLIFICATIONS[s]);
+    for (int b = 0; b < NUM_TRIANGLE_BUDGETS; ++b) {
+      const int budget = TRIANGLE_BUDGETS[b];
+      BudgetLODSelector selector(D3DX_PI / 4, 600, budget,
+                                 BudgetLODSelector::TRIANGLES);
+      for (int c = 0; c < SELECT_CAMERAS; ++c) {
+        SetSelectCamera(terrain, scale, c, &camera);
+        selector.Prepare(&terrain, &camera);
+        const int triangles = CountSelectedTriangles(
+            &terrain, terrain.tile_, selector, &camera, Frustum(&camera),
+            Frustum::ALL_PLANES);
+        failures += Check(triangles <= budget,
+                          "%d triangles exceed the budget of %d "
+                          "(simplification %g, camera %d)", triangles,
+                          budget, BUDGET_SIMPLIFICATIONS[s], c);
+        // Der erreichte Fehler ist der kleinste im Budget: Mit einem
+        // etwas kleineren würde mindestens ein Tile mehr geteilt
+        const float error = selector.GetAchievedError();
+        if (error > 0.0f) {
+          const DynamicLODSelector finer(D3DX_PI / 4, 600,
+                                         error * (1.0f - 1e-6f));
+          const int finer_triangles = CountSelectedTriangles(
+              &terrain, terrain.tile_, finer, &camera, Frustum(&camera),
+              Frustum::ALL_PLANES);
+          failures += Check(finer_triangles > budget,
+                            "error %g is not the smallest within the budget "
+                            "of %d, %g fits as well (simplification %g, "
+                            "camera %d)", error, budget,
+                            error * (1.0f - 1e-6f),
+                            BUDGET_SIMPLIFICATIONS[s], c);
+        }
+      }
+    }
+  }
+  return failures;
+}
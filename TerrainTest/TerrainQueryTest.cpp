@@ -0,0 +1,269 @@
+#include "stdafx.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "TerrainTest.h"
+#include "Random.h"
+#include "Terrain.h"
+#include "Tile.h"
+
+namespace {
+
+/**
+ * Anzahl der Abfragepunkte je Richtung in TestQueryCache
+ */
+const int QUERY_GRID = 97;
+/**
+ * Anzahl der zuflligen Strahlen je Terrain in TestRaycast
+ */
+const int RAYCAST_RANDOM_RAYS = 256;
+/**
+ * Zellen je Seite der kleinsten Zellblcke von Tile::Raycast
+ */
+const int RAYCAST_BLOCK_CELLS = 8;
+/**
+ * Grte erlaubte Abweichung des Strahlparameters (bei Richtungen der
+ * Lnge 1 also in Welteinheiten) von der Referenz
+ */
+const float RAYCAST_TOLERANCE = 1e-3f;
+
+/**
+ * Schneidet den Strahl mit dem Dreieck (a, b, c) in double-Genauigkeit,
+ * ohne Toleranz (Mller-Trumbore, beide Seiten).
+ */
+bool IntersectTriangle(const D3DXVECTOR3 &origin, const D3DXVECTOR3 &dir,
+                       const D3DXVECTOR3 &a, const D3DXVECTOR3 &b,
+                       const D3DXVECTOR3 &c, double *t) {
+  const double e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+  const double e2[3] = { c.x - a.x, c.y - a.y, c.z - a.z };
+  const double d[3] = { dir.x, dir.y, dir.z };
+  const double s[3] = { origin.x - a.x, origin.y - a.y, origin.z - a.z };
+  const double p[3] = { d[1] * e2[2] - d[2] * e2[1],
+                        d[2] * e2[0] - d[0] * e2[2],
+                        d[0] * e2[1] - d[1] * e2[0] };
+  const double det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+  if (det == 0.0) return false;
+  const double u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) / det;
+  if (u < 0.0 || u > 1.0) return false;
+  const double q[3] = { s[1] * e1[2] - s[2] * e1[1],
+                        s[2] * e1[0] - s[0] * e1[2],
+                        s[0] * e1[1] - s[1] * e1[0] };
+  const double v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) / det;
+  if (v < 0.0 || u + v > 1.0) return false;
+  *t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) / det;
+  return true;
+}
+
+/**
+ * Fragt Hhen und Normalen an allen Punkten (xs[i], zs[i]) einzeln und als
+ * Batch ab und hngt sie an heights bzw. normals an.
+ */
+void Query(const Terrain &terrain, const std::vector<float> &xs,
+           const std::vector<float> &zs, std::vector<float> *heights,
+           std::vector<D3DXVECTOR3> *normals) {
+  const size_t n = xs.size();
+  heights->resize(2 * n);
+  normals->resize(2 * n);
+  for (size_t i = 0; i < n; ++i) {
+    const D3DXVECTOR3 pos(xs[i], 0.0f, zs[i]);
+    (*heights)[i] = terrain.GetHeightAt(pos);
+    (*normals)[i] = terrain.GetNormalAt(pos);
+  }
+  terrain.GetHeightsAt(&xs[0], &zs[0], &(*heights)[n], n);
+  terrain.GetNormalsAt(&xs[0], &zs[0], &(*normals)[n], n);
+}
+
+}
+
+int TerrainTest::TestQueryCache(void) {
+  // Lazy-Modus: unter der residenten Stufe werden Kinder bei Bedarf geladen
+  const float scale = 100.0f;
+  Terrain terrain(5, 1.0f, 5, scale, false, 42, 1024, false, false);
+  std::vector<float> xs, zs;
+  for (int y = 0; y < QUERY_GRID; ++y) {
+    for (int x = 0; x < QUERY_GRID; ++x) {
+      xs.push_back((x / (QUERY_GRID - 1.0f) - 0.5f) * scale);
+      zs.push_back((y / (QUERY_GRID - 1.0f) - 0.5f) * scale);
+    }
+  }
+  std::vector<float> heights, cached_heights;
+  std::vector<D3DXVECTOR3> normals, cached_normals;
+  Query(terrain, xs, zs, &heights, &normals);
+
+  // Zwei Stufen unter der residenten laden, wie es der LODSelector tte
+  const std::vector<Tile *> &tiles = terrain.lod_tiles_[terrain.resident_lod_];
+  for (size_t t = 0; t < tiles.size(); ++t) {
+    terrain.LoadChildren(tiles[t]);
+    for (int dir = 0; dir < 4; ++dir) {
+      terrain.LoadChildren(tiles[t]->children_[dir]);
+    }
+  }
+  Query(terrain, xs, zs, &cached_heights, &cached_normals);
+
+  int failures = 0;
+  failures += Check(memcmp(&heights[0], &cached_heights[0],
+                           heights.size() * sizeof(float)) == 0,
+                    "heights depend on the cached child tiles");
+  failures += Check(memcmp(&normals[0], &cached_normals[0],
+                           normals.size() * sizeof(D3DXVECTOR3)) == 0,
+                    "normals depend on the cached child tiles");
+  return failures;
+}
+
+int TerrainTest::CheckHeightBounds(const Tile &tile) {
+  if (!tile.HasChildren()) return 0;
+  int failures = 0;
+  for (int dir = 0; dir < 4; ++dir) {
+    const Tile &child = *tile.children_[dir];
+    failures += Check(child.min_height_ >= tile.min_height_ &&
+                      child.max_height_ <= tile.max_height_,
+                      "heights [%g, %g] of tile %d/%d/%d exceed the bounds "
+                      "[%g, %g] of its parent", child.min_height_,
+                      child.max_height_, child.lod_, child.tile_x_,
+                      child.tile_y_, tile.min_height_, tile.max_height_);
+    failures += CheckHeightBounds(child);
+  }
+  return failures;
+}
+
+int TerrainTest::TestLazyBounds(void) {
+  int failures = 0;
+  for (int water = 0; water <= 1; ++water) {
+    Terrain terrain(4, 1.0f, 6, 100.0f, water != 0, 42, 4096, false, false);
+    // Drei Stufen unter der residenten laden
+    std::vector<Tile *> tiles = terrain.lod_tiles_[terrain.resident_lod_];
+    for (int level = 0; level < 3; ++level) {
+      std::vector<Tile *> children;
+      for (size_t t = 0; t < tiles.size(); ++t) {
+        terrain.LoadChildren(tiles[t]);
+        children.insert(children.end(), tiles[t]->children_,
+                        tiles[t]->children_ + 4);
+      }
+      tiles.swap(children);
+    }
+    failures += CheckHeightBounds(*terrain.tile_);
+  }
+  return failures;
+}
+
+bool TerrainTest::RaycastBruteForce(const Terrain &terrain,
+                                    const D3DXVECTOR3 &origin,
+                                    const D3DXVECTOR3 &dir, float max_t,
+                                    double *t_hit) {
+  bool hit = false;
+  const std::vector<Tile *> &tiles = terrain.lod_tiles_[terrain.resident_lod_];
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    const Tile &tile = *tiles[i];
+    const int size = tile.size_;
+    const float cell_size = tile.scale_ / (size - 1);
+    for (int y = 0; y < size - 1; ++y) {
+      for (int x = 0; x < size - 1; ++x) {
+        const float x0 = tile.translation_.x + x * cell_size;
+        const float z0 = tile.translation_.y + y * cell_size;
+        const int i_nw = y * size + x, i_sw = i_nw + size;
+        const D3DXVECTOR3 nw(x0, tile.GetHeight(i_nw), z0);
+        const D3DXVECTOR3 ne(x0 + cell_size, tile.GetHeight(i_nw + 1), z0);
+        const D3DXVECTOR3 sw(x0, tile.GetHeight(i_sw), z0 + cell_size);
+        const D3DXVECTOR3 se(x0 + cell_size, tile.GetHeight(i_sw + 1),
+                             z0 + cell_size);
+        // Dreiecke wie in Tile::IntersectCell
+        double t;
+        if (IntersectTriangle(origin, dir, nw, sw, ne, &t) && t >= 0.0 &&
+            t <= max_t && (!hit || t < *t_hit)) {
+          *t_hit = t;
+          hit = true;
+        }
+        if (IntersectTriangle(origin, dir, ne, sw, se, &t) && t >= 0.0 &&
+            t <= max_t && (!hit || t < *t_hit)) {
+          *t_hit = t;
+          hit = true;
+        }
+      }
+    }
+  }
+  return hit;
+}
+
+int TerrainTest::CheckRaycast(const Terrain &terrain,
+                              const std::vector<D3DXVECTOR3> &origins,
+                              const std::vector<D3DXVECTOR3> &dirs,
+                              float max_t, const char *name) {
+  int mismatches = 0, hits = 0;
+  float max_error = 0.0f;
+  for (size_t i = 0; i < origins.size(); ++i) {
+    float t;
+    double expected;
+    const bool hit = terrain.Raycast(origins[i], dirs[i], max_t, &t);
+    const bool expected_hit = RaycastBruteForce(terrain, origins[i], dirs[i],
+                                                max_t, &expected);
+    if (hit != expected_hit) {
+      ++mismatches;
+    } else if (hit) {
+      ++hits;
+      const float error = static_cast<float>(fabs(t - expected));
+      if (error > RAYCAST_TOLERANCE) ++mismatches;
+      if (error > max_error) max_error = error;
+    }
+  }
+  return Check(mismatches == 0,
+               "Raycast differs from the brute-force intersection for %d of "
+               "%u %s rays (%d hits, largest error %g)", mismatches,
+               static_cast<unsigned int>(origins.size()), name, hits,
+               max_error);
+}
+
+int TerrainTest::TestRaycast(void) {
+  const float scale = 100.0f;
+  int failures = 0;
+  for (int s = 0; s < NUM_TEST_SEEDS; ++s) {
+    const Terrain terrain(5, 1.0f, 2, scale, true, TEST_SEEDS[s], 0, false,
+                          false);
+    const float top = terrain.GetMaxHeight() + 1.0f;
+    const float max_t = 3.0f * scale;
+    const Random random(TEST_SEEDS[s], 0);
+    std::vector<D3DXVECTOR3> origins, dirs;
+
+    // Zufllige Strahlen von oben, steil bis flach
+    for (int i = 0; i < RAYCAST_RANDOM_RAYS; ++i) {
+      const D3DXVECTOR3 origin(0.5f * scale * random.GetSignedFloat(4 * i),
+                               top + 10.0f * random.GetFloat(4 * i + 1),
+                               0.5f * scale * random.GetSignedFloat(4 * i + 2));
+      const float angle = 2.0f * D3DX_PI * random.GetFloat(4 * i + 3);
+      D3DXVECTOR3 dir(cosf(angle), -0.02f - random.GetFloat(4 * i + 3 + 7),
+                      sinf(angle));
+      D3DXVec3Normalize(&dir, &dir);
+      origins.push_back(origin);
+      dirs.push_back(dir);
+    }
+    failures += CheckRaycast(terrain, origins, dirs, max_t, "random");
+
+    // Flache Strahlen genau entlang der Grenzen der kleinsten Zellblcke
+    // (in x- und z-Richtung) und diagonal durch ihre Ecken
+    origins.clear();
+    dirs.clear();
+    const int num_tiles_1d = 1 << terrain.resident_lod_;
+    const int num_lines =
+        num_tiles_1d * (terrain.size_ - 1) / RAYCAST_BLOCK_CELLS;
+    const float block_size = scale / num_lines;
+    for (int k = 0; k <= num_lines; ++k) {
+      const float edge = -0.5f * scale + k * block_size;
+      // Erreicht die tiefste Stelle nach 0,5 bis 1,5 Seitenlngen
+      const float slope = (top - terrain.GetMinHeight()) /
+                          ((0.5f + random.GetFloat(1000 + k)) * scale);
+      D3DXVECTOR3 dir(0.0f, -slope, 1.0f);
+      D3DXVec3Normalize(&dir, &dir);
+      origins.push_back(D3DXVECTOR3(edge, top, -0.5f * scale));
+      dirs.push_back(dir);
+      dir = D3DXVECTOR3(-1.0f, -slope, 0.0f);
+      D3DXVec3Normalize(&dir, &dir);
+      origins.push_back(D3DXVECTOR3(0.5f * scale, top, edge));
+      dirs.push_back(dir);
+      dir = D3DXVECTOR3(1.0f, -slope, 1.0f);
+      D3DXVec3Normalize(&dir, &dir);
+      origins.push_back(D3DXVECTOR3(edge, top, -0.5f * scale));
+      dirs.push_back(dir);
+    }
+    failures += CheckRaycast(terrain, origins, dirs, max_t, "block edge");
+  }
+  return failures;
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include <vector>
+#include "DXUT.h"
+
+class CBaseCamera;
+class Frustum;
+class LODSelector;
+class Terrain;
+class Tile;
+
+/**
+ * Startwerte der Terrains, die die Tests fr mehrere Startwerte prfen
+ */
+const unsigned int TEST_SEEDS[] = { 1, 42, 0xdeadbeef };
+const int NUM_TEST_SEEDS = sizeof(TEST_SEEDS) / sizeof(TEST_SEEDS[0]);
+
+/**
+ * Tests der Terrain-Klassen aus TerrainRenderer, ohne D3D10-Device. Die
+ * Tests sind statische Methoden dieser Klasse, damit sie als friend (siehe
+ * Tile, Terrain, TileGenerator) auch interne Zwischenergebnisse prfen
+ * knnen. Jeder Test gibt die Anzahl der fehlgeschlagenen Prfungen zurck.
+ */
+class TerrainTest {
+ public:
+  /**
+   * Prft, dass TileGenerator::RefineSSE bitgenau dieselben Hhenwerte
+   * liefert wie die skalare Variante (fr Wurzel- und Kind-Tiles
+   * verschiedener Gren), und dass TileGenerator::Generate mit
+   * TileGenerator::GenerateFromParent bereinstimmt.
+   */
+  static int TestRefine(void);
+
+  /**
+   * Prft, dass ein Terrain (mit einer Stufe nachgeladener Kind-Tiles) mit
+   * einem OpenMP-Thread bitgenau dieselben Hhen und Normalen erhlt wie
+   * mit der voreingestellten Anzahl an Threads, fr mehrere Startwerte.
+   */
+  static int TestParallelGeneration(void);
+
+  /**
+   * Prft, dass Terrain::GetHeightAt, GetNormalAt, GetHeightsAt und
+   * GetNormalsAt im Lazy-Modus dieselben Werte liefern, bevor und nachdem
+   * Kind-Tiles unter der residenten LOD-Stufe geladen wurden.
+   */
+  static int TestQueryCache(void);
+
+  /**
+   * Prft im Lazy-Modus, dass nach dem Laden von Kind-Tiles unter der
+   * residenten LOD-Stufe die Hhen jedes Tiles in denen seiner Vorfahren
+   * liegen (Bounding-Boxen fr LOD-Auswahl und Culling).
+   */
+  static int TestLazyBounds(void);
+
+  /**
+   * Vergleicht Terrain::Raycast mit dem Schnitt gegen jedes Dreieck der
+   * Tiles der residenten LOD-Stufe, fr zufllige Strahlen und flache
+   * Strahlen entlang der Grenzen und durch die Ecken der Zellblcke.
+   */
+  static int TestRaycast(void);
+
+  /**
+   * Vergleicht Terrains mit float- und 16-Bit-Hhenwerten (gleicher
+   * Startwert, mit und ohne Wasser): gespeicherte Werte, Texel der
+   * Hhenkarte und GetHeightAt an Vertices und Zellmitten drfen hchstens
+   * um einen halben Quantisierungsschritt (max_height_ - min_height_) /
+   * 65535 / 2 des Tiles abweichen.
+   */
+  static int TestQuantization(void);
+
+  /**
+   * Vergleicht die Normalen von Tile::CalculateNormals (Tiles mehrerer
+   * LOD-Stufen mit und ohne Wasser bzw. 16-Bit-Hhen, sowie ein einzelnes
+   * Tile mit 1025 x 1025 Vertices) mit der frheren indexbasierten
+   * Berechnung (siehe CalculateIndexedNormals) ber den Tile-Rand hinweg.
+   */
+  static int TestNormals(void);
+
+  /**
+   * Prft Tile::Simplify fr mehrere Fehlerschranken und Startwerte (mit
+   * und ohne Wasser) an allen Tiles der residenten LOD-Stufe: An jedem
+   * Vertex und jeder Zellmitte darf die vereinfachte Oberflche hchstens
+   * um die Schranke von GetHeightAt abweichen, und die Dreiecke mssen
+   * das Tile ohne berlappung und T-Kreuzungen berdecken.
+   */
+  static int TestSimplify(void);
+
+  /**
+   * Prft fr alle Knoten eines Terrains in einem LODBatch und mehrere
+   * Kameras, dass die Bitmaske von SelectLODs mit IsLODSufficient je Tile
+   * bereinstimmt, fr DynamicLODSelector (beide Metriken, mehrere Fehler)
+   * und FixedLODSelector (alle LOD-Stufen).
+   */
+  static int TestSelectLODs(void);
+
+  /**
+   * Prft, dass BudgetLODSelector mit einem Budget an Dreiecken (mit und
+   * ohne Terrain::SetSimplification, ohne Stitching) aus mehreren
+   * Kamerapositionen Tiles mit hchstens so vielen Dreiecken auswhlt, und
+   * dass kein kleinerer Fehler das Budget einhlt.
+   */
+  static int TestTriangleBudget(void);
+
+ private:
+  /**
+   * Gibt die Meldung (wie bei printf) aus, falls condition nicht erfllt
+   * ist.
+   * @return 0, falls condition erfllt ist, sonst 1
+   */
+  static int Check(bool condition, const char *format, ...);
+
+  /**
+   * Vergleicht die Normalen von tile mit CalculateIndexedNormals, fr das
+   * Gitter einschlielich des Rands aus den Nachbar-Tiles.
+   * @return Anzahl der fehlgeschlagenen Prfungen
+   */
+  static int CheckNormals(const Tile &tile);
+
+  /**
+   * Vergleicht Hhen und Normalen von serial und parallel und rekursiv
+   * ihren Kind-Tiles bitgenau (siehe TestParallelGeneration).
+   * @return Anzahl der fehlgeschlagenen Prfungen
+   */
+  static int CompareTiles(const Tile &serial, const Tile &parallel);
+
+  /**
+   * Prft rekursiv, dass die Hhen der Kind-Tiles von tile zwischen
+   * dessen min_height_ und max_height_ liegen.
+   * @return Anzahl der fehlgeschlagenen Prfungen
+   */
+  static int CheckHeightBounds(const Tile &tile);
+
+  /**
+   * Schneidet den Strahl origin + t * dir (0 <= t <= max_t) mit allen
+   * Dreiecken der Tiles der residenten LOD-Stufe von terrain, in
+   * double-Genauigkeit.
+   * @param t_hit Erhlt den kleinsten Strahlparameter eines Schnittpunkts
+   * @return Ob ein Dreieck getroffen wurde
+   */
+  static bool RaycastBruteForce(const Terrain &terrain,
+                                const D3DXVECTOR3 &origin,
+                                const D3DXVECTOR3 &dir, float max_t,
+                                double *t_hit);
+
+  /**
+   * Vergleicht Terrain::Raycast fr alle Strahlen mit RaycastBruteForce.
+   * @param name Bezeichnung der Strahlen fr die Meldung
+   * @return Anzahl der fehlgeschlagenen Prfungen
+   */
+  static int CheckRaycast(const Terrain &terrain,
+                          const std::vector<D3DXVECTOR3> &origins,
+                          const std::vector<D3DXVECTOR3> &dirs, float max_t,
+                          const char *name);
+
+  /**
+   * Vergleicht die Dreiecke von tile.Simplify(max_error) an Vertices und
+   * Zellmitten mit GetHeightAt (siehe TestSimplify).
+   * @return Anzahl der fehlgeschlagenen Prfungen
+   */
+  static int CheckSimplify(const Tile &tile, float max_error);
+
+  /**
+   * Zhlt die Dreiecke (siehe Terrain::GetNumTriangles) der sichtbaren
+   * Tiles, die selector von tile aus absteigend auswhlt, ohne Stitching.
+   */
+  static int CountSelectedTriangles(Terrain *terrain, Tile *tile,
+                                    const LODSelector &selector,
+                                    const CBaseCamera *camera,
+                                    const Frustum &frustum,
+                                    unsigned int plane_mask);
+};
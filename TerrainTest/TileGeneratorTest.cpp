@@ -0,0 +1,129 @@
+#include "stdafx.h"
+#include <omp.h>
+#include <cstring>
+#include <vector>
+#include "TerrainTest.h"
+#include "Terrain.h"
+#include "Tile.h"
+#include "TileGenerator.h"
+
+namespace {
+
+/**
+ * Tiefste LOD-Stufe der verglichenen Kind-Tiles
+ */
+const int REFINE_MAX_LOD = 3;
+
+bool Equal(const std::vector<float> &a, const std::vector<float> &b) {
+  return memcmp(&a[0], &b[0], a.size() * sizeof(float)) == 0;
+}
+
+}
+
+int TerrainTest::TestRefine(void) {
+  const bool has_sse = TileGenerator::use_sse_;
+  if (!has_sse) printf("  SSE4.1 not available, testing the scalar path\n");
+
+  int failures = 0;
+  for (int n = 1; n <= 9; ++n) {
+    for (int s = 0; s < NUM_TEST_SEEDS; ++s) {
+      const unsigned int seed = TEST_SEEDS[s];
+      // Das Wurzel-Tile entsteht schon im Konstruktor
+      TileGenerator::use_sse_ = false;
+      const TileGenerator scalar(seed, n, 1.0f, 50.0f);
+      TileGenerator::use_sse_ = has_sse;
+      const TileGenerator generator(seed, n, 1.0f, 50.0f);
+      const int size = generator.GetSize();
+      const int resolution = size * size;
+      failures += Check(memcmp(scalar.root_, generator.root_,
+                               resolution * sizeof(float)) == 0,
+                        "root tile differs (n = %d, seed %u)", n, seed);
+
+      std::vector<float> parent(resolution), direct(resolution);
+      std::vector<float> sse_child(resolution), scalar_child(resolution);
+      for (int lod = 1; lod <= REFINE_MAX_LOD; ++lod) {
+        for (int tile_y = 0; tile_y < (1 << lod); ++tile_y) {
+          for (int tile_x = 0; tile_x < (1 << lod); ++tile_x) {
+            generator.Generate(lod - 1, tile_x / 2, tile_y / 2, &parent[0]);
+            TileGenerator::use_sse_ = false;
+            generator.GenerateFromParent(lod, tile_x, tile_y, &parent[0],
+                                         &scalar_child[0]);
+            TileGenerator::use_sse_ = has_sse;
+            generator.GenerateFromParent(lod, tile_x, tile_y, &parent[0],
+                                         &sse_child[0]);
+            generator.Generate(lod, tile_x, tile_y, &direct[0]);
+            failures += Check(Equal(sse_child, scalar_child),
+                              "RefineSSE differs from Refine (n = %d, seed "
+                              "%u, tile %d/%d/%d)", n, seed, lod, tile_x,
+                              tile_y);
+            failures += Check(Equal(direct, scalar_child),
+                              "Generate differs from GenerateFromParent "
+                              "(n = %d, seed %u, tile %d/%d/%d)", n, seed,
+                              lod, tile_x, tile_y);
+          }
+        }
+      }
+    }
+  }
+  TileGenerator::use_sse_ = has_sse;
+  return failures;
+}
+
+int TerrainTest::CompareTiles(const Tile &serial, const Tile &parallel) {
+  const int resolution = serial.GetResolution();
+  std::vector<float> serial_heights(resolution), parallel_heights(resolution);
+  for (int i = 0; i < resolution; ++i) {
+    serial_heights[i] = serial.GetHeight(i);
+    parallel_heights[i] = parallel.GetHeight(i);
+  }
+  int failures = 0;
+  failures += Check(Equal(serial_heights, parallel_heights),
+                    "heights of tile %d/%d/%d differ", serial.lod_,
+                    serial.tile_x_, serial.tile_y_);
+  failures += Check(memcmp(serial.vertex_normals_, parallel.vertex_normals_,
+                           resolution * sizeof(unsigned int)) == 0,
+                    "normals of tile %d/%d/%d differ", serial.lod_,
+                    serial.tile_x_, serial.tile_y_);
+  if (Check(serial.HasChildren() == parallel.HasChildren(),
+            "children of tile %d/%d/%d differ", serial.lod_, serial.tile_x_,
+            serial.tile_y_) > 0) {
+    return failures + 1;
+  }
+  if (!serial.HasChildren()) return failures;
+  for (int dir = 0; dir < 4; ++dir) {
+    failures += CompareTiles(*serial.children_[dir], *parallel.children_[dir]);
+  }
+  return failures;
+}
+
+int TerrainTest::TestParallelGeneration(void) {
+  const int num_threads = omp_get_max_threads();
+  if (num_threads == 1) printf("  only one OpenMP thread available\n");
+
+  int failures = 0;
+  for (int s = 0; s < NUM_TEST_SEEDS; ++s) {
+    const unsigned int seed = TEST_SEEDS[s];
+    Terrain *terrains[2];
+    for (int parallel = 0; parallel <= 1; ++parallel) {
+      omp_set_num_threads(parallel ? num_threads : 1);
+      Terrain *terrain = new Terrain(5, 1.0f, 5, 100.0f, false, seed, 1024,
+                                     false, false);
+      // Eine Stufe unter der residenten laden, wie es der LODSelector tte
+      const std::vector<Tile *> &tiles =
+          terrain->lod_tiles_[terrain->resident_lod_];
+      for (size_t t = 0; t < tiles.size(); ++t) {
+        terrain->LoadChildren(tiles[t]);
+      }
+      terrain->CalculateNormals();
+      terrains[parallel] = terrain;
+    }
+    omp_set_num_threads(num_threads);
+    const int tile_failures = CompareTiles(*terrains[0]->tile_,
+                                           *terrains[1]->tile_);
+    failures += Check(tile_failures == 0, "%d check(s) failed for seed %u "
+                      "with %d threads", tile_failures, seed, num_threads);
+    delete terrains[0];
+    delete terrains[1];
+  }
+  return failures;
+}
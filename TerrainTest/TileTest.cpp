@@ -0,0 +1,280 @@
+#include "stdafx.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+#include "TerrainTest.h"
+#include "IndexedNormals.h"
+#include "PackedNormal.h"
+#include "Terrain.h"
+#include "Tile.h"
+
+// Die Makros min und max aus windef.h vertragen sich nicht mit std::min und
+// std::max.
+#undef min
+#undef max
+
+namespace {
+
+/**
+ * Grte erlaubte Abweichung je Komponente zwischen Tile::CalculateNormals
+ * und der indexbasierten Referenz. Die Kodierung mit PackedNormal
+ * (16 Bit je Komponente) allein ergibt bis zu ca. 5e-5.
+ */
+const float NORMAL_TOLERANCE = 1e-4f;
+
+/**
+ * Fehlerschranken von Tile::Simplify in TestSimplify
+ */
+const float SIMPLIFY_MAX_ERRORS[] = { 0.0f, 0.01f, 0.1f, 0.5f, 2.0f };
+const int NUM_SIMPLIFY_MAX_ERRORS =
+    sizeof(SIMPLIFY_MAX_ERRORS) / sizeof(SIMPLIFY_MAX_ERRORS[0]);
+
+}
+
+int TerrainTest::TestQuantization(void) {
+  int failures = 0;
+  for (int s = 0; s < NUM_TEST_SEEDS; ++s) {
+    for (int water = 0; water <= 1; ++water) {
+      const unsigned int seed = TEST_SEEDS[s];
+      const Terrain exact(6, 1.0f, 4, 100.0f, water != 0, seed, 0, false,
+                          false);
+      const Terrain quantized(6, 1.0f, 4, 100.0f, water != 0, seed, 0, false,
+                              true);
+      for (int lod = 0; lod <= exact.resident_lod_; ++lod) {
+        const std::vector<Tile *> &exact_tiles = exact.lod_tiles_[lod];
+        const std::vector<Tile *> &quantized_tiles =
+            quantized.lod_tiles_[lod];
+        for (size_t t = 0; t < exact_tiles.size(); ++t) {
+          const Tile *a = exact_tiles[t];
+          const Tile *b = quantized_tiles[t];
+          // Halber Quantisierungsschritt, zuzglich weniger ulps fr die
+          // float-Rechnung beim Kodieren, Dekodieren und Interpolieren
+          const float magnitude = std::max(std::abs(a->min_height_),
+                                           std::abs(a->max_height_));
+          const float tolerance = (a->max_height_ - a->min_height_) /
+                                  65535.0f / 2.0f +
+                                  4.0f * FLT_EPSILON * magnitude;
+          const int size = a->size_;
+          std::vector<Tile::Texel> exact_texels(size * size);
+          std::vector<Tile::Texel> quantized_texels(size * size);
+          a->GetTexels(&exact_texels[0]);
+          b->GetTexels(&quantized_texels[0]);
+          float max_error = 0.0f;
+          for (int i = 0; i < size * size; ++i) {
+            // Gespeicherte Werte, wie GetHeight sie dekodiert und begrenzt
+            max_error = std::max(max_error, std::abs(a->GetHeight(i) -
+                                                     b->GetHeight(i)));
+            max_error = std::max(max_error,
+                                 std::abs(exact_texels[i].height -
+                                          quantized_texels[i].height));
+          }
+          // Vertices und Zellmitten der Tiles der residenten Stufe (darber
+          // steigt GetHeightAt bis zu ihnen ab)
+          if (lod == exact.resident_lod_) {
+            for (int y = 0; y < 2 * size - 1; ++y) {
+              for (int x = 0; x < 2 * size - 1; ++x) {
+                if ((x & 1) != (y & 1)) continue;
+                const D3DXVECTOR3 pos(
+                    a->translation_.x + 0.5f * x / (size - 1) * a->scale_,
+                    0.0f,
+                    a->translation_.y + 0.5f * y / (size - 1) * a->scale_);
+                max_error = std::max(max_error,
+                                     std::abs(a->GetHeightAt(pos) -
+                                              b->GetHeightAt(pos)));
+              }
+            }
+          }
+          failures += Check(max_error <= tolerance,
+                            "quantization error %g exceeds %g (seed %u, "
+                            "water %d, tile %d/%u)", max_error, tolerance,
+                            seed, water, lod, static_cast<unsigned int>(t));
+        }
+      }
+    }
+  }
+  return failures;
+}
+
+int TerrainTest::CheckNormals(const Tile &tile) {
+  Tile::Halo halo;
+  tile.GetHalo(&halo);
+  const bool has_north = !halo.north.empty(), has_south = !halo.south.empty();
+  const bool has_west = !halo.west.empty(), has_east = !halo.east.empty();
+  const int size = tile.size_;
+
+  // Hhengitter einschlielich des Rands (x und y von -1 bis size),
+  // fehlende Rnder bleiben 0 und werden von keinem Dreieck benutzt
+  const int width = size + 2;
+  std::vector<float> grid(width * width, 0.0f);
+  for (int y = has_north ? -1 : 0; y < (has_south ? size + 1 : size); ++y) {
+    tile.GetHeightRow(halo, y, width, &grid[(y + 1) * width]);
+  }
+  // Dreiecke wie bei Terrain::TriangulateLines, nur Zellen, deren Ecken
+  // alle existieren
+  std::vector<unsigned int> indices;
+  for (int y = has_north ? -1 : 0; y < (has_south ? size : size - 1); ++y) {
+    for (int x = has_west ? -1 : 0; x < (has_east ? size : size - 1); ++x) {
+      const unsigned int nw = (y + 1) * width + x + 1, ne = nw + 1;
+      const unsigned int sw = nw + width, se = sw + 1;
+      const unsigned int triangles[] = { nw, sw, ne, ne, sw, se };
+      indices.insert(indices.end(), triangles, triangles + 6);
+    }
+  }
+  std::vector<D3DXVECTOR3> expected(width * width);
+  CalculateIndexedNormals(&grid[0], width, width, tile.scale_ / (size - 1),
+                          &indices[0], static_cast<int>(indices.size() / 3),
+                          &expected[0]);
+
+  float max_error = 0.0f;
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      const D3DXVECTOR3 normal =
+          PackedNormal::Decode(tile.vertex_normals_[y * size + x]);
+      const D3DXVECTOR3 error = normal - expected[(y + 1) * width + x + 1];
+      max_error = std::max(max_error, std::max(std::abs(error.x),
+          std::max(std::abs(error.y), std::abs(error.z))));
+    }
+  }
+  return Check(max_error <= NORMAL_TOLERANCE,
+               "normal error %g exceeds %g (tile %d/%d/%d)", max_error,
+               NORMAL_TOLERANCE, tile.lod_, tile.tile_x_, tile.tile_y_);
+}
+
+int TerrainTest::TestNormals(void) {
+  int failures = 0;
+  for (int water = 0; water <= 1; ++water) {
+    for (int quantized = 0; quantized <= 1; ++quantized) {
+      // Die Normalen berechnet sonst erst CreateBuffers
+      Terrain terrain(5, 1.0f, 3, 100.0f, water != 0, 42, 0, false,
+                      quantized != 0);
+      terrain.CalculateNormals();
+      for (int lod = 0; lod <= terrain.resident_lod_; ++lod) {
+        const std::vector<Tile *> &tiles = terrain.lod_tiles_[lod];
+        for (size_t t = 0; t < tiles.size(); ++t) {
+          failures += CheckNormals(*tiles[t]);
+        }
+      }
+    }
+  }
+  // Ein einzelnes groes Tile
+  Terrain large(10, 1.0f, 1, 100.0f, false, 7, 0, false, false);
+  large.CalculateNormals();
+  failures += CheckNormals(*large.tile_);
+  return failures;
+}
+
+int TerrainTest::CheckSimplify(const Tile &tile, float max_error) {
+  std::vector<unsigned int> indices;
+  tile.Simplify(max_error, &indices);
+  const int size = tile.size_;
+  const int cells = size - 1;
+  // Samples im halben Gitterabstand: Vertices (x und y gerade) und
+  // Zellmitten (x und y ungerade)
+  const int samples = 2 * cells + 1;
+  std::vector<bool> used(size * size, false);
+  for (size_t i = 0; i < indices.size(); ++i) used[indices[i]] = true;
+  std::vector<bool> covered(samples * samples, false);
+  const float magnitude = std::max(std::abs(tile.min_height_),
+                                   std::abs(tile.max_height_));
+  // Zuzglich der Rundung beim Interpolieren an den Weltkoordinaten
+  const float tolerance = max_error + 1e-5f * (magnitude + 1.0f);
+  float max_deviation = 0.0f;
+  int area = 0, wrong_winding = 0, t_junctions = 0;
+  for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+    int px[3], py[3];
+    float h[3];
+    for (int k = 0; k < 3; ++k) {
+      px[k] = 2 * (indices[t + k] % size);
+      py[k] = 2 * (indices[t + k] / size);
+      h[k] = tile.GetHeight(indices[t + k]);
+    }
+    // Doppelte Flche, negativ bei der Umlaufrichtung von
+    // Terrain::TriangulateLines
+    const int twice_area = (px[1] - px[0]) * (py[2] - py[0]) -
+                           (py[1] - py[0]) * (px[2] - px[0]);
+    if (twice_area >= 0) {
+      ++wrong_winding;
+      continue;
+    }
+    area -= twice_area;
+    const int min_x = std::min(px[0], std::min(px[1], px[2]));
+    const int max_x = std::max(px[0], std::max(px[1], px[2]));
+    const int min_y = std::min(py[0], std::min(py[1], py[2]));
+    const int max_y = std::max(py[0], std::max(py[1], py[2]));
+    for (int y = min_y; y <= max_y; ++y) {
+      for (int x = min_x; x <= max_x; ++x) {
+        if ((x & 1) != (y & 1)) continue;
+        // Baryzentrische Gewichte (mal twice_area), alle <= 0 innerhalb
+        int w[3];
+        for (int k = 0; k < 3; ++k) {
+          const int k1 = (k + 1) % 3, k2 = (k + 2) % 3;
+          w[k] = (px[k2] - px[k1]) * (y - py[k1]) -
+                 (py[k2] - py[k1]) * (x - px[k1]);
+        }
+        if (w[0] > 0 || w[1] > 0 || w[2] > 0) continue;
+        covered[y * samples + x] = true;
+        const bool corner = (x == px[0] && y == py[0]) ||
+                            (x == px[1] && y == py[1]) ||
+                            (x == px[2] && y == py[2]);
+        if ((x & 1) == 0 && !corner && used[(y / 2) * size + x / 2]) {
+          ++t_junctions;
+        }
+        const float simplified = (w[0] * h[0] + w[1] * h[1] + w[2] * h[2]) /
+                                 twice_area;
+        const D3DXVECTOR3 pos(
+            tile.translation_.x + 0.5f * x / cells * tile.scale_, 0.0f,
+            tile.translation_.y + 0.5f * y / cells * tile.scale_);
+        max_deviation = std::max(max_deviation,
+                                 std::abs(tile.GetHeightAt(pos) -
+                                          simplified));
+      }
+    }
+  }
+  int uncovered = 0;
+  for (int y = 0; y < samples; ++y) {
+    for (int x = 0; x < samples; ++x) {
+      if ((x & 1) == (y & 1) && !covered[y * samples + x]) ++uncovered;
+    }
+  }
+
+  int failures = 0;
+  failures += Check(max_deviation <= tolerance,
+                    "simplified surface deviates by %g, more than %g "
+                    "(tile %d/%d/%d)", max_deviation, tolerance, tile.lod_,
+                    tile.tile_x_, tile.tile_y_);
+  failures += Check(wrong_winding == 0 && area == 8 * cells * cells &&
+                    uncovered == 0 && t_junctions == 0,
+                    "simplified mesh is not a triangulation of the tile "
+                    "(%d flipped triangles, area %d instead of %d, %d "
+                    "samples uncovered, %d T-junctions, tile %d/%d/%d)",
+                    wrong_winding, area, 8 * cells * cells, uncovered,
+                    t_junctions, tile.lod_, tile.tile_x_, tile.tile_y_);
+  return failures;
+}
+
+int TerrainTest::TestSimplify(void) {
+  int failures = 0;
+  for (int s = 0; s < NUM_TEST_SEEDS; ++s) {
+    for (int water = 0; water <= 1; ++water) {
+      const Terrain terrain(5, 1.0f, 3, 100.0f, water != 0,
+                            TEST_SEEDS[s], 0, false, false);
+      // GetHeightAt interpoliert erst auf der residenten Stufe im Gitter
+      // des Tiles selbst
+      const std::vector<Tile *> &tiles =
+          terrain.lod_tiles_[terrain.resident_lod_];
+      for (int e = 0; e < NUM_SIMPLIFY_MAX_ERRORS; ++e) {
+        int tile_failures = 0;
+        for (size_t t = 0; t < tiles.size(); ++t) {
+          tile_failures += CheckSimplify(*tiles[t], SIMPLIFY_MAX_ERRORS[e]);
+        }
+        if (tile_failures > 0) {
+          printf("  (max_error %g, seed %u, water %d)\n",
+                 SIMPLIFY_MAX_ERRORS[e], TEST_SEEDS[s], water);
+        }
+        failures += tile_failures;
+      }
+    }
+  }
+  return failures;
+}
@@ -0,0 +1,50 @@
+// main.cpp : Definiert den Einstiegspunkt fr die Konsolenanwendung.
+//
+
+#include "stdafx.h"
+#include <stdarg.h>
+#include "TerrainTest.h"
+
+int TerrainTest::Check(bool condition, const char *format, ...) {
+  if (condition) return 0;
+  printf("  FAILED: ");
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+  printf("\n");
+  return 1;
+}
+
+int _tmain(int argc, _TCHAR* argv[])
+{
+  struct Test {
+    const char *name;
+    int (*run)(void);
+  };
+  const Test tests[] = {
+    { "Refine", TerrainTest::TestRefine },
+    { "ParallelGeneration", TerrainTest::TestParallelGeneration },
+    { "QueryCache", TerrainTest::TestQueryCache },
+    { "LazyBounds", TerrainTest::TestLazyBounds },
+    { "Raycast", TerrainTest::TestRaycast },
+    { "Quantization", TerrainTest::TestQuantization },
+    { "Normals", TerrainTest::TestNormals },
+    { "Simplify", TerrainTest::TestSimplify },
+    { "SelectLODs", TerrainTest::TestSelectLODs },
+    { "TriangleBudget", TerrainTest::TestTriangleBudget },
+  };
+
+  const int num_tests = static_cast<int>(sizeof(tests) / sizeof(tests[0]));
+  int failed = 0;
+  for (int i = 0; i < num_tests; ++i) {
+    printf("%s\n", tests[i].name);
+    const int failures = tests[i].run();
+    if (failures > 0) {
+      printf("  %d check(s) failed\n", failures);
+      ++failed;
+    }
+  }
+  printf(failed > 0 ? "%d test(s) failed\n" : "All tests passed\n", failed);
+  return failed > 0 ? 1 : 0;
+}